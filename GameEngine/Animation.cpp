@@ -0,0 +1,219 @@
+//Animation.cpp
+#include "Animation.h"
+
+AnimationClip& AnimationClip::addFrame(const sf::Texture& texture, float duration, sf::IntRect rect) {
+	if (rect.width == 0 || rect.height == 0) {
+		sf::Vector2u size = texture.getSize();
+		rect = sf::IntRect(0, 0, static_cast<int>(size.x), static_cast<int>(size.y));
+	}
+	// A zero-length frame would stall the frame advance loop
+	if (duration <= 0.f) {
+		duration = 0.001f;
+	}
+	frames.push_back(AnimationFrame(&texture, rect, duration));
+	return *this;
+}
+
+const std::uint32_t AnimationSystem::invalidId;
+
+AnimationSystem::AnimationSystem() {}
+
+AnimationSystem::ClipId AnimationSystem::addClip(const AnimationClip& clip) {
+	clips.push_back(clip);
+	return static_cast<ClipId>(clips.size() - 1);
+}
+
+const AnimationClip& AnimationSystem::getClip(ClipId clip) const {
+	return clips[clip];
+}
+
+AnimationSystem::AnimatorId AnimationSystem::create(ClipId clip, sf::Sprite* target) {
+	AnimatorId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = static_cast<AnimatorId>(idToDense.size());
+		idToDense.push_back(invalidId);
+	}
+
+	idToDense[id] = static_cast<std::uint32_t>(clipIds.size());
+	clipIds.push_back(clip);
+	frameIndices.push_back(0);
+	frameTimes.push_back(0.f);
+	speeds.push_back(1.f);
+	finished.push_back(0);
+	targets.push_back(target);
+	denseToId.push_back(id);
+
+	if (target && !clips[clip].frames.empty()) {
+		applyFrame(clips[clip].frames[0], *target);
+	}
+	return id;
+}
+
+void AnimationSystem::destroy(AnimatorId animator) {
+	if (!isAlive(animator)) {
+		return;
+	}
+
+	// Move the last animator into the freed slot to keep the arrays packed
+	std::uint32_t index = idToDense[animator];
+	std::uint32_t last = static_cast<std::uint32_t>(clipIds.size() - 1);
+	if (index != last) {
+		clipIds[index] = clipIds[last];
+		frameIndices[index] = frameIndices[last];
+		frameTimes[index] = frameTimes[last];
+		speeds[index] = speeds[last];
+		finished[index] = finished[last];
+		targets[index] = targets[last];
+		denseToId[index] = denseToId[last];
+		idToDense[denseToId[index]] = index;
+	}
+	clipIds.pop_back();
+	frameIndices.pop_back();
+	frameTimes.pop_back();
+	speeds.pop_back();
+	finished.pop_back();
+	targets.pop_back();
+	denseToId.pop_back();
+
+	idToDense[animator] = invalidId;
+	freeIds.push_back(animator);
+}
+
+bool AnimationSystem::isAlive(AnimatorId animator) const {
+	return animator < idToDense.size() && idToDense[animator] != invalidId;
+}
+
+std::size_t AnimationSystem::size() const {
+	return clipIds.size();
+}
+
+void AnimationSystem::play(AnimatorId animator, ClipId clip, bool restart) {
+	std::uint32_t index = idToDense[animator];
+	if (clipIds[index] == clip && !restart) {
+		return;
+	}
+	clipIds[index] = clip;
+	frameIndices[index] = 0;
+	frameTimes[index] = 0.f;
+	finished[index] = 0;
+	if (targets[index] && !clips[clip].frames.empty()) {
+		applyFrame(clips[clip].frames[0], *targets[index]);
+	}
+}
+
+void AnimationSystem::setSpeed(AnimatorId animator, float speed) {
+	speeds[idToDense[animator]] = speed;
+}
+
+void AnimationSystem::setTarget(AnimatorId animator, sf::Sprite* target) {
+	std::uint32_t index = idToDense[animator];
+	targets[index] = target;
+	const AnimationClip& clip = clips[clipIds[index]];
+	if (target && !clip.frames.empty()) {
+		applyFrame(clip.frames[frameIndices[index]], *target);
+	}
+}
+
+AnimationSystem::ClipId AnimationSystem::getClipId(AnimatorId animator) const {
+	return clipIds[idToDense[animator]];
+}
+
+const AnimationFrame& AnimationSystem::getFrame(AnimatorId animator) const {
+	std::uint32_t index = idToDense[animator];
+	return clips[clipIds[index]].frames[frameIndices[index]];
+}
+
+bool AnimationSystem::isFinished(AnimatorId animator) const {
+	return finished[idToDense[animator]] != 0;
+}
+
+void AnimationSystem::update(float dt) {
+	const std::size_t count = clipIds.size();
+	const AnimationClip* clipData = clips.data();
+	for (std::size_t i = 0; i < count; ++i) {
+		if (finished[i]) {
+			continue;
+		}
+		const AnimationClip& clip = clipData[clipIds[i]];
+		const std::uint32_t frameCount = static_cast<std::uint32_t>(clip.frames.size());
+		if (frameCount == 0) {
+			continue;
+		}
+
+		float time = frameTimes[i] + dt * speeds[i];
+		std::uint32_t frame = frameIndices[i];
+		const std::uint32_t startFrame = frame;
+		// Usually zero or one iteration; a long hitch may skip several frames
+		while (time >= clip.frames[frame].duration) {
+			time -= clip.frames[frame].duration;
+			if (++frame == frameCount) {
+				if (!clip.loop) {
+					frame = frameCount - 1;
+					time = 0.f;
+					finished[i] = 1;
+					break;
+				}
+				frame = 0;
+			}
+		}
+		frameTimes[i] = time;
+
+		if (frame != startFrame) {
+			frameIndices[i] = frame;
+			if (targets[i]) {
+				applyFrame(clip.frames[frame], *targets[i]);
+			}
+		}
+	}
+}
+
+void AnimationSystem::applyFrame(const AnimationFrame& frame, sf::Sprite& sprite) {
+	if (sprite.getTexture() != frame.texture) {
+		sprite.setTexture(*frame.texture);
+	}
+	sprite.setTextureRect(frame.rect);
+}
+
+AnimationStateMachine::AnimationStateMachine(AnimationSystem& _system, sf::Sprite* _target)
+	: system(_system), target(_target), animator(AnimationSystem::invalidId), state(-1) {}
+
+AnimationStateMachine::~AnimationStateMachine() {
+	if (animator != AnimationSystem::invalidId) {
+		system.destroy(animator);
+	}
+}
+
+void AnimationStateMachine::addState(int stateId, AnimationSystem::ClipId clip) {
+	if (stateId >= static_cast<int>(stateClips.size())) {
+		stateClips.resize(stateId + 1, AnimationSystem::invalidId);
+	}
+	stateClips[stateId] = clip;
+}
+
+void AnimationStateMachine::setState(int stateId) {
+	if (stateId == state || stateId < 0 || stateId >= static_cast<int>(stateClips.size())) {
+		return;
+	}
+	if (stateClips[stateId] == AnimationSystem::invalidId) {
+		return;
+	}
+	state = stateId;
+	if (animator == AnimationSystem::invalidId) {
+		animator = system.create(stateClips[stateId], target);
+	}
+	else {
+		system.play(animator, stateClips[stateId], true);
+	}
+}
+
+int AnimationStateMachine::getState() const {
+	return state;
+}
+
+AnimationSystem::AnimatorId AnimationStateMachine::getAnimator() const {
+	return animator;
+}
@@ -0,0 +1,105 @@
+//Animation.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// One frame of a clip: a region of a texture shown for a fixed time
+struct AnimationFrame {
+    const sf::Texture* texture;
+    sf::IntRect rect;
+    float duration;
+
+    AnimationFrame(const sf::Texture* _texture, const sf::IntRect& _rect, float _duration)
+        : texture(_texture), rect(_rect), duration(_duration) {}
+};
+
+// Ordered list of frames, played once or looped
+struct AnimationClip {
+    std::vector<AnimationFrame> frames;
+    bool loop;
+
+    explicit AnimationClip(bool _loop = true) : loop(_loop) {}
+
+    // Add a frame showing part of a texture, or the whole texture if rect is empty
+    AnimationClip& addFrame(const sf::Texture& texture, float duration, sf::IntRect rect = sf::IntRect());
+};
+
+// Advances every animator in one pass over packed arrays. Animators are addressed by
+// stable ids; internally they are kept dense (swap-remove on destroy), so the batch
+// update touches only live data and never follows pointers per animator.
+class AnimationSystem {
+public:
+    typedef std::uint32_t ClipId;
+    typedef std::uint32_t AnimatorId;
+
+    static const std::uint32_t invalidId = 0xFFFFFFFFu;
+
+private:
+    std::vector<AnimationClip> clips;
+
+    // Packed animator state, one entry per live animator
+    std::vector<ClipId> clipIds;
+    std::vector<std::uint32_t> frameIndices;
+    std::vector<float> frameTimes;
+    std::vector<float> speeds;
+    std::vector<std::uint8_t> finished;
+    std::vector<sf::Sprite*> targets;
+    std::vector<AnimatorId> denseToId;
+
+    // Id -> dense index, and ids free for reuse
+    std::vector<std::uint32_t> idToDense;
+    std::vector<AnimatorId> freeIds;
+
+public:
+    AnimationSystem();
+
+    ClipId addClip(const AnimationClip& clip);
+    const AnimationClip& getClip(ClipId clip) const;
+
+    // Create an animator; if target is set, frame changes are written to it during update()
+    AnimatorId create(ClipId clip, sf::Sprite* target = nullptr);
+    void destroy(AnimatorId animator);
+    bool isAlive(AnimatorId animator) const;
+    std::size_t size() const;
+
+    // Switch clips; playing the clip that is already running does nothing unless restart is set
+    void play(AnimatorId animator, ClipId clip, bool restart = false);
+    void setSpeed(AnimatorId animator, float speed);
+    void setTarget(AnimatorId animator, sf::Sprite* target);
+
+    ClipId getClipId(AnimatorId animator) const;
+    const AnimationFrame& getFrame(AnimatorId animator) const;
+    // True once a non-looping clip has shown its last frame for its full duration
+    bool isFinished(AnimatorId animator) const;
+
+    // Advance all animators by dt seconds
+    void update(float dt);
+
+private:
+    static void applyFrame(const AnimationFrame& frame, sf::Sprite& sprite);
+};
+
+// Maps gameplay states to clips and switches its animator's clip when the state changes.
+// The animator is created on the first setState() and destroyed with the state machine.
+class AnimationStateMachine {
+private:
+    AnimationSystem& system;
+    sf::Sprite* target;
+    AnimationSystem::AnimatorId animator;
+    std::vector<AnimationSystem::ClipId> stateClips;
+    int state;
+
+public:
+    AnimationStateMachine(AnimationSystem& _system, sf::Sprite* _target);
+    ~AnimationStateMachine();
+
+    AnimationStateMachine(const AnimationStateMachine&) = delete;
+    AnimationStateMachine& operator=(const AnimationStateMachine&) = delete;
+
+    void addState(int stateId, AnimationSystem::ClipId clip);
+    void setState(int stateId);
+    int getState() const;
+    AnimationSystem::AnimatorId getAnimator() const;
+};
@@ -0,0 +1,202 @@
+//AssetArchive.cpp
+#include "AssetArchive.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace {
+	const char archiveMagic[4] = { 'G', 'E', 'P', 'K' };
+
+	std::uint64_t alignUp(std::uint64_t value) {
+		return (value + archiveAlignment - 1) & ~static_cast<std::uint64_t>(archiveAlignment - 1);
+	}
+
+	bool entryNameLess(const ArchiveEntry& entry, const std::string& name) {
+		return std::strncmp(entry.name, name.c_str(), archiveNameLength) < 0;
+	}
+}
+
+AssetArchive::AssetArchive() : entries(nullptr), entryCount(0) {}
+
+bool AssetArchive::open(const std::string& path) {
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	const std::uint8_t* data = file.getData();
+	const std::uint64_t size = file.getSize();
+	if (size < sizeof(ArchiveHeader)) {
+		close();
+		return false;
+	}
+	const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(data);
+	if (std::memcmp(header->magic, archiveMagic, sizeof(archiveMagic)) != 0 || header->version != archiveVersion ||
+		header->entryCount > (size - sizeof(ArchiveHeader)) / sizeof(ArchiveEntry)) {
+		close();
+		return false;
+	}
+
+	// Validate once here so lookups never have to
+	const ArchiveEntry* table = reinterpret_cast<const ArchiveEntry*>(data + sizeof(ArchiveHeader));
+	for (std::uint32_t i = 0; i < header->entryCount; ++i) {
+		const ArchiveEntry& entry = table[i];
+		bool valid = entry.name[archiveNameLength - 1] == '\0' && entry.offset <= size && entry.size <= size - entry.offset;
+		if (valid && entry.type == ArchiveImage) {
+			valid = static_cast<std::uint64_t>(entry.width) * entry.height * 4 == entry.size && entry.offset % archiveAlignment == 0;
+		}
+		if (valid && i > 0) {
+			valid = std::strncmp(table[i - 1].name, entry.name, archiveNameLength) < 0;
+		}
+		if (!valid) {
+			close();
+			return false;
+		}
+	}
+
+	entries = table;
+	entryCount = header->entryCount;
+	return true;
+}
+
+void AssetArchive::close() {
+	file.close();
+	entries = nullptr;
+	entryCount = 0;
+}
+
+bool AssetArchive::isOpen() const {
+	return file.isOpen();
+}
+
+const ArchiveEntry* AssetArchive::find(const std::string& name) const {
+	if (!entries || name.size() >= archiveNameLength) {
+		return nullptr;
+	}
+	const ArchiveEntry* end = entries + entryCount;
+	const ArchiveEntry* entry = std::lower_bound(entries, end, name, entryNameLess);
+	if (entry == end || name.compare(entry->name) != 0) {
+		return nullptr;
+	}
+	return entry;
+}
+
+const std::uint8_t* AssetArchive::getData(const ArchiveEntry& entry) const {
+	return file.getData() + entry.offset;
+}
+
+const sf::Uint8* AssetArchive::getPixels(const std::string& name, unsigned& width, unsigned& height) const {
+	const ArchiveEntry* entry = find(name);
+	if (!entry || entry->type != ArchiveImage) {
+		return nullptr;
+	}
+	width = entry->width;
+	height = entry->height;
+	return getData(*entry);
+}
+
+bool AssetArchive::loadTexture(const std::string& name, sf::Texture& texture) const {
+	unsigned width, height;
+	const sf::Uint8* pixels = getPixels(name, width, height);
+	if (!pixels || !texture.create(width, height)) {
+		return false;
+	}
+	texture.update(pixels);
+	return true;
+}
+
+bool AssetArchive::loadFont(const std::string& name, sf::Font& font) const {
+	const ArchiveEntry* entry = find(name);
+	if (!entry || entry->type != ArchiveFont) {
+		return false;
+	}
+	return font.loadFromMemory(getData(*entry), static_cast<std::size_t>(entry->size));
+}
+
+bool AssetPacker::addImage(const std::string& name, const std::string& path) {
+	sf::Image image;
+	if (!image.loadFromFile(path)) {
+		return false;
+	}
+	const unsigned width = image.getSize().x;
+	const unsigned height = image.getSize().y;
+	const sf::Uint8* pixels = image.getPixelsPtr();
+	std::vector<std::uint8_t> data(pixels, pixels + static_cast<std::size_t>(width) * height * 4);
+	return addEntry(name, ArchiveImage, width, height, data);
+}
+
+bool AssetPacker::addFile(const std::string& name, const std::string& path, ArchiveEntryType type) {
+	std::ifstream source(path, std::ios::binary);
+	if (!source.is_open()) {
+		return false;
+	}
+	std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+	return addEntry(name, type, 0, 0, data);
+}
+
+std::size_t AssetPacker::getEntryCount() const {
+	return pending.size();
+}
+
+bool AssetPacker::write(const std::string& path) {
+	std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) {
+		return a.name < b.name;
+	});
+
+	ArchiveHeader header;
+	std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+	header.version = archiveVersion;
+	header.entryCount = static_cast<std::uint32_t>(pending.size());
+	header.reserved = 0;
+
+	std::vector<ArchiveEntry> table(pending.size());
+	std::uint64_t offset = alignUp(sizeof(ArchiveHeader) + table.size() * sizeof(ArchiveEntry));
+	for (std::size_t i = 0; i < pending.size(); ++i) {
+		ArchiveEntry& entry = table[i];
+		std::memset(&entry, 0, sizeof(entry));
+		std::memcpy(entry.name, pending[i].name.c_str(), pending[i].name.size());
+		entry.type = pending[i].type;
+		entry.width = pending[i].width;
+		entry.height = pending[i].height;
+		entry.offset = offset;
+		entry.size = pending[i].data.size();
+		offset = alignUp(offset + entry.size);
+	}
+
+	std::ofstream output(path, std::ios::binary | std::ios::trunc);
+	if (!output.is_open()) {
+		return false;
+	}
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(ArchiveEntry));
+
+	const char padding[archiveAlignment] = {};
+	std::uint64_t written = sizeof(ArchiveHeader) + table.size() * sizeof(ArchiveEntry);
+	for (std::size_t i = 0; i < pending.size(); ++i) {
+		output.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+		output.write(reinterpret_cast<const char*>(pending[i].data.data()), pending[i].data.size());
+		written = table[i].offset + table[i].size;
+	}
+	return static_cast<bool>(output);
+}
+
+bool AssetPacker::addEntry(const std::string& name, ArchiveEntryType type, unsigned width, unsigned height, std::vector<std::uint8_t>& data) {
+	if (name.empty() || name.size() >= archiveNameLength) {
+		return false;
+	}
+	for (const PendingEntry& entry : pending) {
+		if (entry.name == name) {
+			return false;
+		}
+	}
+	PendingEntry entry;
+	entry.name = name;
+	entry.type = type;
+	entry.width = width;
+	entry.height = height;
+	entry.data.swap(data);
+	pending.push_back(std::move(entry));
+	return true;
+}
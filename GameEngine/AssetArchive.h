@@ -0,0 +1,97 @@
+//AssetArchive.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// Archive layout, in the byte order of the machine that packed it:
+//   ArchiveHeader
+//   ArchiveEntry[entryCount]  table of contents, sorted by name
+//   entry data, each blob aligned to archiveAlignment
+// Images are stored as raw RGBA8 rows, so loading one is a single texture upload
+// straight from the mapped file; fonts and other files are stored as they are on disk.
+const std::uint32_t archiveVersion = 1;
+const std::size_t archiveAlignment = 16;
+const std::size_t archiveNameLength = 48;
+
+enum ArchiveEntryType : std::uint32_t {
+    ArchiveImage,
+    ArchiveFont,
+    ArchiveRaw
+};
+
+struct ArchiveHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+};
+
+struct ArchiveEntry {
+    // Null-terminated; names longer than archiveNameLength - 1 are rejected by the packer
+    char name[archiveNameLength];
+    std::uint32_t type;
+    // Pixel size for images, zero otherwise
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// Runtime side: maps an archive and hands out its contents without copying or decoding.
+// Pointers and fonts created from it stay valid only while the archive is open.
+class AssetArchive {
+private:
+    MappedFile file;
+    const ArchiveEntry* entries;
+    std::uint32_t entryCount;
+
+public:
+    AssetArchive();
+
+    // Map the archive and validate its table of contents
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Entry with the given name, or nullptr if the archive has none
+    const ArchiveEntry* find(const std::string& name) const;
+    const std::uint8_t* getData(const ArchiveEntry& entry) const;
+
+    // RGBA8 pixels of an image entry, or nullptr
+    const sf::Uint8* getPixels(const std::string& name, unsigned& width, unsigned& height) const;
+    // Create the texture and upload the mapped pixels into it
+    bool loadTexture(const std::string& name, sf::Texture& texture) const;
+    // The font reads glyphs from the mapped bytes, so the archive must outlive it
+    bool loadFont(const std::string& name, sf::Font& font) const;
+};
+
+// Offline side: decodes source files once and writes them into an archive
+class AssetPacker {
+private:
+    struct PendingEntry {
+        std::string name;
+        ArchiveEntryType type;
+        unsigned width;
+        unsigned height;
+        std::vector<std::uint8_t> data;
+    };
+
+    std::vector<PendingEntry> pending;
+
+public:
+    // Decode an image file (PNG, JPEG, ...) to RGBA8; 'name' is what the runtime looks it up by
+    bool addImage(const std::string& name, const std::string& path);
+    // Store a file as is
+    bool addFile(const std::string& name, const std::string& path, ArchiveEntryType type = ArchiveRaw);
+    std::size_t getEntryCount() const;
+
+    bool write(const std::string& path);
+
+private:
+    bool addEntry(const std::string& name, ArchiveEntryType type, unsigned width, unsigned height, std::vector<std::uint8_t>& data);
+};
@@ -0,0 +1,69 @@
+//Camera.cpp
+#include "Camera.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	float clampAxis(float center, float halfSize, float low, float high) {
+		if (high - low <= 2.f * halfSize) {
+			return (low + high) * 0.5f;
+		}
+		return std::min(std::max(center, low + halfSize), high - halfSize);
+	}
+}
+
+Camera::Camera(sf::Vector2f size) : view(size * 0.5f, size), target(size * 0.5f), followRate(5.f), bounded(false) {}
+
+void Camera::setFollowRate(float rate) {
+	followRate = std::max(rate, 0.f);
+}
+
+void Camera::setBounds(const sf::FloatRect& area) {
+	bounds = area;
+	bounded = true;
+	clampToBounds();
+}
+
+void Camera::clearBounds() {
+	bounded = false;
+}
+
+void Camera::follow(sf::Vector2f point) {
+	target = point;
+}
+
+void Camera::snap() {
+	view.setCenter(target);
+	clampToBounds();
+}
+
+void Camera::update(float deltaSeconds) {
+	const float blend = 1.f - std::exp(-followRate * deltaSeconds);
+	const sf::Vector2f center = view.getCenter();
+	view.setCenter(center + (target - center) * blend);
+	clampToBounds();
+}
+
+const sf::View& Camera::getView() const {
+	return view;
+}
+
+sf::Vector2f Camera::getCenter() const {
+	return view.getCenter();
+}
+
+sf::FloatRect Camera::getVisibleArea() const {
+	const sf::Vector2f size = view.getSize();
+	const sf::Vector2f center = view.getCenter();
+	return sf::FloatRect(center.x - size.x * 0.5f, center.y - size.y * 0.5f, size.x, size.y);
+}
+
+void Camera::clampToBounds() {
+	if (!bounded) {
+		return;
+	}
+	const sf::Vector2f halfSize = view.getSize() * 0.5f;
+	const sf::Vector2f center = view.getCenter();
+	view.setCenter(clampAxis(center.x, halfSize.x, bounds.left, bounds.left + bounds.width),
+		clampAxis(center.y, halfSize.y, bounds.top, bounds.top + bounds.height));
+}
@@ -0,0 +1,37 @@
+//Camera.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+// sf::View that eases toward a target point. The easing is exponential in real time, so
+// the camera closes the same fraction of the distance per second at any frame rate.
+// Optional world bounds keep the view from showing anything outside the level.
+class Camera {
+private:
+    sf::View view;
+    sf::Vector2f target;
+    // Fraction of the remaining distance closed per second is 1 - exp(-followRate)
+    float followRate;
+    sf::FloatRect bounds;
+    bool bounded;
+
+public:
+    explicit Camera(sf::Vector2f size);
+
+    void setFollowRate(float rate);
+    // The view is kept inside 'area'; an area smaller than the view is centered
+    void setBounds(const sf::FloatRect& area);
+    void clearBounds();
+
+    void follow(sf::Vector2f point);
+    // Jump straight to the target, e.g. after a teleport or on the first frame
+    void snap();
+    void update(float deltaSeconds);
+
+    const sf::View& getView() const;
+    sf::Vector2f getCenter() const;
+    sf::FloatRect getVisibleArea() const;
+
+private:
+    void clampToBounds();
+};
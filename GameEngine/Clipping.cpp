@@ -0,0 +1,187 @@
+//Clipping.cpp
+#include "Clipping.h"
+
+#include <cmath>
+
+namespace {
+	// One Liang-Barsky boundary test: p * t <= q must hold
+	bool clipTest(float p, float q, float& t0, float& t1) {
+		if (p == 0.f) {
+			// Parallel to this boundary: either completely inside or completely outside it
+			return q >= 0.f;
+		}
+		float t = q / p;
+		if (p < 0.f) {
+			if (t > t1) {
+				return false;
+			}
+			if (t > t0) {
+				t0 = t;
+			}
+		}
+		else {
+			if (t < t0) {
+				return false;
+			}
+			if (t < t1) {
+				t1 = t;
+			}
+		}
+		return true;
+	}
+
+	// The four rectangle edges, each as "keep points where inside() holds"
+	enum ClipEdge {
+		EdgeLeft,
+		EdgeRight,
+		EdgeTop,
+		EdgeBottom
+	};
+
+	bool isInside(const AABB& clip, ClipEdge edge, const Vec2& point) {
+		switch (edge) {
+		case EdgeLeft: return point.x >= clip.min.x;
+		case EdgeRight: return point.x <= clip.max.x;
+		case EdgeTop: return point.y >= clip.min.y;
+		default: return point.y <= clip.max.y;
+		}
+	}
+
+	Vec2 intersectEdge(const AABB& clip, ClipEdge edge, const Vec2& from, const Vec2& to) {
+		float t;
+		switch (edge) {
+		case EdgeLeft: t = (clip.min.x - from.x) / (to.x - from.x); break;
+		case EdgeRight: t = (clip.max.x - from.x) / (to.x - from.x); break;
+		case EdgeTop: t = (clip.min.y - from.y) / (to.y - from.y); break;
+		default: t = (clip.max.y - from.y) / (to.y - from.y); break;
+		}
+		Vec2 point = from + (to - from) * t;
+		// Snap onto the edge so rounding cannot leave the point just outside
+		switch (edge) {
+		case EdgeLeft: point.x = clip.min.x; break;
+		case EdgeRight: point.x = clip.max.x; break;
+		case EdgeTop: point.y = clip.min.y; break;
+		default: point.y = clip.max.y; break;
+		}
+		return point;
+	}
+
+	void clipAgainstEdge(const AABB& clip, ClipEdge edge, const std::vector<Vec2>& input, std::vector<Vec2>& output) {
+		output.clear();
+		if (input.empty()) {
+			return;
+		}
+		Vec2 previous = input.back();
+		bool previousInside = isInside(clip, edge, previous);
+		for (const Vec2& current : input) {
+			bool currentInside = isInside(clip, edge, current);
+			if (currentInside != previousInside) {
+				output.push_back(intersectEdge(clip, edge, previous, current));
+			}
+			if (currentInside) {
+				output.push_back(current);
+			}
+			previous = current;
+			previousInside = currentInside;
+		}
+	}
+}
+
+AABB computeViewBounds(const sf::View& view, float margin) {
+	sf::Vector2f halfSize(view.getSize().x / 2.f, view.getSize().y / 2.f);
+	if (view.getRotation() != 0.f) {
+		// A rotated view is covered by the circle through its corners
+		float radius = std::sqrt(halfSize.x * halfSize.x + halfSize.y * halfSize.y);
+		halfSize = sf::Vector2f(radius, radius);
+	}
+	Vec2 extent(halfSize.x + margin, halfSize.y + margin);
+	Vec2 center(view.getCenter());
+	return AABB(center - extent, center + extent);
+}
+
+int computeOutCode(const AABB& clip, const Vec2& point) {
+	int code = OutInside;
+	if (point.x < clip.min.x) {
+		code |= OutLeft;
+	}
+	else if (point.x > clip.max.x) {
+		code |= OutRight;
+	}
+	if (point.y < clip.min.y) {
+		code |= OutTop;
+	}
+	else if (point.y > clip.max.y) {
+		code |= OutBottom;
+	}
+	return code;
+}
+
+bool clipLineParameters(const AABB& clip, const Vec2& start, const Vec2& end, float& t0, float& t1) {
+	t0 = 0.f;
+	t1 = 1.f;
+
+	// Trivial cases first: both ends inside, or both beyond the same edge
+	int startCode = computeOutCode(clip, start);
+	int endCode = computeOutCode(clip, end);
+	if ((startCode | endCode) == OutInside) {
+		return true;
+	}
+	if ((startCode & endCode) != OutInside) {
+		return false;
+	}
+
+	Vec2 delta = end - start;
+	return clipTest(-delta.x, start.x - clip.min.x, t0, t1) &&
+		clipTest(delta.x, clip.max.x - start.x, t0, t1) &&
+		clipTest(-delta.y, start.y - clip.min.y, t0, t1) &&
+		clipTest(delta.y, clip.max.y - start.y, t0, t1);
+}
+
+bool clipLine(const AABB& clip, Vec2& start, Vec2& end) {
+	float t0, t1;
+	if (!clipLineParameters(clip, start, end, t0, t1)) {
+		return false;
+	}
+	Vec2 delta = end - start;
+	if (t1 < 1.f) {
+		end = start + delta * t1;
+	}
+	if (t0 > 0.f) {
+		start = start + delta * t0;
+	}
+	return true;
+}
+
+std::size_t clipPolygon(const AABB& clip, const Vec2* points, std::size_t count, std::vector<Vec2>& output, std::vector<Vec2>& scratch) {
+	output.assign(points, points + count);
+	if (count < 3) {
+		output.clear();
+		return 0;
+	}
+
+	// Skip the work when the polygon is entirely inside or entirely beyond one edge
+	int allCodes = OutInside;
+	int commonCode = OutLeft | OutRight | OutTop | OutBottom;
+	for (std::size_t i = 0; i < count; ++i) {
+		int code = computeOutCode(clip, points[i]);
+		allCodes |= code;
+		commonCode &= code;
+	}
+	if (allCodes == OutInside) {
+		return output.size();
+	}
+	if (commonCode != OutInside) {
+		output.clear();
+		return 0;
+	}
+
+	const ClipEdge edges[] = { EdgeLeft, EdgeRight, EdgeTop, EdgeBottom };
+	for (ClipEdge edge : edges) {
+		clipAgainstEdge(clip, edge, output, scratch);
+		output.swap(scratch);
+	}
+	if (output.size() < 3) {
+		output.clear();
+	}
+	return output.size();
+}
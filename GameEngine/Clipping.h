@@ -0,0 +1,34 @@
+//Clipping.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <vector>
+#include "Geometry.h"
+
+// Clipping stages run before rasterization, so only the part of a primitive that can
+// reach the screen is ever stepped through or sent to the GPU.
+
+// World-space area visible through a view, grown by 'margin' on every side
+AABB computeViewBounds(const sf::View& view, float margin = 0.f);
+
+// Cohen-Sutherland region code of a point relative to a clip rectangle
+enum OutCode {
+    OutInside = 0,
+    OutLeft = 1,
+    OutRight = 2,
+    OutBottom = 4,
+    OutTop = 8
+};
+int computeOutCode(const AABB& clip, const Vec2& point);
+
+// Liang-Barsky: the parameter range [t0, t1] of start + t * (end - start) that lies
+// inside 'clip'. Returns false if the segment misses the rectangle entirely.
+bool clipLineParameters(const AABB& clip, const Vec2& start, const Vec2& end, float& t0, float& t1);
+// Clip a segment in place; returns false if nothing of it is inside
+bool clipLine(const AABB& clip, Vec2& start, Vec2& end);
+
+// Sutherland-Hodgman: clip a polygon against each edge of the rectangle in turn.
+// The result goes to 'output'; 'scratch' holds the intermediate passes so the caller
+// can reuse both buffers. Returns the number of vertices left (0 or at least 3).
+std::size_t clipPolygon(const AABB& clip, const Vec2* points, std::size_t count, std::vector<Vec2>& output, std::vector<Vec2>& scratch);
@@ -0,0 +1,216 @@
+//CollisionMask.cpp
+#include "CollisionMask.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+CollisionMask::CollisionMask() : width(0), height(0), wordsPerRow(0), opaqueBounds(0, 0, 0, 0) {}
+
+CollisionMask::CollisionMask(int _width, int _height) : width(_width), height(_height),
+wordsPerRow((_width + 63) / 64), opaqueBounds(0, 0, 0, 0) {
+	rows.assign(static_cast<size_t>(wordsPerRow) * height, 0);
+}
+
+CollisionMask CollisionMask::fromPixels(const sf::Uint8* pixels, int sourceWidth, int sourceHeight, float scaleX, float scaleY, sf::Uint8 alphaThreshold) {
+	if (!pixels || sourceWidth <= 0 || sourceHeight <= 0 || scaleX <= 0.f || scaleY <= 0.f) {
+		return CollisionMask();
+	}
+
+	// Resample at the on-screen resolution so the test can work in whole world pixels
+	CollisionMask mask(static_cast<int>(std::ceil(sourceWidth * scaleX)), static_cast<int>(std::ceil(sourceHeight * scaleY)));
+
+	for (int y = 0; y < mask.height; ++y) {
+		int sourceY = std::min(static_cast<int>((y + 0.5f) / scaleY), sourceHeight - 1);
+		const sf::Uint8* sourceRow = pixels + static_cast<size_t>(sourceY) * sourceWidth * 4;
+		for (int x = 0; x < mask.width; ++x) {
+			int sourceX = std::min(static_cast<int>((x + 0.5f) / scaleX), sourceWidth - 1);
+			if (sourceRow[sourceX * 4 + 3] >= alphaThreshold) {
+				mask.setPixel(x, y);
+			}
+		}
+	}
+
+	mask.buildLevels();
+	return mask;
+}
+
+CollisionMask CollisionMask::fromImage(const sf::Image& image, float scaleX, float scaleY, sf::Uint8 alphaThreshold) {
+	return fromPixels(image.getPixelsPtr(), static_cast<int>(image.getSize().x), static_cast<int>(image.getSize().y), scaleX, scaleY, alphaThreshold);
+}
+
+CollisionMask CollisionMask::fromTexture(const sf::Texture& texture, float scaleX, float scaleY, sf::Uint8 alphaThreshold) {
+	return fromImage(texture.copyToImage(), scaleX, scaleY, alphaThreshold);
+}
+
+CollisionMask CollisionMask::fromCircle(float radius) {
+	if (radius <= 0.f) {
+		return CollisionMask();
+	}
+
+	int size = static_cast<int>(std::ceil(radius * 2.f));
+	CollisionMask mask(size, size);
+	const float radiusSquared = radius * radius;
+
+	for (int y = 0; y < size; ++y) {
+		float dy = y + 0.5f - radius;
+		for (int x = 0; x < size; ++x) {
+			float dx = x + 0.5f - radius;
+			if (dx * dx + dy * dy <= radiusSquared) {
+				mask.setPixel(x, y);
+			}
+		}
+	}
+
+	mask.buildLevels();
+	return mask;
+}
+
+const CollisionMask& CollisionMask::sharedCircle(float radius) {
+	static std::map<float, CollisionMask> circleMasks;
+	std::map<float, CollisionMask>::iterator it = circleMasks.find(radius);
+	if (it == circleMasks.end()) {
+		it = circleMasks.insert(std::make_pair(radius, fromCircle(radius))).first;
+	}
+	return it->second;
+}
+
+int CollisionMask::getWidth() const {
+	return width;
+}
+
+int CollisionMask::getHeight() const {
+	return height;
+}
+
+bool CollisionMask::isEmpty() const {
+	return opaqueBounds.width == 0 || opaqueBounds.height == 0;
+}
+
+bool CollisionMask::testPixel(int x, int y) const {
+	if (x < 0 || x >= width || y < 0 || y >= height) {
+		return false;
+	}
+	return (getRow(y)[x >> 6] >> (x & 63)) & 1u;
+}
+
+bool CollisionMask::overlaps(const CollisionMask& a, const sf::Vector2f& positionA, const CollisionMask& b, const sf::Vector2f& positionB) {
+	if (a.isEmpty() || b.isEmpty()) {
+		return false;
+	}
+
+	const int ax = static_cast<int>(std::floor(positionA.x + 0.5f));
+	const int ay = static_cast<int>(std::floor(positionA.y + 0.5f));
+	const int bx = static_cast<int>(std::floor(positionB.x + 0.5f));
+	const int by = static_cast<int>(std::floor(positionB.y + 0.5f));
+
+	// Intersect the opaque bounds of both masks in world space
+	int x0 = std::max(ax + a.opaqueBounds.left, bx + b.opaqueBounds.left);
+	int x1 = std::min(ax + a.opaqueBounds.left + a.opaqueBounds.width, bx + b.opaqueBounds.left + b.opaqueBounds.width);
+	int y0 = std::max(ay + a.opaqueBounds.top, by + b.opaqueBounds.top);
+	int y1 = std::min(ay + a.opaqueBounds.top + a.opaqueBounds.height, by + b.opaqueBounds.top + b.opaqueBounds.height);
+	if (x0 >= x1 || y0 >= y1) {
+		return false;
+	}
+
+	// Bit i of a row in A lines up with bit (i + shift) of the same world row in B
+	const int shift = ax - bx;
+	const int firstWord = (x0 - ax) >> 6;
+	const int lastWord = (x1 - 1 - ax) >> 6;
+	const int rowA0 = y0 - ay;
+	const int rowA1 = y1 - ay;
+	const int rowOffsetB = ay - by;
+
+	for (int band = rowA0 / bandHeight; band * bandHeight < rowA1; ++band) {
+		int rowStart = std::max(band * bandHeight, rowA0);
+		int rowEnd = std::min((band + 1) * bandHeight, rowA1);
+
+		// Coarse level: the band of A against every band of B covering the same rows
+		int bandB0 = (rowStart + rowOffsetB) / bandHeight;
+		int bandB1 = (rowEnd - 1 + rowOffsetB) / bandHeight;
+		const std::uint64_t* coarseA = a.getBand(band);
+		bool candidate = false;
+		for (int word = firstWord; word <= lastWord && !candidate; ++word) {
+			if (coarseA[word] == 0) {
+				continue;
+			}
+			std::uint64_t coarseB = 0;
+			for (int bandB = bandB0; bandB <= bandB1; ++bandB) {
+				coarseB |= b.extractBits(b.getBand(bandB), word * 64 + shift);
+			}
+			candidate = (coarseA[word] & coarseB) != 0;
+		}
+		if (!candidate) {
+			continue;
+		}
+
+		// Fine level: one AND per 64 pixels of every row in the band
+		for (int y = rowStart; y < rowEnd; ++y) {
+			const std::uint64_t* rowA = a.getRow(y);
+			const std::uint64_t* rowB = b.getRow(y + rowOffsetB);
+			for (int word = firstWord; word <= lastWord; ++word) {
+				if (rowA[word] & b.extractBits(rowB, word * 64 + shift)) {
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void CollisionMask::setPixel(int x, int y) {
+	rows[static_cast<size_t>(y) * wordsPerRow + (x >> 6)] |= std::uint64_t(1) << (x & 63);
+}
+
+void CollisionMask::buildLevels() {
+	int bandCount = (height + bandHeight - 1) / bandHeight;
+	bands.assign(static_cast<size_t>(bandCount) * wordsPerRow, 0);
+
+	int minX = width, minY = height, maxX = -1, maxY = -1;
+	for (int y = 0; y < height; ++y) {
+		const std::uint64_t* row = getRow(y);
+		std::uint64_t* band = &bands[static_cast<size_t>(y / bandHeight) * wordsPerRow];
+		for (int word = 0; word < wordsPerRow; ++word) {
+			if (row[word] == 0) {
+				continue;
+			}
+			band[word] |= row[word];
+			for (int bit = 0; bit < 64; ++bit) {
+				if ((row[word] >> bit) & 1u) {
+					minX = std::min(minX, word * 64 + bit);
+					maxX = std::max(maxX, word * 64 + bit);
+				}
+			}
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+		}
+	}
+
+	if (maxX < 0) {
+		opaqueBounds = sf::IntRect(0, 0, 0, 0);
+	}
+	else {
+		opaqueBounds = sf::IntRect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+	}
+}
+
+const std::uint64_t* CollisionMask::getRow(int y) const {
+	return &rows[static_cast<size_t>(y) * wordsPerRow];
+}
+
+const std::uint64_t* CollisionMask::getBand(int band) const {
+	return &bands[static_cast<size_t>(band) * wordsPerRow];
+}
+
+std::uint64_t CollisionMask::extractBits(const std::uint64_t* row, int bitOffset) const {
+	// Floor division so negative offsets select the word to the left
+	int word = bitOffset >= 0 ? bitOffset / 64 : -((-bitOffset + 63) / 64);
+	int bit = bitOffset - word * 64;
+
+	std::uint64_t low = (word >= 0 && word < wordsPerRow) ? row[word] : 0;
+	if (bit == 0) {
+		return low;
+	}
+	std::uint64_t high = (word + 1 >= 0 && word + 1 < wordsPerRow) ? row[word + 1] : 0;
+	return (low >> bit) | (high << (64 - bit));
+}
@@ -0,0 +1,53 @@
+//CollisionMask.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Pixel-exact collision silhouette, built once at load time.
+// Every row is packed into 64-bit words (bit i of word w is pixel x = w * 64 + i),
+// and rows are additionally OR-ed together in bands so that empty regions are
+// rejected before any per-row work is done.
+class CollisionMask {
+private:
+    static const int bandHeight = 8;
+
+    int width;
+    int height;
+    int wordsPerRow;
+    std::vector<std::uint64_t> rows;
+    std::vector<std::uint64_t> bands;
+    // Tight bounds of the set pixels, in mask space
+    sf::IntRect opaqueBounds;
+
+public:
+    CollisionMask();
+
+    // Build a mask from the alpha channel of RGBA8 pixels or an image, resampled to the on-screen scale
+    static CollisionMask fromPixels(const sf::Uint8* pixels, int width, int height, float scaleX = 1.f, float scaleY = 1.f, sf::Uint8 alphaThreshold = 128);
+    static CollisionMask fromImage(const sf::Image& image, float scaleX = 1.f, float scaleY = 1.f, sf::Uint8 alphaThreshold = 128);
+    static CollisionMask fromTexture(const sf::Texture& texture, float scaleX = 1.f, float scaleY = 1.f, sf::Uint8 alphaThreshold = 128);
+    static CollisionMask fromCircle(float radius);
+    // Circle mask shared by every object of the same radius, built on first use
+    static const CollisionMask& sharedCircle(float radius);
+
+    int getWidth() const;
+    int getHeight() const;
+    bool isEmpty() const;
+    bool testPixel(int x, int y) const;
+
+    // Exact silhouette test of two masks whose top-left corners are at the given world positions
+    static bool overlaps(const CollisionMask& a, const sf::Vector2f& positionA, const CollisionMask& b, const sf::Vector2f& positionB);
+
+private:
+    CollisionMask(int _width, int _height);
+
+    void setPixel(int x, int y);
+    void buildLevels();
+    const std::uint64_t* getRow(int y) const;
+    const std::uint64_t* getBand(int band) const;
+
+    // Returns 64 bits of a packed row starting at an arbitrary (possibly negative) bit offset
+    std::uint64_t extractBits(const std::uint64_t* row, int bitOffset) const;
+};
@@ -0,0 +1,244 @@
+//CommandBuffer.cpp
+#include "CommandBuffer.h"
+#include "PrimitiveRenderer.h"
+#include <algorithm>
+
+namespace {
+	const sf::BlendMode& toBlendMode(std::uint8_t blend) {
+		switch (blend) {
+		case CommandBlendAdd:
+			return sf::BlendAdd;
+		case CommandBlendMultiply:
+			return sf::BlendMultiply;
+		case CommandBlendNone:
+			return sf::BlendNone;
+		default:
+			return sf::BlendAlpha;
+		}
+	}
+
+	bool sameState(const DrawCommand& a, const DrawCommand& b) {
+		return a.blend == b.blend && a.type == b.type && a.color == b.color;
+	}
+}
+
+CommandBuffer::CommandBuffer() : layer(0), blend(CommandBlendAlpha) {}
+
+void CommandBuffer::clear() {
+	commands.clear();
+	vertices.clear();
+	layer = 0;
+	blend = CommandBlendAlpha;
+}
+
+std::size_t CommandBuffer::size() const {
+	return commands.size();
+}
+
+bool CommandBuffer::empty() const {
+	return commands.empty();
+}
+
+const std::vector<DrawCommand>& CommandBuffer::getCommands() const {
+	return commands;
+}
+
+void CommandBuffer::setLayer(std::uint16_t _layer) {
+	layer = _layer;
+}
+
+void CommandBuffer::setBlend(CommandBlend _blend) {
+	blend = _blend;
+}
+
+void CommandBuffer::drawRectangle(float x, float y, float width, float height, sf::Color color) {
+	DrawCommand& command = record(CommandRectangle, color);
+	command.values[0] = x;
+	command.values[1] = y;
+	command.values[2] = width;
+	command.values[3] = height;
+}
+
+void CommandBuffer::drawCircle(float x, float y, float radius, sf::Color color) {
+	DrawCommand& command = record(CommandCircle, color);
+	command.values[0] = x;
+	command.values[1] = y;
+	command.values[2] = radius;
+}
+
+void CommandBuffer::drawPoint(float x, float y, sf::Color color) {
+	DrawCommand& command = record(CommandPoint, color);
+	command.values[0] = x;
+	command.values[1] = y;
+}
+
+void CommandBuffer::drawLine(float x1, float y1, float x2, float y2, float thickness, sf::Color color) {
+	DrawCommand& command = record(CommandLine, color);
+	command.values[0] = x1;
+	command.values[1] = y1;
+	command.values[2] = x2;
+	command.values[3] = y2;
+	command.values[4] = thickness;
+}
+
+void CommandBuffer::drawEllipse(float centerX, float centerY, float rx, float ry, sf::Color color) {
+	DrawCommand& command = record(CommandEllipse, color);
+	command.values[0] = centerX;
+	command.values[1] = centerY;
+	command.values[2] = rx;
+	command.values[3] = ry;
+}
+
+void CommandBuffer::drawPolyline(const Vec2* points, std::size_t count, sf::Color color, bool isClosed) {
+	DrawCommand& command = record(CommandPolyline, color);
+	command.flags = isClosed ? CommandClosed : 0;
+	recordVertices(command, points, count);
+}
+
+void CommandBuffer::drawFilledPolygon(const Vec2* points, std::size_t count, sf::Color fillColor) {
+	DrawCommand& command = record(CommandFilledPolygon, fillColor);
+	recordVertices(command, points, count);
+}
+
+void CommandBuffer::sortByState(const std::vector<std::uint16_t>& sortedLayers) {
+	// Ordered by (layer, state in the sorted layers only, recording order), all in one pass so
+	// no layer's grouping is undone by sorting another
+	const auto isSorted = [&sortedLayers](std::uint16_t sortedLayer) {
+		return std::find(sortedLayers.begin(), sortedLayers.end(), sortedLayer) != sortedLayers.end();
+	};
+	std::sort(commands.begin(), commands.end(), [&isSorted](const DrawCommand& a, const DrawCommand& b) {
+		if (a.layer != b.layer) {
+			return a.layer < b.layer;
+		}
+		if (isSorted(a.layer)) {
+			const std::uint64_t keyA = stateKey(a);
+			const std::uint64_t keyB = stateKey(b);
+			if (keyA != keyB) {
+				return keyA < keyB;
+			}
+		}
+		return a.sequence < b.sequence;
+	});
+}
+
+std::size_t CommandBuffer::countStateChanges() const {
+	std::size_t changes = 0;
+	for (std::size_t i = 1; i < commands.size(); ++i) {
+		if (!sameState(commands[i - 1], commands[i])) {
+			++changes;
+		}
+	}
+	return changes;
+}
+
+void CommandBuffer::merge(const std::vector<CommandBuffer>& buffers, CommandBuffer& output) {
+	output.clear();
+	std::size_t commandCount = 0, vertexCount = 0;
+	for (const CommandBuffer& buffer : buffers) {
+		commandCount += buffer.commands.size();
+		vertexCount += buffer.vertices.size();
+	}
+	output.commands.reserve(commandCount);
+	output.vertices.reserve(vertexCount);
+
+	// Concatenating in buffer order and renumbering makes the sequence encode (buffer, recording order)
+	for (const CommandBuffer& buffer : buffers) {
+		const std::uint32_t vertexBase = static_cast<std::uint32_t>(output.vertices.size());
+		for (const DrawCommand& command : buffer.commands) {
+			output.commands.push_back(command);
+			output.commands.back().firstVertex += vertexBase;
+			output.commands.back().sequence = static_cast<std::uint32_t>(output.commands.size() - 1);
+		}
+		output.vertices.insert(output.vertices.end(), buffer.vertices.begin(), buffer.vertices.end());
+	}
+
+	auto byLayer = [](const DrawCommand& a, const DrawCommand& b) {
+		return a.layer < b.layer;
+	};
+	if (!std::is_sorted(output.commands.begin(), output.commands.end(), byLayer)) {
+		std::stable_sort(output.commands.begin(), output.commands.end(), byLayer);
+	}
+}
+
+void CommandBuffer::replay(PrimitiveRenderer& renderer) const {
+	const sf::BlendMode previousBlend = renderer.getBlendMode();
+	int currentBlend = -1;
+
+	for (std::size_t i = 0; i < commands.size(); ++i) {
+		const DrawCommand& command = commands[i];
+		if (command.blend != currentBlend) {
+			currentBlend = command.blend;
+			renderer.setBlendMode(toBlendMode(command.blend));
+		}
+		const sf::Color color(command.color);
+
+		if (isBatched(command.type)) {
+			// The whole run of this state goes out as one vertex array
+			renderer.beginBatch();
+			for (;;) {
+				const float* values = commands[i].values;
+				if (command.type == CommandPoint) {
+					renderer.batchPoint(values[0], values[1], color);
+				}
+				else {
+					renderer.batchLine(values[0], values[1], values[2], values[3], values[4], color);
+				}
+				if (i + 1 == commands.size() || !sameState(commands[i + 1], command)) {
+					break;
+				}
+				++i;
+			}
+			renderer.flushBatch();
+			continue;
+		}
+
+		const float* values = command.values;
+		switch (command.type) {
+		case CommandRectangle:
+			renderer.drawRectangle(values[0], values[1], values[2], values[3], color);
+			break;
+		case CommandCircle:
+			renderer.drawCircle(values[0], values[1], values[2], color);
+			break;
+		case CommandEllipse:
+			renderer.drawEllipse(values[0], values[1], values[2], values[3], color);
+			break;
+		case CommandPolyline:
+			renderer.drawPolyline(vertices.data() + command.firstVertex, command.vertexCount, color, (command.flags & CommandClosed) != 0);
+			break;
+		case CommandFilledPolygon:
+			renderer.drawFilledPolygon(vertices.data() + command.firstVertex, command.vertexCount, color);
+			break;
+		default:
+			break;
+		}
+	}
+
+	renderer.setBlendMode(previousBlend);
+}
+
+DrawCommand& CommandBuffer::record(DrawCommandType type, sf::Color color) {
+	DrawCommand command = {};
+	command.layer = layer;
+	command.type = type;
+	command.blend = blend;
+	command.color = color.toInteger();
+	command.sequence = static_cast<std::uint32_t>(commands.size());
+	commands.push_back(command);
+	return commands.back();
+}
+
+void CommandBuffer::recordVertices(DrawCommand& command, const Vec2* points, std::size_t count) {
+	command.firstVertex = static_cast<std::uint32_t>(vertices.size());
+	command.vertexCount = static_cast<std::uint32_t>(count);
+	vertices.insert(vertices.end(), points, points + count);
+}
+
+bool CommandBuffer::isBatched(std::uint8_t type) {
+	return type == CommandPoint || type == CommandLine;
+}
+
+std::uint64_t CommandBuffer::stateKey(const DrawCommand& command) {
+	return (static_cast<std::uint64_t>(command.layer) << 48) | (static_cast<std::uint64_t>(command.blend) << 40) |
+		(static_cast<std::uint64_t>(command.type) << 32) | command.color;
+}
@@ -0,0 +1,97 @@
+//CommandBuffer.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Geometry.h"
+
+class PrimitiveRenderer;
+
+enum DrawCommandType : std::uint8_t {
+    CommandRectangle,     // x, y, width, height
+    CommandCircle,        // center x, center y, radius
+    CommandPoint,         // x, y
+    CommandLine,          // x1, y1, x2, y2, thickness
+    CommandEllipse,       // center x, center y, radius x, radius y
+    CommandPolyline,      // vertex range, CommandClosed flag
+    CommandFilledPolygon  // vertex range
+};
+
+enum CommandBlend : std::uint8_t {
+    CommandBlendAlpha,
+    CommandBlendAdd,
+    CommandBlendMultiply,
+    CommandBlendNone
+};
+
+enum DrawCommandFlags : std::uint8_t {
+    CommandClosed = 1 << 0
+};
+
+// One recorded draw call. Plain data, so buffers can be copied, merged and sorted freely.
+struct DrawCommand {
+    std::uint16_t layer;
+    std::uint8_t type;
+    std::uint8_t blend;
+    std::uint32_t color;        // sf::Color::toInteger()
+    std::uint32_t sequence;     // recording order, the tie-breaker that keeps sorting stable
+    std::uint32_t firstVertex;  // polylines and polygons: their run of the vertex array
+    std::uint32_t vertexCount;
+    std::uint8_t flags;
+    float values[5];
+};
+
+// Records PrimitiveRenderer draw calls instead of running them, so content can be built once
+// (or on any thread) and replayed any number of times. Layers are always drawn in ascending
+// order; within a layer commands replay in recording order unless sortByState() is used.
+// Replay draws each run of points or lines in one state with a single draw call.
+class CommandBuffer {
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<Vec2> vertices;
+    std::uint16_t layer;
+    CommandBlend blend;
+
+public:
+    CommandBuffer();
+
+    void clear();
+    std::size_t size() const;
+    bool empty() const;
+    const std::vector<DrawCommand>& getCommands() const;
+
+    // State for the commands recorded from now on
+    void setLayer(std::uint16_t _layer);
+    void setBlend(CommandBlend _blend);
+
+    void drawRectangle(float x, float y, float width, float height, sf::Color color);
+    void drawCircle(float x, float y, float radius, sf::Color color);
+    void drawPoint(float x, float y, sf::Color color);
+    void drawLine(float x1, float y1, float x2, float y2, float thickness, sf::Color color);
+    void drawEllipse(float centerX, float centerY, float rx, float ry, sf::Color color);
+    void drawPolyline(const Vec2* points, std::size_t count, sf::Color color, bool isClosed);
+    void drawFilledPolygon(const Vec2* points, std::size_t count, sf::Color fillColor);
+
+    // Group the commands of each of 'sortedLayers' by blend mode, primitive type and color,
+    // keeping recording order among equal states; every other layer keeps its recording order.
+    // Use it only on layers whose overlap order does not matter.
+    void sortByState(const std::vector<std::uint16_t>& sortedLayers);
+    // Number of blend/type/color changes a replay goes through, for measuring the sort; each
+    // is a separate draw call for batched points and lines
+    std::size_t countStateChanges() const;
+
+    // Combine buffers recorded independently (e.g. one per thread) into 'output'.
+    // The result is ordered by layer, then buffer position in 'buffers', then recording order,
+    // so it does not depend on which thread finished first.
+    static void merge(const std::vector<CommandBuffer>& buffers, CommandBuffer& output);
+
+    // Run every command on the renderer; the buffer itself is left unchanged
+    void replay(PrimitiveRenderer& renderer) const;
+
+private:
+    DrawCommand& record(DrawCommandType type, sf::Color color);
+    void recordVertices(DrawCommand& command, const Vec2* points, std::size_t count);
+    static std::uint64_t stateKey(const DrawCommand& command);
+    static bool isBatched(std::uint8_t type);
+};
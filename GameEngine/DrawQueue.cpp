@@ -0,0 +1,140 @@
+//DrawQueue.cpp
+#include "DrawQueue.h"
+#include <cmath>
+
+DrawQueue::DrawQueue() : overdrawReduction(true), occludedCommands(0) {
+}
+
+void DrawQueue::drawSprite(const RleSprite& sprite, float x, float y, float scaleX, float scaleY, RleSprite::Filter filter) {
+	Command command = { SpriteCommand, &sprite, x, y, scaleX, scaleY, filter, sf::Color::White };
+	commands.push_back(command);
+}
+
+void DrawQueue::fillRect(int x, int y, int w, int h, sf::Color color) {
+	Command command = { RectangleCommand, nullptr, static_cast<float>(x), static_cast<float>(y),
+		static_cast<float>(w), static_cast<float>(h), RleSprite::NearestFilter, color };
+	commands.push_back(command);
+}
+
+void DrawQueue::fillCircle(float centerX, float centerY, float radius, sf::Color color) {
+	Command command = { CircleCommand, nullptr, centerX, centerY, radius, radius, RleSprite::NearestFilter, color };
+	commands.push_back(command);
+}
+
+template <typename Format>
+void DrawQueue::flush(BasicFramebuffer<Format>& target, sf::Color clearColor) {
+	occludedCommands = 0;
+	if (!overdrawReduction) {
+		target.clear(clearColor);
+		for (const Command& command : commands) {
+			execute(command, target, RleSprite::AllRuns);
+		}
+		commands.clear();
+		return;
+	}
+
+	// Depth 0 is the background, so command i sits at depth i + 1
+	target.beginOcclusion();
+	for (std::size_t i = commands.size(); i-- > 0;) {
+		const Command& command = commands[i];
+		if (!hasOpaquePart(command)) {
+			continue;
+		}
+		const sf::IntRect bounds = getBounds(command);
+		if (target.isOccluded(bounds.left, bounds.top, bounds.width, bounds.height)) {
+			++occludedCommands;
+			continue;
+		}
+		target.setDepth(static_cast<std::uint32_t>(i + 1));
+		execute(command, target, RleSprite::OpaqueRuns);
+	}
+	target.fillUncovered(clearColor);
+	for (std::size_t i = 0; i < commands.size(); ++i) {
+		const Command& command = commands[i];
+		if (hasTranslucentPart(command)) {
+			target.setDepth(static_cast<std::uint32_t>(i + 1));
+			execute(command, target, RleSprite::TranslucentRuns);
+		}
+	}
+	target.endOcclusion();
+	commands.clear();
+}
+
+void DrawQueue::setOverdrawReduction(bool enabled) {
+	overdrawReduction = enabled;
+}
+
+bool DrawQueue::isOverdrawReductionEnabled() const {
+	return overdrawReduction;
+}
+
+std::size_t DrawQueue::getCommandCount() const {
+	return commands.size();
+}
+
+std::size_t DrawQueue::getOccludedCount() const {
+	return occludedCommands;
+}
+
+bool DrawQueue::hasOpaquePart(const Command& command) {
+	if (command.kind != SpriteCommand) {
+		return command.color.a == 255;
+	}
+	return command.sprite->hasOpaqueRuns() && !isFiltered(command);
+}
+
+bool DrawQueue::hasTranslucentPart(const Command& command) {
+	if (command.kind != SpriteCommand) {
+		return command.color.a > 0 && command.color.a < 255;
+	}
+	return command.sprite->hasTranslucentRuns() || (isFiltered(command) && command.sprite->hasOpaqueRuns());
+}
+
+bool DrawQueue::isFiltered(const Command& command) {
+	// Blits that land exactly on the pixel grid are copied even with bilinear filtering
+	const bool exact = command.width == 1.f && command.height == 1.f && command.x == std::floor(command.x) && command.y == std::floor(command.y);
+	return command.filter == RleSprite::BilinearFilter && !exact;
+}
+
+sf::IntRect DrawQueue::getBounds(const Command& command) {
+	float left = command.x, top = command.y, right, bottom;
+	switch (command.kind) {
+	case SpriteCommand:
+		right = left + command.sprite->getWidth() * command.width;
+		bottom = top + command.sprite->getHeight() * command.height;
+		break;
+	case CircleCommand:
+		left -= command.width;
+		top -= command.width;
+		right = command.x + command.width;
+		bottom = command.y + command.width;
+		break;
+	default:
+		right = left + command.width;
+		bottom = top + command.height;
+		break;
+	}
+	const int x = static_cast<int>(std::floor(left));
+	const int y = static_cast<int>(std::floor(top));
+	return sf::IntRect(x, y, static_cast<int>(std::ceil(right)) - x, static_cast<int>(std::ceil(bottom)) - y);
+}
+
+template <typename Format>
+void DrawQueue::execute(const Command& command, BasicFramebuffer<Format>& target, RleSprite::RunSelection selection) {
+	switch (command.kind) {
+	case SpriteCommand:
+		command.sprite->blitScaled(target, command.x, command.y, command.width, command.height, command.filter, selection);
+		break;
+	case RectangleCommand:
+		target.fillRect(static_cast<int>(command.x), static_cast<int>(command.y),
+			static_cast<int>(command.width), static_cast<int>(command.height), command.color);
+		break;
+	case CircleCommand:
+		target.fillCircle(command.x, command.y, command.width, command.color);
+		break;
+	}
+}
+
+template void DrawQueue::flush(Framebuffer&, sf::Color);
+template void DrawQueue::flush(Rgb565Framebuffer&, sf::Color);
+template void DrawQueue::flush(Rgb332Framebuffer&, sf::Color);
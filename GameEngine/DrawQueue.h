@@ -0,0 +1,69 @@
+//DrawQueue.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Framebuffer.h"
+#include "RleSprite.h"
+
+// Draw commands for the software renderer, collected over a frame in painter's order (later
+// commands in front) and drawn into a framebuffer of any pixel format by flush().
+//
+// With overdraw reduction on, flush() draws the opaque parts of all commands first, front to
+// back, so every pixel is written by the front-most opaque command only and commands whose
+// area is already fully covered are skipped outright. The background colour then fills what
+// is left, and the translucent parts are blended back to front wherever nothing opaque is in
+// front of them. With it off, commands are simply drawn in order over a cleared frame.
+class DrawQueue {
+private:
+    enum CommandKind {
+        SpriteCommand,
+        RectangleCommand,
+        CircleCommand
+    };
+
+    struct Command {
+        CommandKind kind;
+        const RleSprite* sprite;
+        float x;
+        float y;
+        // Scale for sprites, size for rectangles, radius (in width) for circles
+        float width;
+        float height;
+        RleSprite::Filter filter;
+        sf::Color color;
+    };
+
+    std::vector<Command> commands;
+    bool overdrawReduction;
+    std::size_t occludedCommands;
+
+public:
+    DrawQueue();
+
+    // The sprite must stay alive until the next flush
+    void drawSprite(const RleSprite& sprite, float x, float y, float scaleX = 1.f, float scaleY = 1.f,
+        RleSprite::Filter filter = RleSprite::NearestFilter);
+    void fillRect(int x, int y, int w, int h, sf::Color color);
+    void fillCircle(float centerX, float centerY, float radius, sf::Color color);
+
+    // Draw every queued command into 'target' on a background of 'clearColor', then empty the queue
+    template <typename Format>
+    void flush(BasicFramebuffer<Format>& target, sf::Color clearColor);
+
+    void setOverdrawReduction(bool enabled);
+    bool isOverdrawReductionEnabled() const;
+    std::size_t getCommandCount() const;
+    // Commands the last flush skipped because opaque content in front hid them completely
+    std::size_t getOccludedCount() const;
+
+private:
+    static bool hasOpaquePart(const Command& command);
+    static bool hasTranslucentPart(const Command& command);
+    // Bilinear blits off the pixel grid, whose soft edges make every pixel translucent
+    static bool isFiltered(const Command& command);
+    static sf::IntRect getBounds(const Command& command);
+    template <typename Format>
+    static void execute(const Command& command, BasicFramebuffer<Format>& target, RleSprite::RunSelection selection);
+};
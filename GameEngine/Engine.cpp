@@ -8,13 +8,15 @@
 #include <SFML/System.hpp>
 #include <SFML/Window.hpp>
 
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <vector>
 
-Engine::Engine(int width, int height, std::string title) : window(sf::VideoMode(width, height), title), primitiveRenderer(window),
-isRunning(false), logfile("log.txt"),
-framesPerSecond(60), isMouseEnabled(true), isKeyboardEnabled(true) {
+Engine::Engine(int width, int height, std::string title, JobSystem& _jobSystem) : window(sf::VideoMode(width, height), title),
+shownTenths(-1), hasClick(false), isRunning(false), logfile("log.txt"),
+framesPerSecond(60), isMouseEnabled(true), isKeyboardEnabled(true), primitiveRenderer(window), jobSystem(_jobSystem),
+producedFrame(0), consumedFrame(0), isPipelined(false) {
 	// Check if the log file is opened successfully
 	if (!logfile.is_open()) {
 		std::cerr << "Failed to open log file." << std::endl;
@@ -29,11 +31,31 @@ framesPerSecond(60), isMouseEnabled(true), isKeyboardEnabled(true) {
 	text.setFont(font);
 	text.setCharacterSize(24);
 	text.setFillColor(sf::Color::White);
+	text.setPosition(10.f, 10.f);
+	text.setString("Input: ");
+	timeText.setFont(font);
+	timeText.setCharacterSize(24);
+	timeText.setFillColor(sf::Color::White);
+	timeText.setPosition(10.f, 40.f);
 	inputText = "";
 
 	// Initialize render texture
 	renderTexture.create(width, height);
 
+	// A leaf shape: two cubic curves closed by an arc, centered on the origin
+	demoPath.moveTo(0.f, -40.f)
+		.cubicTo(30.f, -30.f, 30.f, 10.f, 0.f, 40.f)
+		.cubicTo(-30.f, 10.f, -30.f, -30.f, 0.f, -40.f)
+		.close()
+		.arc(0.f, 0.f, 50.f, 50.f, 0.f, 270.f);
+	pathNode = transforms.create();
+	transforms.setPosition(pathNode, sf::Vector2f(650.f, 480.f));
+	satelliteNode = transforms.create(pathNode);
+	transforms.setPosition(satelliteNode, sf::Vector2f(90.f, 0.f));
+	transforms.setScale(satelliteNode, sf::Vector2f(0.4f, 0.4f));
+
+	window.setFramerateLimit(framesPerSecond);
+
 }
 
 // Initialize the game engine
@@ -49,6 +71,7 @@ void Engine::setClearColor(sf::Color color) {
 // Set the frames per second for the animation
 void Engine::setFramesPerSecond(int fps) {
 	framesPerSecond = fps;
+	window.setFramerateLimit(framesPerSecond);
 }
 
 // Enable or disable mouse support
@@ -61,75 +84,124 @@ void Engine::setKeyboardEnabled(bool enabled) {
 	isKeyboardEnabled = enabled;
 }
 
+// Enable or disable running the simulation and rendering on separate threads
+void Engine::setPipelined(bool enabled) {
+	isPipelined = enabled;
+}
+
+// Set the game logic update() runs every tick
+void Engine::setUpdateFunction(std::function<void(JobSystem&)> function) {
+	updateFunction = std::move(function);
+}
+
 // Handle various events such as window close, mouse button press, and text input
 void Engine::handleEvents() {
-	sf::Event event;
-	while (window.pollEvent(event)) {
-		if (event.type == sf::Event::Closed) {
-			isRunning = false;
-		}
-		else if (event.type == sf::Event::MouseButtonPressed) {
-			if (event.mouseButton.button == sf::Mouse::Left) {
-				sf::Vector2i mousePosition = sf::Mouse::getPosition(window);
-			}
+	// Events can only be polled on the window thread; the snapshot is applied by update()
+	const InputSnapshot& snapshot = input.poll(window);
+	if (snapshot.closeRequested) {
+		isRunning = false;
+		signalFrameAdvanced();
+	}
+	std::lock_guard<std::mutex> lock(inputMutex);
+	pendingInput.push_back(snapshot);
+}
+
+// Apply one tick of input to the simulation state
+void Engine::applyInput(const InputSnapshot& snapshot) {
+	// Check if mouse and keyboard are enabled
+	if (isMouseEnabled) {
+		if (snapshot.wasMouseButtonPressed(sf::Mouse::Left)) {
+			hasClick = true;
+			clickPosition = snapshot.mousePosition;
 		}
-		else if (event.type == sf::Event::KeyPressed) {
-			if (event.key.code == sf::Keyboard::B) { // Press 'C' to clear the screen to cyan color
-				setClearColor(sf::Color::Black);
-			}
+	}
+
+	if (isKeyboardEnabled) {
+		if (snapshot.wasKeyPressed(sf::Keyboard::B)) { // Press 'C' to clear the screen to cyan color
+			setClearColor(sf::Color::Black);
 		}
-		else if (event.type == sf::Event::TextEntered) {
-			if (event.text.unicode < 128) {
-				if (event.text.unicode == '\b') {
+		for (std::uint32_t character : snapshot.text) {
+			if (character < 128) {
+				if (character == '\b') {
 					if (!inputText.empty()) {
 						inputText.pop_back();
 					}
 				}
 				else {
-					inputText += event.text.unicode;
+					inputText += static_cast<char>(character);
 				}
 			}
 		}
 	}
 }
 
-// Update the game logic
+// Update the game logic and publish the result as the next frame
 void Engine::update() {
-	// Set frame rate limit
-	window.setFramerateLimit(framesPerSecond);
-	// Check if mouse and keyboard are enabled
-	if (isMouseEnabled) {
-		// Handle mouse input
+	{
+		std::lock_guard<std::mutex> lock(inputMutex);
+		inputToApply.swap(pendingInput);
 	}
+	for (const InputSnapshot& snapshot : inputToApply) {
+		applyInput(snapshot);
+	}
+	inputToApply.clear();
 
-	if (isKeyboardEnabled) {
-		// Handle keyboard input
+	// Game logic, free to split its work over the shared job system
+	if (updateFunction) {
+		updateFunction(jobSystem);
 	}
 
-	// Update game logic here
+	// Write the frame into the buffer the renderer is not reading, then hand it over
+	long long frame = producedFrame.load(std::memory_order_relaxed) + 1;
+	FrameState& state = frameStates[frame % 2];
+	state.clearColor = clearColor;
+	state.inputText = inputText;
+	state.elapsedSeconds = clock.getElapsedTime().asSeconds();
+	state.hasClick = hasClick;
+	state.clickPosition = clickPosition;
+	producedFrame.store(frame, std::memory_order_release);
+	signalFrameAdvanced();
 }
 
 // Render the game, including the button, input text, and elapsed time
 void Engine::render() {
+	long long frame = producedFrame.load(std::memory_order_acquire);
+	if (isPipelined) {
+		frame = consumedFrame.load(std::memory_order_relaxed) + 1;
+	}
+	const FrameState& state = frameStates[frame % 2];
+
 	// Clear the main window
-	window.clear(clearColor);
+	window.clear(state.clearColor);
+
+	sceneCommands.replay(primitiveRenderer);
 
 	// Draw using the PrimitiveRenderer
 	primitiveRenderer.drawLine(400.f, 400.f, 500.f, 500.f, 5.f, sf::Color::Blue);
 
-	// Draw the input text
-	text.setString("Input: " + inputText);
-	text.setPosition(10.f, 10.f);
+	// Draw the input text; setString rebuilds the text's glyphs, so only call it on a change
+	if (state.inputText != shownInputText) {
+		shownInputText = state.inputText;
+		textBuffer.assign("Input: ");
+		textBuffer += shownInputText;
+		text.setString(textBuffer);
+	}
 	window.draw(text);
 
 	// Create a Point2D instance and draw it using PrimitiveRenderer
 	Point2D point(300.f, 100.f);
 	point.draw(primitiveRenderer, sf::Color::White);
 
+	// Mark the last left click
+	if (state.hasClick) {
+		Point2D clickPoint(static_cast<float>(state.clickPosition.x), static_cast<float>(state.clickPosition.y));
+		clickPoint.draw(primitiveRenderer, sf::Color::Red);
+	}
+
 	Point2D startPoint(500.f, 200.f);
 
 	// Update line length based on elapsed time
-	float lineLength = 100.f + std::sin(clock.getElapsedTime().asSeconds()) * 100.f;
+	float lineLength = 100.f + std::sin(state.elapsedSeconds) * 100.f;
 	Point2D endPoint(startPoint.getX() + lineLength, startPoint.getY() + lineLength);
 
 	LineSegment lineSegment(startPoint, endPoint);
@@ -140,18 +212,31 @@ void Engine::render() {
 
 	// Draw an open polyline using a vector of Point2D
 
-	std::vector<LineSegment> openPolygonSegments = {
-	LineSegment({250.f, 200.f}, {250.f, 250.f}),
-	LineSegment({250.f, 250.f}, {300.f, 200.f}),
-	LineSegment({300.f, 200.f}, {300.f, 300.f})
-	};
+	std::vector<LineSegment>& openPolygonSegments = segmentPool.acquire();
+	openPolygonSegments.push_back(LineSegment({ 250.f, 200.f }, { 250.f, 250.f }));
+	openPolygonSegments.push_back(LineSegment({ 250.f, 250.f }, { 300.f, 200.f }));
+	openPolygonSegments.push_back(LineSegment({ 300.f, 200.f }, { 300.f, 300.f }));
 	primitiveRenderer.drawPolyline(openPolygonSegments, sf::Color::Magenta, false);
 
 	primitiveRenderer.drawEllipse(500.f, 300.f, 50.f, 30.f, sf::Color::Green);
 
 	primitiveRenderer.drawCircleSymmetrical(700.f, 300.f, 50.f, sf::Color::Yellow);
 
-	std::vector<Point2D> closedPolyLinePoints = { {100.f, 200.f}, {150.f, 150.f}, {200.f, 200.f}, {200.f, 300.f}, {200.f, 500.f} };
+	// Spin and pulse the path; only the transforms change from frame to frame, and the
+	// satellite's world matrix follows its parent's without being set itself
+	const float pathScale = 1.f + 0.5f * std::sin(state.elapsedSeconds * 0.5f);
+	transforms.setRotation(pathNode, state.elapsedSeconds * 180.f / 3.141592654f);
+	transforms.setScale(pathNode, sf::Vector2f(pathScale, pathScale));
+	transforms.update();
+	primitiveRenderer.drawPath(demoPath, transforms.getWorld(pathNode), sf::Color::Green);
+	primitiveRenderer.drawPath(demoPath, transforms.getWorld(satelliteNode), sf::Color::Yellow);
+
+	std::vector<Point2D>& closedPolyLinePoints = pointPool.acquire();
+	closedPolyLinePoints.push_back({ 100.f, 200.f });
+	closedPolyLinePoints.push_back({ 150.f, 150.f });
+	closedPolyLinePoints.push_back({ 200.f, 200.f });
+	closedPolyLinePoints.push_back({ 200.f, 300.f });
+	closedPolyLinePoints.push_back({ 200.f, 500.f });
 
 	// Use the borderFill and floodFill methods to fill areas
 	primitiveRenderer.borderFill(75, 75, sf::Color::Yellow, sf::Color::White); // Example of borderFill
@@ -163,29 +248,211 @@ void Engine::render() {
 
 	primitiveRenderer.floodFill(100, 300, sf::Color::Black, sf::Color::Red);
 	primitiveRenderer.borderFill(400, 400, sf::Color::Black, sf::Color::Red);
-	sf::Time elapsed = clock.getElapsedTime();
-	std::string timeString = "Elapsed Time: " + std::to_string(elapsed.asSeconds());
-	sf::Text timeText(timeString, font, 24);
-	timeText.setFillColor(sf::Color::White);
-	timeText.setPosition(10.f, 40.f);
+	// Shown to a tenth of a second, so the text changes ten times a second instead of every frame
+	const long long tenths = static_cast<long long>(state.elapsedSeconds * 10.f);
+	if (tenths != shownTenths) {
+		shownTenths = tenths;
+		char timeString[32];
+		std::snprintf(timeString, sizeof(timeString), "Elapsed Time: %lld.%lld", tenths / 10, tenths % 10);
+		timeText.setString(timeString);
+	}
 	window.draw(timeText);
 
+	// Queue the frame for capture before display() swaps it away
+	capture.captureFrame();
+
 	window.display(); // Display the main window
 
+	// Hand the frame temporaries back for the next frame
+	segmentPool.releaseAll();
+	pointPool.releaseAll();
+	primitiveRenderer.endFrame();
+	consumedFrame.store(frame, std::memory_order_release);
+	signalFrameAdvanced();
+
 }
 
 // Run the game loop
 void Engine::run() {
-	while (isRunning) {
-		handleEvents();
-		update();
-		render();
+	if (isPipelined) {
+		runPipelined();
+	}
+	else {
+		while (isRunning) {
+			handleEvents();
+			update();
+			render();
+		}
 	}
 	// Clean up resources and close the log file
+	stopCapture();
 	logfile.close();
 	window.close();
 }
 
+// Simulate frame N+1 on a second thread while this thread renders frame N.
+// The two threads hand frames over through producedFrame/consumedFrame only, and the
+// simulation never gets more than one frame ahead, so latency stays bounded. A thread that
+// has to wait for the other sleeps on frameAdvanced.
+void Engine::runPipelined() {
+	std::thread simulationThread([this]() {
+		while (isRunning) {
+			// Frame N goes to buffer N % 2, which is free once frame N - 2 has been rendered
+			long long frame = producedFrame.load(std::memory_order_relaxed) + 1;
+			{
+				std::unique_lock<std::mutex> lock(frameMutex);
+				frameAdvanced.wait(lock, [this, frame]() {
+					return !isRunning || consumedFrame.load(std::memory_order_acquire) >= frame - 2;
+				});
+			}
+			if (!isRunning) {
+				break;
+			}
+			update();
+		}
+	});
+
+	while (isRunning) {
+		handleEvents();
+		long long frame = consumedFrame.load(std::memory_order_relaxed) + 1;
+		{
+			std::unique_lock<std::mutex> lock(frameMutex);
+			frameAdvanced.wait(lock, [this, frame]() {
+				return !isRunning || producedFrame.load(std::memory_order_acquire) >= frame;
+			});
+		}
+		if (!isRunning) {
+			break;
+		}
+		render();
+	}
+
+	simulationThread.join();
+}
+
+void Engine::signalFrameAdvanced() {
+	// Taking the lock orders the change before a waiter's check, so the wake-up cannot be missed
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+	}
+	frameAdvanced.notify_all();
+}
+
+// Map a scene file; its geometry is drawn under everything else each frame
+bool Engine::loadScene(const std::string& path) {
+	if (!scene.open(path)) {
+		logError("Error loading scene " + path);
+		return false;
+	}
+	recordScene();
+	return true;
+}
+
+// Scene content never changes, so it is recorded once: each worker records a range of
+// records into its own buffer, and the buffers are merged in range order
+void Engine::recordScene() {
+	const size_t grainSize = 4096;
+	const size_t itemCount = scene.getPoints().size() + scene.getSegments().size() + scene.getPolygons().size() + scene.getInstances().size();
+	std::vector<CommandBuffer> ranges((itemCount + grainSize - 1) / grainSize);
+	jobSystem.parallelFor(itemCount, grainSize, [this, &ranges, grainSize](size_t begin, size_t end) {
+		CommandBuffer& commands = ranges[begin / grainSize];
+		for (size_t i = begin; i < end; ++i) {
+			recordSceneItem(i, commands);
+		}
+	});
+	CommandBuffer::merge(ranges, sceneCommands);
+	// Regroup only the layers whose draw order cannot show, so their runs replay as few batched
+	// draw calls; overlapping polygons and instances of different colours keep the file's order
+	sceneCommands.sortByState(std::vector<std::uint16_t>{ ScenePoints, SceneSegments });
+}
+
+// Record one scene record; indices run through points, segments, polygons and instances in turn
+void Engine::recordSceneItem(size_t index, CommandBuffer& commands) const {
+	const ArrayView<Vec2>& points = scene.getPoints();
+	if (index < points.size()) {
+		commands.setLayer(ScenePoints);
+		commands.drawPoint(points[index].x, points[index].y, sf::Color::White);
+		return;
+	}
+	index -= points.size();
+
+	const ArrayView<Segment>& segments = scene.getSegments();
+	if (index < segments.size()) {
+		const Segment& segment = segments[index];
+		commands.setLayer(SceneSegments);
+		commands.drawLine(segment.start.x, segment.start.y, segment.end.x, segment.end.y, 1.f, sf::Color::White);
+		return;
+	}
+	index -= segments.size();
+
+	const ArrayView<ScenePolygon>& polygons = scene.getPolygons();
+	if (index < polygons.size()) {
+		const ScenePolygon& polygon = polygons[index];
+		ArrayView<Vec2> vertices = scene.getPolygonVertices(polygon);
+		sf::Color color(polygon.color);
+		commands.setLayer(ScenePolygons);
+		if (polygon.flags & ScenePolygonFilled) {
+			commands.drawFilledPolygon(vertices.data(), vertices.size(), color);
+		}
+		else {
+			commands.drawPolyline(vertices.data(), vertices.size(), color, (polygon.flags & ScenePolygonClosed) != 0);
+		}
+		return;
+	}
+	index -= polygons.size();
+
+	const SceneInstance& instance = scene.getInstances()[index];
+	sf::Color color(instance.color);
+	commands.setLayer(SceneInstances);
+	switch (instance.kind) {
+	case SceneCircle:
+		commands.drawCircle(instance.position.x, instance.position.y, instance.size.x, color);
+		break;
+	case SceneRectangle:
+		commands.drawRectangle(instance.position.x, instance.position.y, instance.size.x, instance.size.y, color);
+		break;
+	case SceneEllipse:
+		commands.drawEllipse(instance.position.x, instance.position.y, instance.size.x, instance.size.y, color);
+		break;
+	default:
+		break;
+	}
+}
+
+// Start recording frames; readback and encoding stay off the render path
+bool Engine::startCapture(const CaptureSettings& settings) {
+	window.setActive(true);
+	if (!capture.start(settings, window.getSize().x, window.getSize().y)) {
+		logError("Error starting frame capture to " + settings.path);
+		return false;
+	}
+	if (!capture.isUsingPixelBuffers()) {
+		logError("Pixel buffers unavailable, frame capture reads back synchronously");
+	}
+	return true;
+}
+
+// Finish writing the captured frames and report how many were lost
+void Engine::stopCapture() {
+	if (!capture.isCapturing()) {
+		return;
+	}
+	window.setActive(true);
+	capture.stop();
+	logfile << "Frame capture: " << capture.getCapturedCount() << " captured, " << capture.getWrittenCount() << " written, "
+		<< capture.getDroppedCount() << " dropped, " << capture.getAverageFrameCost().asMicroseconds() << " us per frame" << std::endl;
+}
+
+// Access the job system that fans update work out across cores
+JobSystem& Engine::getJobSystem() {
+	return jobSystem;
+}
+
+// Access the input system used to build, record and replay input snapshots
+InputSystem& Engine::getInput() {
+	return input;
+}
+
 // Log errors to the console and the log file
 void Engine::logError(const std::string& errorMessage) {
 	std::cerr << errorMessage << std::endl;
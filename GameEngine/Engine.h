@@ -1,7 +1,31 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "PrimitiveRenderer.h"
+#include "ObjectPool.h"
+#include "JobSystem.h"
+#include "InputSystem.h"
+#include "Scene.h"
+#include "CommandBuffer.h"
+#include "FrameCapture.h"
+#include "TransformHierarchy.h"
+
+// Everything render() needs from the simulation for one frame
+struct FrameState {
+    sf::Color clearColor;
+    std::string inputText;
+    float elapsedSeconds;
+    bool hasClick;
+    sf::Vector2i clickPosition;
+
+    FrameState() : clearColor(sf::Color::Black), elapsedSeconds(0.f), hasClick(false) {}
+};
 
 class Engine {
 private:
@@ -9,9 +33,16 @@ private:
     sf::Color clearColor;
     sf::Font font;
     sf::Text text;
+    sf::Text timeText;
     std::string inputText;
+    std::string textBuffer;
+    // What the HUD texts show, so they are only rebuilt when it changes
+    std::string shownInputText;
+    long long shownTenths;
+    bool hasClick;
+    sf::Vector2i clickPosition;
     sf::Clock clock;
-    bool isRunning;
+    std::atomic<bool> isRunning;
     std::ofstream logfile;
     int framesPerSecond;
     bool isMouseEnabled;
@@ -20,18 +51,73 @@ private:
     sf::Sprite activeSprite;
     sf::Sprite inactiveSprite;
     PrimitiveRenderer primitiveRenderer;
+    // Per-frame geometry temporaries, recycled every frame
+    VectorPool<LineSegment> segmentPool;
+    VectorPool<Point2D> pointPool;
+    // Owned by the program, so the engine and the game share one worker pool
+    JobSystem& jobSystem;
+    // Game logic run by update() every tick
+    std::function<void(JobSystem&)> updateFunction;
+
+    // Double-buffered simulation output: frame N lives in frameStates[N % 2]
+    FrameState frameStates[2];
+    std::atomic<long long> producedFrame;
+    std::atomic<long long> consumedFrame;
+    // Signalled whenever producedFrame or consumedFrame advances or the loop stops, so a
+    // pipelined thread waiting for the other one sleeps instead of spinning
+    std::mutex frameMutex;
+    std::condition_variable frameAdvanced;
+    bool isPipelined;
+    // Input snapshots built on the window thread, applied by update()
+    InputSystem input;
+    std::mutex inputMutex;
+    std::vector<InputSnapshot> pendingInput;
+    std::vector<InputSnapshot> inputToApply;
+    // Level geometry, recorded once from the mapped scene file and replayed every frame
+    SceneFile scene;
+    CommandBuffer sceneCommands;
+    // Curved outline animated by its transform only, so its flattening stays cached
+    Path demoPath;
+    // Placement of the demo path and of a smaller copy attached to it, which follows its spin
+    TransformHierarchy transforms;
+    TransformHierarchy::NodeId pathNode;
+    TransformHierarchy::NodeId satelliteNode;
+    // Records the rendered frames to disk when started
+    FrameCapture capture;
 
 public:
-    Engine(int width, int height, std::string title);
+    Engine(int width, int height, std::string title, JobSystem& _jobSystem);
 
     void initialize();
     void setClearColor(sf::Color color);
     void setFramesPerSecond(int fps);
     void setMouseEnabled(bool enabled);
     void setKeyboardEnabled(bool enabled);
+    // Run update() on its own thread, one frame ahead of render()
+    void setPipelined(bool enabled);
+    // Game logic for update(); it is handed the job system to spread its work over
+    void setUpdateFunction(std::function<void(JobSystem&)> function);
     void handleEvents();
     void update();
     void render();
     void run();
     void logError(const std::string& errorMessage);
+    // Scheduler for update work that can run in parallel
+    JobSystem& getJobSystem();
+    // Input source; start recording or replaying through it before run()
+    InputSystem& getInput();
+    // Map a scene file to draw every frame; call before run()
+    bool loadScene(const std::string& path);
+    // Record every rendered frame (minus skipped ones) in the background; must be called
+    // on the thread that renders
+    bool startCapture(const CaptureSettings& settings);
+    void stopCapture();
+
+private:
+    void applyInput(const InputSnapshot& snapshot);
+    void runPipelined();
+    // Wake the pipelined thread waiting in runPipelined()
+    void signalFrameAdvanced();
+    void recordScene();
+    void recordSceneItem(size_t index, CommandBuffer& commands) const;
 };
@@ -0,0 +1,88 @@
+//FrameArena.cpp
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t _blockSize) : blockSize(_blockSize), currentBlock(0), blockOffset(0),
+bytesUsed(0), highWaterMark(0) {}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	while (true) {
+		if (currentBlock < blocks.size()) {
+			Block& block = blocks[currentBlock];
+			std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.data.get());
+			std::uintptr_t aligned = (base + blockOffset + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+			size_t end = static_cast<size_t>(aligned - base) + size;
+
+			if (end <= block.size) {
+				bytesUsed += end - blockOffset;
+				blockOffset = end;
+				highWaterMark = std::max(highWaterMark, bytesUsed);
+				return reinterpret_cast<void*>(aligned);
+			}
+
+			// Does not fit, try the next block that is already allocated
+			if (currentBlock + 1 < blocks.size()) {
+				currentBlock++;
+				blockOffset = 0;
+				continue;
+			}
+		}
+
+		addBlock(size + alignment);
+		currentBlock = blocks.size() - 1;
+		blockOffset = 0;
+	}
+}
+
+void FrameArena::reset() {
+	// After a frame that needed several blocks, replace them with one that fits everything
+	if (blocks.size() > 1) {
+		size_t total = 0;
+		for (const Block& block : blocks) {
+			total += block.size;
+		}
+		blocks.clear();
+		addBlock(total);
+	}
+	currentBlock = 0;
+	blockOffset = 0;
+	bytesUsed = 0;
+}
+
+FrameArena::Marker FrameArena::getMarker() const {
+	Marker marker;
+	marker.block = currentBlock;
+	marker.offset = blockOffset;
+	marker.bytesUsed = bytesUsed;
+	return marker;
+}
+
+void FrameArena::rewind(const Marker& marker) {
+	currentBlock = marker.block;
+	blockOffset = marker.offset;
+	bytesUsed = marker.bytesUsed;
+}
+
+size_t FrameArena::getBytesUsed() const {
+	return bytesUsed;
+}
+
+size_t FrameArena::getHighWaterMark() const {
+	return highWaterMark;
+}
+
+size_t FrameArena::getCapacity() const {
+	size_t total = 0;
+	for (const Block& block : blocks) {
+		total += block.size;
+	}
+	return total;
+}
+
+void FrameArena::addBlock(size_t minimumSize) {
+	Block block;
+	block.size = std::max(blockSize, minimumSize);
+	block.data.reset(new unsigned char[block.size]);
+	blocks.push_back(std::move(block));
+}
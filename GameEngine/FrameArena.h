@@ -0,0 +1,102 @@
+//FrameArena.h
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Linear (bump) allocator for scratch memory that only lives for one frame.
+// Allocation is a pointer increment, individual frees are no-ops and everything is
+// released at once by reset(). Blocks are kept between frames, so after warm-up a
+// frame does not touch the heap at all.
+class FrameArena {
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t currentBlock;
+    size_t blockOffset;
+    size_t bytesUsed;
+    size_t highWaterMark;
+
+public:
+    // Position inside the arena that can be returned to with rewind()
+    struct Marker {
+        size_t block;
+        size_t offset;
+        size_t bytesUsed;
+    };
+
+    // Releases everything allocated after its construction when it goes out of scope
+    class Scope {
+    private:
+        FrameArena& arena;
+        Marker marker;
+
+    public:
+        explicit Scope(FrameArena& _arena) : arena(_arena), marker(_arena.getMarker()) {}
+        ~Scope() { arena.rewind(marker); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    explicit FrameArena(size_t _blockSize = 64 * 1024);
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    // Frees everything; call at the end of every frame
+    void reset();
+
+    Marker getMarker() const;
+    void rewind(const Marker& marker);
+
+    size_t getBytesUsed() const;
+    // Largest number of bytes that were in use at the same time since construction
+    size_t getHighWaterMark() const;
+    size_t getCapacity() const;
+
+private:
+    void addBlock(size_t minimumSize);
+};
+
+// STL allocator adapter so standard containers can draw their storage from a FrameArena
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    FrameArena* arena;
+
+    explicit ArenaAllocator(FrameArena& _arena) : arena(&_arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {
+        // Memory is reclaimed when the arena is reset
+    }
+
+    template <typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
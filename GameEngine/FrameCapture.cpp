@@ -0,0 +1,333 @@
+//FrameCapture.cpp
+#include "FrameCapture.h"
+#include <SFML/OpenGL.hpp>
+#include <SFML/Window.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+
+namespace {
+	// Pixel buffer objects are OpenGL 2.1; their entry points have to be looked up at run time
+	typedef void (APIENTRY* GenBuffersFunction)(GLsizei, GLuint*);
+	typedef void (APIENTRY* DeleteBuffersFunction)(GLsizei, const GLuint*);
+	typedef void (APIENTRY* BindBufferFunction)(GLenum, GLuint);
+	typedef void (APIENTRY* BufferDataFunction)(GLenum, GLsizeiptr, const void*, GLenum);
+	typedef void* (APIENTRY* MapBufferFunction)(GLenum, GLenum);
+	typedef GLboolean(APIENTRY* UnmapBufferFunction)(GLenum);
+	typedef void (APIENTRY* ReadPixelsFunction)(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void*);
+	typedef void (APIENTRY* PixelStoreFunction)(GLenum, GLint);
+
+	GenBuffersFunction genBuffers = nullptr;
+	DeleteBuffersFunction deleteBuffers = nullptr;
+	BindBufferFunction bindBuffer = nullptr;
+	BufferDataFunction bufferData = nullptr;
+	MapBufferFunction mapBuffer = nullptr;
+	UnmapBufferFunction unmapBuffer = nullptr;
+	ReadPixelsFunction readPixels = nullptr;
+	PixelStoreFunction pixelStore = nullptr;
+
+	template <typename Function>
+	bool loadFunction(Function& function, const char* name) {
+		function = reinterpret_cast<Function>(sf::Context::getFunction(name));
+		return function != nullptr;
+	}
+
+	std::uint8_t clampByte(int value) {
+		return static_cast<std::uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+}
+
+FrameCapture::FrameCapture()
+	: width(0), height(0), capturing(false), usePixelBuffers(false), frameCounter(0), captureCounter(0),
+	stopping(false), capturedCount(0), droppedCount(0), writtenCount(0), mainThreadMicroseconds(0) {}
+
+FrameCapture::~FrameCapture() {
+	stop();
+}
+
+bool FrameCapture::start(const CaptureSettings& _settings, unsigned _width, unsigned _height) {
+	stop();
+	if (_width == 0 || _height == 0 || !loadFunction(readPixels, "glReadPixels") || !loadFunction(pixelStore, "glPixelStorei")) {
+		return false;
+	}
+
+	settings = _settings;
+	settings.ringSize = std::max(1u, settings.ringSize);
+	settings.bufferCount = std::max(1u, settings.bufferCount);
+	width = _width;
+	height = _height;
+
+	if (settings.format != CapturePng) {
+		stream.open(settings.path, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			return false;
+		}
+	}
+
+	const std::size_t frameBytes = static_cast<std::size_t>(width) * height * 4;
+	buffers.assign(settings.bufferCount, std::vector<std::uint8_t>(frameBytes));
+	freeBuffers.clear();
+	for (std::size_t i = 0; i < buffers.size(); ++i) {
+		freeBuffers.push_back(i);
+	}
+	encodeQueue.clear();
+
+	usePixelBuffers = loadPixelBufferFunctions();
+	if (usePixelBuffers) {
+		pixelBuffers.assign(settings.ringSize, 0);
+		genBuffers(static_cast<GLsizei>(pixelBuffers.size()), pixelBuffers.data());
+		for (unsigned pixelBuffer : pixelBuffers) {
+			bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffer);
+			bufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frameBytes), nullptr, GL_STREAM_READ);
+		}
+		bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slotFrames.assign(settings.ringSize, 0);
+	}
+
+	frameCounter = 0;
+	captureCounter = 0;
+	capturedCount = 0;
+	droppedCount = 0;
+	writtenCount = 0;
+	mainThreadMicroseconds = 0;
+	stopping = false;
+	capturing = true;
+	encoder = std::thread(&FrameCapture::encoderLoop, this);
+	return true;
+}
+
+void FrameCapture::captureFrame() {
+	if (!capturing) {
+		return;
+	}
+	if (frameCounter++ % (settings.frameSkip + 1) != 0) {
+		return;
+	}
+	sf::Clock cost;
+	++capturedCount;
+	const std::uint64_t frame = ++captureCounter;
+	pixelStore(GL_PACK_ALIGNMENT, 1);
+
+	if (usePixelBuffers) {
+		// The slot's previous readback was queued ringSize captures ago and is complete by now
+		const std::size_t slot = static_cast<std::size_t>(frame % pixelBuffers.size());
+		collectSlot(slot);
+		bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+		readPixels(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slotFrames[slot] = frame;
+	}
+	else {
+		std::size_t buffer;
+		if (acquireBuffer(buffer)) {
+			readPixels(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE, buffers[buffer].data());
+			submit(buffer, frame);
+		}
+	}
+	mainThreadMicroseconds += cost.getElapsedTime().asMicroseconds();
+}
+
+void FrameCapture::stop() {
+	if (!capturing) {
+		return;
+	}
+	if (usePixelBuffers) {
+		// Collect what is still in flight, oldest first
+		const std::size_t slotCount = pixelBuffers.size();
+		for (std::size_t i = 1; i <= slotCount; ++i) {
+			collectSlot(static_cast<std::size_t>((captureCounter + i) % slotCount));
+		}
+		deleteBuffers(static_cast<GLsizei>(pixelBuffers.size()), pixelBuffers.data());
+		pixelBuffers.clear();
+		slotFrames.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	frameReady.notify_one();
+	encoder.join();
+	stream.close();
+	capturing = false;
+}
+
+bool FrameCapture::isCapturing() const {
+	return capturing;
+}
+
+bool FrameCapture::isUsingPixelBuffers() const {
+	return usePixelBuffers;
+}
+
+std::uint64_t FrameCapture::getCapturedCount() const {
+	return capturedCount;
+}
+
+std::uint64_t FrameCapture::getDroppedCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return droppedCount;
+}
+
+std::uint64_t FrameCapture::getWrittenCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return writtenCount;
+}
+
+sf::Time FrameCapture::getAverageFrameCost() const {
+	return capturedCount == 0 ? sf::Time::Zero : sf::microseconds(mainThreadMicroseconds / static_cast<std::int64_t>(capturedCount));
+}
+
+bool FrameCapture::loadPixelBufferFunctions() {
+	return loadFunction(genBuffers, "glGenBuffers") && loadFunction(deleteBuffers, "glDeleteBuffers") &&
+		loadFunction(bindBuffer, "glBindBuffer") && loadFunction(bufferData, "glBufferData") &&
+		loadFunction(mapBuffer, "glMapBuffer") && loadFunction(unmapBuffer, "glUnmapBuffer");
+}
+
+void FrameCapture::collectSlot(std::size_t slot) {
+	const std::uint64_t frame = slotFrames[slot];
+	if (frame == 0) {
+		return;
+	}
+	slotFrames[slot] = 0;
+
+	std::size_t buffer;
+	if (!acquireBuffer(buffer)) {
+		return;
+	}
+	bindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+	const void* pixels = mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (pixels) {
+		std::memcpy(buffers[buffer].data(), pixels, buffers[buffer].size());
+		unmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (pixels) {
+		submit(buffer, frame);
+	}
+	else {
+		std::lock_guard<std::mutex> lock(mutex);
+		freeBuffers.push_back(buffer);
+		++droppedCount;
+	}
+}
+
+bool FrameCapture::acquireBuffer(std::size_t& buffer) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (freeBuffers.empty()) {
+		// The encoder is behind; losing this frame is better than waiting for it
+		++droppedCount;
+		return false;
+	}
+	buffer = freeBuffers.back();
+	freeBuffers.pop_back();
+	return true;
+}
+
+void FrameCapture::submit(std::size_t buffer, std::uint64_t frame) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		PendingFrame pending = { buffer, frame };
+		encodeQueue.push_back(pending);
+	}
+	frameReady.notify_one();
+}
+
+void FrameCapture::encoderLoop() {
+	for (;;) {
+		PendingFrame pending;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameReady.wait(lock, [this]() { return stopping || !encodeQueue.empty(); });
+			if (encodeQueue.empty()) {
+				return;
+			}
+			pending = encodeQueue.front();
+			encodeQueue.pop_front();
+		}
+
+		encode(buffers[pending.buffer], pending.frame);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		freeBuffers.push_back(pending.buffer);
+		++writtenCount;
+	}
+}
+
+void FrameCapture::encode(std::vector<std::uint8_t>& pixels, std::uint64_t frame) {
+	// OpenGL returns rows bottom-up
+	const std::size_t rowBytes = static_cast<std::size_t>(width) * 4;
+	auto row = [&pixels, rowBytes, this](unsigned y) {
+		return pixels.data() + (height - 1 - y) * rowBytes;
+	};
+
+	if (settings.format == CapturePng) {
+		sf::Image image;
+		scratch.resize(pixels.size());
+		for (unsigned y = 0; y < height; ++y) {
+			std::memcpy(scratch.data() + y * rowBytes, row(y), rowBytes);
+		}
+		image.create(width, height, scratch.data());
+		char name[32];
+		std::snprintf(name, sizeof(name), "_%06llu.png", static_cast<unsigned long long>(frame));
+		image.saveToFile(settings.path + name);
+		return;
+	}
+
+	if (settings.format == CaptureRgb) {
+		scratch.resize(static_cast<std::size_t>(width) * height * 3);
+		std::uint8_t* out = scratch.data();
+		for (unsigned y = 0; y < height; ++y) {
+			const std::uint8_t* in = row(y);
+			for (unsigned x = 0; x < width; ++x, in += 4, out += 3) {
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+			}
+		}
+		stream.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+		return;
+	}
+
+	// I420: full-resolution luma, then chroma averaged over 2x2 blocks (BT.601, studio range)
+	const unsigned chromaWidth = (width + 1) / 2;
+	const unsigned chromaHeight = (height + 1) / 2;
+	const std::size_t lumaSize = static_cast<std::size_t>(width) * height;
+	const std::size_t chromaSize = static_cast<std::size_t>(chromaWidth) * chromaHeight;
+	scratch.resize(lumaSize + 2 * chromaSize);
+	std::uint8_t* luma = scratch.data();
+	std::uint8_t* chromaU = luma + lumaSize;
+	std::uint8_t* chromaV = chromaU + chromaSize;
+
+	for (unsigned y = 0; y < height; ++y) {
+		const std::uint8_t* in = row(y);
+		for (unsigned x = 0; x < width; ++x, in += 4) {
+			luma[y * width + x] = clampByte(((66 * in[0] + 129 * in[1] + 25 * in[2] + 128) >> 8) + 16);
+		}
+	}
+	for (unsigned cy = 0; cy < chromaHeight; ++cy) {
+		const std::uint8_t* top = row(cy * 2);
+		const std::uint8_t* bottom = row(std::min(cy * 2 + 1, height - 1));
+		for (unsigned cx = 0; cx < chromaWidth; ++cx) {
+			const std::size_t left = static_cast<std::size_t>(cx) * 8;
+			const std::size_t right = static_cast<std::size_t>(std::min(cx * 2 + 1, width - 1)) * 4;
+			int r = (top[left] + top[right] + bottom[left] + bottom[right] + 2) / 4;
+			int g = (top[left + 1] + top[right + 1] + bottom[left + 1] + bottom[right + 1] + 2) / 4;
+			int b = (top[left + 2] + top[right + 2] + bottom[left + 2] + bottom[right + 2] + 2) / 4;
+			chromaU[cy * chromaWidth + cx] = clampByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			chromaV[cy * chromaWidth + cx] = clampByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+	stream.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+}
@@ -0,0 +1,103 @@
+//FrameCapture.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum CaptureFormat {
+    CapturePng,     // one numbered PNG per frame: <path>_000001.png
+    CaptureRgb,     // packed 8-bit RGB frames appended to <path>
+    CaptureYuv420   // planar I420 frames appended to <path>
+};
+
+struct CaptureSettings {
+    std::string path;
+    CaptureFormat format;
+    // Frames to leave out between two captured frames (1 halves the frame rate)
+    unsigned frameSkip;
+    // Readbacks in flight on the GPU; each is collected this many captures later
+    unsigned ringSize;
+    // Frames that may wait for the encoder before new ones are dropped
+    unsigned bufferCount;
+
+    CaptureSettings() : format(CapturePng), frameSkip(0), ringSize(3), bufferCount(8) {}
+};
+
+// Records the frames drawn into the current OpenGL context.
+// Readback goes through a ring of pixel buffer objects, so glReadPixels only queues a copy
+// and the pixels are fetched a few frames later when the GPU is long done with them.
+// Encoding and disk writes run on a background thread. When it falls behind, frames are
+// dropped (and counted) instead of stalling the game loop. Without pixel buffer support,
+// frames are read back synchronously into the same buffers.
+class FrameCapture {
+private:
+    struct PendingFrame {
+        std::size_t buffer;
+        std::uint64_t frame;
+    };
+
+    CaptureSettings settings;
+    unsigned width;
+    unsigned height;
+    bool capturing;
+    bool usePixelBuffers;
+
+    // GPU side: one pixel buffer per ring slot and the capture it holds (0 = empty)
+    std::vector<unsigned> pixelBuffers;
+    std::vector<std::uint64_t> slotFrames;
+    std::uint64_t frameCounter;
+    std::uint64_t captureCounter;
+
+    // CPU side: frame buffers cycle free -> encode queue -> free
+    std::vector<std::vector<std::uint8_t>> buffers;
+    std::vector<std::size_t> freeBuffers;
+    std::deque<PendingFrame> encodeQueue;
+    mutable std::mutex mutex;
+    std::condition_variable frameReady;
+    bool stopping;
+    std::thread encoder;
+    std::ofstream stream;
+    std::vector<std::uint8_t> scratch;
+
+    std::uint64_t capturedCount;
+    std::uint64_t droppedCount;
+    std::uint64_t writtenCount;
+    std::int64_t mainThreadMicroseconds;
+
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Start capturing frames of the given size; the rendering context must be active
+    bool start(const CaptureSettings& _settings, unsigned _width, unsigned _height);
+    // Queue a readback of the frame just drawn; call after drawing and before display()
+    void captureFrame();
+    // Collect the readbacks still in flight, let the encoder finish and close the output
+    void stop();
+    bool isCapturing() const;
+    bool isUsingPixelBuffers() const;
+
+    std::uint64_t getCapturedCount() const;
+    std::uint64_t getDroppedCount() const;
+    std::uint64_t getWrittenCount() const;
+    // Average time captureFrame() took on the calling thread
+    sf::Time getAverageFrameCost() const;
+
+private:
+    bool loadPixelBufferFunctions();
+    void collectSlot(std::size_t slot);
+    bool acquireBuffer(std::size_t& buffer);
+    void submit(std::size_t buffer, std::uint64_t frame);
+    void encoderLoop();
+    void encode(std::vector<std::uint8_t>& pixels, std::uint64_t frame);
+};
@@ -0,0 +1,600 @@
+//Framebuffer.cpp
+#include "Framebuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+	// Index of the lowest set bit; 'bits' must not be zero
+	int lowestBit(std::uint64_t bits) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(bits);
+#endif
+	}
+
+	// Bits [low, high) of a coverage word
+	std::uint64_t bitRange(int low, int high) {
+		const std::uint64_t below = high >= 64 ? ~0ull : (1ull << high) - 1;
+		return below & ~((1ull << low) - 1);
+	}
+
+	const std::uint64_t fullWord = ~0ull;
+}
+
+template <typename Format>
+BasicFramebuffer<Format>::BasicFramebuffer()
+	: width(0), height(0), occlusion(false), depth(0), wordsPerRow(0), tileColumns(0), pixelsWritten(0), countingOverdraw(false) {
+}
+
+template <typename Format>
+const unsigned BasicFramebuffer<Format>::presentRows;
+
+template <typename Format>
+void BasicFramebuffer<Format>::create(unsigned _width, unsigned _height) {
+	width = _width;
+	height = _height;
+	pixels.assign(static_cast<std::size_t>(width) * height, 0);
+	wordsPerRow = (width + tileWidth - 1) / tileWidth;
+	tileColumns = wordsPerRow;
+	// Sized by the next beginOcclusion()
+	coverage.clear();
+	owners.clear();
+	coveredRows.clear();
+	if (countingOverdraw) {
+		writeCounts.assign(pixels.size(), 0);
+	}
+	occlusion = false;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::clear(sf::Color color) {
+	std::fill(pixels.begin(), pixels.end(), toPixel(color));
+	for (unsigned y = 0; y < height; ++y) {
+		countWrites(0, y, static_cast<int>(width));
+	}
+}
+
+template <typename Format>
+unsigned BasicFramebuffer<Format>::getWidth() const {
+	return width;
+}
+
+template <typename Format>
+unsigned BasicFramebuffer<Format>::getHeight() const {
+	return height;
+}
+
+template <typename Format>
+typename BasicFramebuffer<Format>::Pixel* BasicFramebuffer<Format>::getRow(unsigned y) {
+	return pixels.data() + static_cast<std::size_t>(y) * width;
+}
+
+template <typename Format>
+const typename BasicFramebuffer<Format>::Pixel* BasicFramebuffer<Format>::getRow(unsigned y) const {
+	return pixels.data() + static_cast<std::size_t>(y) * width;
+}
+
+template <typename Format>
+const typename BasicFramebuffer<Format>::Pixel* BasicFramebuffer<Format>::getPixels() const {
+	return pixels.data();
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::setPixel(int x, int y, sf::Color color) {
+	fillSpan(x, x, y, color);
+}
+
+template <typename Format>
+sf::Color BasicFramebuffer<Format>::getPixel(int x, int y) const {
+	if (x < 0 || y < 0 || x >= static_cast<int>(width) || y >= static_cast<int>(height)) {
+		return sf::Color::Transparent;
+	}
+	return toColor(getRow(y)[x]);
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillSpan(int x1, int x2, int y, sf::Color color) {
+	withPaint(color, [this, x1, x2, y](const auto& paint) { paintSpan(x1, x2, y, paint); });
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::writeSpan(int x, int y, const SourcePixel* source, int count) {
+	int skipped;
+	if (!clipSpan(x, y, count, skipped)) {
+		return;
+	}
+	Pixel* row = getRow(y);
+	source += skipped;
+	const int origin = x;
+	claimSpan(x, y, count, [row, source, origin](int first, int length) {
+		convertSpan(source + (first - origin), length, row + first);
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::blendSpan(int x, int y, const SourcePixel* source, int count) {
+	int skipped;
+	if (!clipSpan(x, y, count, skipped)) {
+		return;
+	}
+	Pixel* row = getRow(y);
+	source += skipped;
+	for (int i = 0; i < count; ++i) {
+		if (getAlpha(source[i]) == 0 || (occlusion && isHidden(x + i, y))) {
+			continue;
+		}
+		row[x + i] = blend(row[x + i], source[i]);
+		countWrites(x + i, y, 1);
+	}
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillRect(int x, int y, int w, int h, sf::Color color) {
+	withPaint(color, [this, x, y, w, h](const auto& paint) {
+		const int lastY = std::min(y + h, static_cast<int>(height));
+		for (int row = std::max(y, 0); row < lastY; ++row) {
+			paintSpan(x, x + w - 1, row, paint);
+		}
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillCircle(float centerX, float centerY, float radius, sf::Color color) {
+	// One span per row covering the pixel centers inside the circle
+	withPaint(color, [this, centerX, centerY, radius](const auto& paint) {
+		const int firstY = std::max(static_cast<int>(std::ceil(centerY - radius - 0.5f)), 0);
+		const int lastY = std::min(static_cast<int>(std::floor(centerY + radius - 0.5f)), static_cast<int>(height) - 1);
+		for (int y = firstY; y <= lastY; ++y) {
+			const float dy = y + 0.5f - centerY;
+			const float halfWidth = std::sqrt(std::max(radius * radius - dy * dy, 0.f));
+			paintSpan(static_cast<int>(std::ceil(centerX - halfWidth - 0.5f)), static_cast<int>(std::floor(centerX + halfWidth - 0.5f)), y, paint);
+		}
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::drawLine(int x1, int y1, int x2, int y2, sf::Color color) {
+	withPaint(color, [this, x1, y1, x2, y2](const auto& paint) {
+		const int dx = std::abs(x2 - x1), dy = -std::abs(y2 - y1);
+		const int stepX = x1 < x2 ? 1 : -1, stepY = y1 < y2 ? 1 : -1;
+		int x = x1, y = y1;
+		int error = dx + dy;
+		for (;;) {
+			paintSpan(x, x, y, paint);
+			if (x == x2 && y == y2) {
+				break;
+			}
+			const int doubled = 2 * error;
+			if (doubled >= dy) {
+				error += dy;
+				x += stepX;
+			}
+			if (doubled <= dx) {
+				error += dx;
+				y += stepY;
+			}
+		}
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::drawCircle(int centerX, int centerY, int radius, sf::Color color) {
+	if (radius < 0) {
+		return;
+	}
+	withPaint(color, [this, centerX, centerY, radius](const auto& paint) {
+		// Octant from (r, 0) to the diagonal, mirrored across it
+		int x = radius, y = 0;
+		int error = 1 - radius;
+		while (x >= y) {
+			plotMirrored(centerX, centerY, x, y, paint);
+			if (x != y) {
+				plotMirrored(centerX, centerY, y, x, paint);
+			}
+			++y;
+			if (error < 0) {
+				error += 2 * y + 1;
+			}
+			else {
+				--x;
+				error += 2 * (y - x) + 1;
+			}
+		}
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::drawEllipse(int centerX, int centerY, int rx, int ry, sf::Color color) {
+	if (rx < 0 || ry < 0) {
+		return;
+	}
+	withPaint(color, [this, centerX, centerY, rx, ry](const auto& paint) {
+		if (ry == 0) {
+			paintSpan(centerX - rx, centerX + rx, centerY, paint);
+			return;
+		}
+		traceEllipse(rx, ry, [this, centerX, centerY, &paint](int x, int y) {
+			plotMirrored(centerX, centerY, x, y, paint);
+		});
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillCircle(int centerX, int centerY, int radius, sf::Color color) {
+	fillEllipse(centerX, centerY, radius, radius, color);
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillEllipse(int centerX, int centerY, int rx, int ry, sf::Color color) {
+	if (rx < 0 || ry < 0) {
+		return;
+	}
+	withPaint(color, [this, centerX, centerY, rx, ry](const auto& paint) {
+		// One span per row, reaching the outline's outermost pixel on that row
+		int rowY = ry, rowX = 0;
+		const auto fillRows = [this, centerX, centerY, &paint](int x, int y) {
+			paintSpan(centerX - x, centerX + x, centerY + y, paint);
+			if (y != 0) {
+				paintSpan(centerX - x, centerX + x, centerY - y, paint);
+			}
+		};
+		if (ry > 0) {
+			traceEllipse(rx, ry, [&rowY, &rowX, &fillRows](int x, int y) {
+				if (y != rowY) {
+					fillRows(rowX, rowY);
+					rowY = y;
+				}
+				rowX = x;
+			});
+		}
+		else {
+			rowX = rx;
+		}
+		fillRows(rowX, rowY);
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::beginOcclusion() {
+	occlusion = true;
+	depth = 0;
+	if (owners.size() != pixels.size()) {
+		coverage.resize(static_cast<std::size_t>(wordsPerRow) * height);
+		owners.resize(pixels.size());
+		coveredRows.resize(static_cast<std::size_t>(tileColumns) * ((height + tileHeight - 1) / tileHeight));
+	}
+	std::fill(coverage.begin(), coverage.end(), 0);
+	std::fill(coveredRows.begin(), coveredRows.end(), 0);
+	if (width == 0 || height == 0) {
+		return;
+	}
+	// The bits past the right edge and the rows past the bottom count as covered from the start
+	if (width % tileWidth != 0) {
+		const std::uint64_t padding = ~bitRange(0, width % tileWidth);
+		for (unsigned y = 0; y < height; ++y) {
+			coverage[static_cast<std::size_t>(y) * wordsPerRow + wordsPerRow - 1] = padding;
+		}
+	}
+	const unsigned missingRows = (tileHeight - height % tileHeight) % tileHeight;
+	for (unsigned column = 0; column < tileColumns; ++column) {
+		coveredRows[coveredRows.size() - tileColumns + column] = static_cast<std::uint8_t>(missingRows);
+	}
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::endOcclusion() {
+	occlusion = false;
+}
+
+template <typename Format>
+bool BasicFramebuffer<Format>::isOcclusionEnabled() const {
+	return occlusion;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::setDepth(std::uint32_t _depth) {
+	depth = _depth;
+}
+
+template <typename Format>
+bool BasicFramebuffer<Format>::isOccluded(int x, int y, int w, int h) const {
+	if (!occlusion) {
+		return false;
+	}
+	const int left = std::max(x, 0);
+	const int top = std::max(y, 0);
+	const int right = std::min(x + w, static_cast<int>(width));
+	const int bottom = std::min(y + h, static_cast<int>(height));
+	for (int row = top / tileHeight; row * tileHeight < bottom; ++row) {
+		for (int column = left / tileWidth; column * tileWidth < right; ++column) {
+			if (coveredRows[row * tileColumns + column] < tileHeight) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::fillUncovered(sf::Color color) {
+	const std::uint32_t frontDepth = depth;
+	depth = 0;
+	for (unsigned y = 0; y < height; ++y) {
+		fillSpan(0, static_cast<int>(width) - 1, static_cast<int>(y), sf::Color(color.r, color.g, color.b, 255));
+	}
+	depth = frontDepth;
+}
+
+template <typename Format>
+std::size_t BasicFramebuffer<Format>::getPixelsWritten() const {
+	return pixelsWritten;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::resetPixelsWritten() {
+	pixelsWritten = 0;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::setOverdrawCounting(bool enabled) {
+	countingOverdraw = enabled;
+	writeCounts.assign(enabled ? pixels.size() : 0, 0);
+}
+
+template <typename Format>
+bool BasicFramebuffer<Format>::isOverdrawCounting() const {
+	return countingOverdraw;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::showOverdraw() {
+	if (!countingOverdraw) {
+		return;
+	}
+	const Pixel ramp[5] = { toPixel(sf::Color::Black), toPixel(sf::Color::Blue), toPixel(sf::Color::Green),
+		toPixel(sf::Color::Yellow), toPixel(sf::Color::Red) };
+	for (std::size_t i = 0; i < pixels.size(); ++i) {
+		pixels[i] = ramp[std::min<unsigned>(writeCounts[i], 4)];
+	}
+	std::fill(writeCounts.begin(), writeCounts.end(), 0);
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::present(sf::Texture& texture) const {
+	if (width == 0 || height == 0) {
+		return;
+	}
+	if (texture.getSize().x != width || texture.getSize().y != height) {
+		texture.create(width, height);
+	}
+	presentBuffer.resize(static_cast<std::size_t>(width) * std::min(presentRows, height));
+	for (unsigned y = 0; y < height; y += presentRows) {
+		const unsigned rows = std::min(presentRows, height - y);
+		const Pixel* strip = getRow(y);
+		std::transform(strip, strip + static_cast<std::size_t>(width) * rows, presentBuffer.begin(), [](Pixel pixel) { return Format::toRgba8(pixel); });
+		texture.update(reinterpret_cast<const sf::Uint8*>(presentBuffer.data()), width, rows, 0, y);
+	}
+}
+
+template <>
+void BasicFramebuffer<Rgba8Format>::present(sf::Texture& texture) const {
+	if (width == 0 || height == 0) {
+		return;
+	}
+	if (texture.getSize().x != width || texture.getSize().y != height) {
+		texture.create(width, height);
+	}
+	texture.update(reinterpret_cast<const sf::Uint8*>(pixels.data()));
+}
+
+template <typename Format>
+typename BasicFramebuffer<Format>::Pixel BasicFramebuffer<Format>::toPixel(sf::Color color) {
+	return Format::pack(color);
+}
+
+template <typename Format>
+sf::Color BasicFramebuffer<Format>::toColor(Pixel pixel) {
+	return Format::unpack(pixel);
+}
+
+template <typename Format>
+std::uint32_t BasicFramebuffer<Format>::getAlpha(SourcePixel pixel) {
+	return pixel >> 24;
+}
+
+template <typename Format>
+typename BasicFramebuffer<Format>::Pixel BasicFramebuffer<Format>::blend(Pixel destination, SourcePixel source) {
+	const std::uint32_t alpha = getAlpha(source);
+	if (alpha == 255) {
+		return Format::fromRgba8(source);
+	}
+	if (alpha == 0) {
+		return destination;
+	}
+	return Format::blend(destination, Format::fromRgba8(source), alpha);
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::convertSpan(const SourcePixel* source, int count, Pixel* target) {
+	std::transform(source, source + count, target, [](SourcePixel pixel) { return Format::fromRgba8(pixel); });
+}
+
+template <>
+void BasicFramebuffer<Rgba8Format>::convertSpan(const SourcePixel* source, int count, Pixel* target) {
+	std::memcpy(target, source, count * sizeof(Pixel));
+}
+
+template <typename Format>
+template <typename Draw>
+void BasicFramebuffer<Format>::withPaint(sf::Color color, Draw draw) {
+	if (color.a == 255) {
+		const WritePaint paint = { toPixel(color) };
+		draw(paint);
+	}
+	else if (color.a > 0) {
+		const BlendPaint paint = { toPixel(color), color.a };
+		draw(paint);
+	}
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::paintSpan(int x1, int x2, int y, const WritePaint& paint) {
+	int count = x2 - x1 + 1;
+	int skipped;
+	if (!clipSpan(x1, y, count, skipped)) {
+		return;
+	}
+	Pixel* row = getRow(y);
+	const Pixel source = paint.pixel;
+	claimSpan(x1, y, count, [row, source](int first, int length) {
+		std::fill(row + first, row + first + length, source);
+	});
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::paintSpan(int x1, int x2, int y, const BlendPaint& paint) {
+	int count = x2 - x1 + 1;
+	int skipped;
+	if (!clipSpan(x1, y, count, skipped)) {
+		return;
+	}
+	Pixel* row = getRow(y);
+	for (int x = x1; x < x1 + count; ++x) {
+		if (occlusion && isHidden(x, y)) {
+			continue;
+		}
+		row[x] = Format::blend(row[x], paint.pixel, paint.alpha);
+		countWrites(x, y, 1);
+	}
+}
+
+template <typename Format>
+template <typename Paint>
+void BasicFramebuffer<Format>::plotMirrored(int centerX, int centerY, int x, int y, const Paint& paint) {
+	paintSpan(centerX + x, centerX + x, centerY + y, paint);
+	if (x != 0) {
+		paintSpan(centerX - x, centerX - x, centerY + y, paint);
+	}
+	if (y != 0) {
+		paintSpan(centerX + x, centerX + x, centerY - y, paint);
+		if (x != 0) {
+			paintSpan(centerX - x, centerX - x, centerY - y, paint);
+		}
+	}
+}
+
+template <typename Format>
+template <typename Visit>
+void BasicFramebuffer<Format>::traceEllipse(int rx, int ry, Visit visit) {
+	// Decision variables are kept at four times their value so they stay integers
+	const std::int64_t a2 = static_cast<std::int64_t>(rx) * rx;
+	const std::int64_t b2 = static_cast<std::int64_t>(ry) * ry;
+	int x = 0, y = ry;
+	std::int64_t dx = 0, dy = 2 * a2 * y;
+
+	// Region 1, where the outline is flatter than 45 degrees: x advances every step
+	std::int64_t decision = 4 * b2 - 4 * a2 * ry + a2;
+	while (dx < dy) {
+		visit(x, y);
+		++x;
+		dx += 2 * b2;
+		if (decision < 0) {
+			decision += 4 * (dx + b2);
+		}
+		else {
+			--y;
+			dy -= 2 * a2;
+			decision += 4 * (dx - dy + b2);
+		}
+	}
+
+	// Region 2, steeper than 45 degrees: y advances every step
+	decision = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
+	while (y >= 0) {
+		visit(x, y);
+		--y;
+		dy -= 2 * a2;
+		if (decision > 0) {
+			decision += 4 * (a2 - dy);
+		}
+		else {
+			++x;
+			dx += 2 * b2;
+			decision += 4 * (dx - dy + a2);
+		}
+	}
+}
+
+template <typename Format>
+bool BasicFramebuffer<Format>::clipSpan(int& x, int y, int& count, int& skipped) const {
+	if (y < 0 || y >= static_cast<int>(height)) {
+		return false;
+	}
+	skipped = std::max(-x, 0);
+	x += skipped;
+	count = std::min(count - skipped, static_cast<int>(width) - x);
+	return count > 0;
+}
+
+template <typename Format>
+template <typename Write>
+void BasicFramebuffer<Format>::claimSpan(int x, int y, int count, Write write) {
+	if (!occlusion) {
+		countWrites(x, y, count);
+		write(x, count);
+		return;
+	}
+	std::uint64_t* bits = coverage.data() + static_cast<std::size_t>(y) * wordsPerRow;
+	std::uint32_t* rowOwners = owners.data() + static_cast<std::size_t>(y) * width;
+	const int end = x + count;
+	for (int word = x / tileWidth; word * tileWidth < end; ++word) {
+		const int base = word * tileWidth;
+		std::uint64_t open = bitRange(std::max(x, base) - base, std::min(end, base + tileWidth) - base) & ~bits[word];
+		if (open == 0) {
+			continue;
+		}
+		bits[word] |= open;
+		if (bits[word] == fullWord) {
+			++coveredRows[(y / tileHeight) * tileColumns + word];
+		}
+		// Write each run of uncovered pixels in one go
+		while (open != 0) {
+			const int start = lowestBit(open);
+			const std::uint64_t rest = ~(open >> start);
+			const int length = rest == 0 ? tileWidth - start : lowestBit(rest);
+			std::fill(rowOwners + base + start, rowOwners + base + start + length, depth);
+			countWrites(base + start, y, length);
+			write(base + start, length);
+			open = start + length >= tileWidth ? 0 : open & (fullWord << (start + length));
+		}
+	}
+}
+
+template <typename Format>
+bool BasicFramebuffer<Format>::isHidden(int x, int y) const {
+	const std::size_t word = static_cast<std::size_t>(y) * wordsPerRow + x / tileWidth;
+	return (coverage[word] >> (x % tileWidth) & 1) != 0 && owners[static_cast<std::size_t>(y) * width + x] > depth;
+}
+
+template <typename Format>
+void BasicFramebuffer<Format>::countWrites(int x, int y, int count) {
+	pixelsWritten += count;
+	if (countingOverdraw) {
+		std::uint8_t* counts = writeCounts.data() + static_cast<std::size_t>(y) * width + x;
+		for (int i = 0; i < count; ++i) {
+			counts[i] = static_cast<std::uint8_t>(std::min(counts[i] + 1, 255));
+		}
+	}
+}
+
+template class BasicFramebuffer<Rgba8Format>;
+template class BasicFramebuffer<Rgb565Format>;
+template class BasicFramebuffer<Rgb332Format>;
@@ -0,0 +1,162 @@
+//Framebuffer.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "PixelFormat.h"
+
+// Frame drawn on the CPU and handed to the GPU once per frame as a single texture upload.
+// Pixels are stored in 'Format' (see PixelFormat.h): Framebuffer is RGBA8, the layout
+// sf::Texture::update takes, and the RGB565 and RGB332 framebuffers take a half and a quarter
+// of its pixel memory and convert to RGBA8 only when presented. Sprite pixels handed in are
+// always RGBA8 words, bytes r, g, b, a in memory (0xAABBGGRR on little-endian machines).
+//
+// Between beginOcclusion() and endOcclusion() the framebuffer eliminates overdraw for content
+// drawn front to back: an opaque write skips the pixels already covered and claims the rest
+// for the current depth, and a blend skips the pixels claimed by something in front of it.
+// Coverage is kept as one bit per pixel plus a count per tile of fully covered rows, so whole
+// covered tiles are rejected without looking at their pixels. The coverage and owner buffers are
+// allocated by the first beginOcclusion(), so a framebuffer never drawn with occlusion costs only
+// its pixels.
+//
+// Each primitive packs its colour once and picks an opaque or a blending writer once, so the
+// rasterizer loops are instantiated per writer and format with no per-pixel format or alpha checks.
+template <typename Format>
+class BasicFramebuffer {
+public:
+    typedef typename Format::Pixel Pixel;
+    typedef std::uint32_t SourcePixel;
+    // Coverage tiles: one 64-bit word of coverage bits wide
+    static const int tileWidth = 64;
+    static const int tileHeight = 8;
+
+private:
+    unsigned width;
+    unsigned height;
+    std::vector<Pixel> pixels;
+
+    bool occlusion;
+    std::uint32_t depth;
+    unsigned wordsPerRow;
+    unsigned tileColumns;
+    std::vector<std::uint64_t> coverage;
+    // Depth of the opaque write that claimed each covered pixel
+    std::vector<std::uint32_t> owners;
+    std::vector<std::uint8_t> coveredRows;
+
+    std::size_t pixelsWritten;
+    bool countingOverdraw;
+    std::vector<std::uint8_t> writeCounts;
+    // RGBA8 copy of a strip of rows for the texture upload, for the formats that need one
+    mutable std::vector<std::uint32_t> presentBuffer;
+
+    // Writers for one colour: an opaque one claims the pixels it covers, a blending one skips
+    // the pixels hidden in front of the current depth
+    struct WritePaint {
+        Pixel pixel;
+    };
+    struct BlendPaint {
+        Pixel pixel;
+        std::uint32_t alpha;
+    };
+
+public:
+    BasicFramebuffer();
+
+    void create(unsigned _width, unsigned _height);
+    void clear(sf::Color color);
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    Pixel* getRow(unsigned y);
+    const Pixel* getRow(unsigned y) const;
+    const Pixel* getPixels() const;
+
+    // Single pixels and spans are clipped to the framebuffer and blended by their alpha
+    void setPixel(int x, int y, sf::Color color);
+    sf::Color getPixel(int x, int y) const;
+    // Fill the pixels [x1, x2] of row y
+    void fillSpan(int x1, int x2, int y, sf::Color color);
+    void fillRect(int x, int y, int w, int h, sf::Color color);
+    void fillCircle(float centerX, float centerY, float radius, sf::Color color);
+    // Bresenham line including both end points
+    void drawLine(int x1, int y1, int x2, int y2, sf::Color color);
+    // Midpoint outlines, each pixel written once, and fills of the same shapes
+    void drawCircle(int centerX, int centerY, int radius, sf::Color color);
+    void drawEllipse(int centerX, int centerY, int rx, int ry, sf::Color color);
+    void fillCircle(int centerX, int centerY, int radius, sf::Color color);
+    void fillEllipse(int centerX, int centerY, int rx, int ry, sf::Color color);
+    // Copy 'count' opaque pixels to row y starting at x, or blend them by their own alpha
+    void writeSpan(int x, int y, const SourcePixel* source, int count);
+    void blendSpan(int x, int y, const SourcePixel* source, int count);
+
+    // Start a frame drawn front to back with no pixel covered yet
+    void beginOcclusion();
+    void endOcclusion();
+    bool isOcclusionEnabled() const;
+    // Writes claim pixels for this depth; larger depths are in front
+    void setDepth(std::uint32_t _depth);
+    // Whether every tile under the rectangle is already fully covered
+    bool isOccluded(int x, int y, int w, int h) const;
+    // Fill whatever is still uncovered with 'color', behind everything else (depth 0)
+    void fillUncovered(sf::Color color);
+
+    // Pixel writes since the last reset, to compare against the screen area
+    std::size_t getPixelsWritten() const;
+    void resetPixelsWritten();
+    // Count the writes of every pixel, for showOverdraw()
+    void setOverdrawCounting(bool enabled);
+    bool isOverdrawCounting() const;
+    // Replace the frame with its overdraw heatmap: black for no writes, then blue, green,
+    // yellow and red for one, two, three and four or more; the counts restart from zero
+    void showOverdraw();
+
+    // Copy the frame into 'texture', recreating it if the sizes differ; formats other than
+    // RGBA8 are converted and uploaded a strip of presentRows rows at a time
+    void present(sf::Texture& texture) const;
+    static const unsigned presentRows = 16;
+
+    static Pixel toPixel(sf::Color color);
+    static sf::Color toColor(Pixel pixel);
+    static std::uint32_t getAlpha(SourcePixel pixel);
+    // 'source' over 'destination' with straight (not premultiplied) alpha
+    static Pixel blend(Pixel destination, SourcePixel source);
+
+private:
+    // Store RGBA8 'source' pixels in the frame's format
+    static void convertSpan(const SourcePixel* source, int count, Pixel* target);
+    // Call draw(paint) with the writer for 'color'; nothing is drawn for a transparent colour
+    template <typename Draw>
+    void withPaint(sf::Color color, Draw draw);
+    // Fill [x1, x2] on row y, clipped to the framebuffer
+    void paintSpan(int x1, int x2, int y, const WritePaint& paint);
+    void paintSpan(int x1, int x2, int y, const BlendPaint& paint);
+    // (x, y) relative to the center in all four quadrants; points on an axis are written once
+    template <typename Paint>
+    void plotMirrored(int centerX, int centerY, int x, int y, const Paint& paint);
+    // Call visit(x, y) for the quadrant of a midpoint ellipse, from (0, ry) to (rx, 0), with
+    // y never increasing and x never decreasing
+    template <typename Visit>
+    static void traceEllipse(int rx, int ry, Visit visit);
+    // Clip [x, x + count) on row y; returns false if nothing is left
+    bool clipSpan(int& x, int y, int& count, int& skipped) const;
+    // Claim the uncovered pixels of [x, x + count) on row y and call write(first, count) for each
+    // uncovered run; without occlusion the whole span is one run
+    template <typename Write>
+    void claimSpan(int x, int y, int count, Write write);
+    // Whether the pixel is claimed by something in front of the current depth
+    bool isHidden(int x, int y) const;
+    void countWrites(int x, int y, int count);
+};
+
+// RGBA8 needs no conversion: spans are copied and the pixels are uploaded as they are
+template <>
+void BasicFramebuffer<Rgba8Format>::convertSpan(const SourcePixel* source, int count, Pixel* target);
+template <>
+void BasicFramebuffer<Rgba8Format>::present(sf::Texture& texture) const;
+
+// The formats Framebuffer.cpp instantiates
+typedef BasicFramebuffer<Rgba8Format> Framebuffer;
+typedef BasicFramebuffer<Rgb565Format> Rgb565Framebuffer;
+typedef BasicFramebuffer<Rgb332Format> Rgb332Framebuffer;
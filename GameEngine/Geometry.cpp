@@ -0,0 +1,288 @@
+//Geometry.cpp
+#include "Geometry.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GEOMETRY_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEOMETRY_SSE 1
+#endif
+
+namespace {
+	// The kernels are written once against these lane wrappers and instantiated per
+	// instruction set. Only operations with identical IEEE results to the scalar code
+	// are used (no FMA), so the SIMD and scalar paths agree bit for bit.
+#if GEOMETRY_SSE
+	struct SseLanes {
+		typedef __m128 Value;
+		static const std::size_t width = 4;
+
+		static Value load(const float* source) { return _mm_loadu_ps(source); }
+		static void store(float* target, Value value) { _mm_storeu_ps(target, value); }
+		static Value set(float value) { return _mm_set1_ps(value); }
+		static Value add(Value a, Value b) { return _mm_add_ps(a, b); }
+		static Value sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+		static Value mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+		static Value min(Value a, Value b) { return _mm_min_ps(a, b); }
+		static Value max(Value a, Value b) { return _mm_max_ps(a, b); }
+		static Value greater(Value a, Value b) { return _mm_cmpgt_ps(a, b); }
+		static Value less(Value a, Value b) { return _mm_cmplt_ps(a, b); }
+		static Value lessEqual(Value a, Value b) { return _mm_cmple_ps(a, b); }
+		static Value greaterEqual(Value a, Value b) { return _mm_cmpge_ps(a, b); }
+		static Value bitAnd(Value a, Value b) { return _mm_and_ps(a, b); }
+		static Value bitOr(Value a, Value b) { return _mm_or_ps(a, b); }
+		static Value bitXor(Value a, Value b) { return _mm_xor_ps(a, b); }
+		static Value bitAndNot(Value a, Value b) { return _mm_andnot_ps(a, b); }
+		static int mask(Value value) { return _mm_movemask_ps(value); }
+		static float reduceMin(Value value) {
+			float lanes[width];
+			store(lanes, value);
+			return minOf(minOf(lanes[0], lanes[1]), minOf(lanes[2], lanes[3]));
+		}
+		static float reduceMax(Value value) {
+			float lanes[width];
+			store(lanes, value);
+			return maxOf(maxOf(lanes[0], lanes[1]), maxOf(lanes[2], lanes[3]));
+		}
+	};
+#endif
+
+#if GEOMETRY_AVX
+	struct AvxLanes {
+		typedef __m256 Value;
+		static const std::size_t width = 8;
+
+		static Value load(const float* source) { return _mm256_loadu_ps(source); }
+		static void store(float* target, Value value) { _mm256_storeu_ps(target, value); }
+		static Value set(float value) { return _mm256_set1_ps(value); }
+		static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+		static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+		static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+		static Value min(Value a, Value b) { return _mm256_min_ps(a, b); }
+		static Value max(Value a, Value b) { return _mm256_max_ps(a, b); }
+		static Value greater(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static Value less(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Value lessEqual(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static Value greaterEqual(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static Value bitAnd(Value a, Value b) { return _mm256_and_ps(a, b); }
+		static Value bitOr(Value a, Value b) { return _mm256_or_ps(a, b); }
+		static Value bitXor(Value a, Value b) { return _mm256_xor_ps(a, b); }
+		static Value bitAndNot(Value a, Value b) { return _mm256_andnot_ps(a, b); }
+		static int mask(Value value) { return _mm256_movemask_ps(value); }
+		static float reduceMin(Value value) {
+			float lanes[width];
+			store(lanes, value);
+			float result = lanes[0];
+			for (std::size_t i = 1; i < width; ++i) {
+				result = minOf(result, lanes[i]);
+			}
+			return result;
+		}
+		static float reduceMax(Value value) {
+			float lanes[width];
+			store(lanes, value);
+			float result = lanes[0];
+			for (std::size_t i = 1; i < width; ++i) {
+				result = maxOf(result, lanes[i]);
+			}
+			return result;
+		}
+	};
+	typedef AvxLanes Lanes;
+#define GEOMETRY_SIMD 1
+#elif GEOMETRY_SSE
+	typedef SseLanes Lanes;
+#define GEOMETRY_SIMD 1
+#endif
+
+#if GEOMETRY_SIMD
+	// Orientation of (p, q, r) per lane as two masks: value > 0 and value < 0
+	template <typename L>
+	struct OrientationMasks {
+		typename L::Value clockwise;
+		typename L::Value counterclockwise;
+	};
+
+	template <typename L>
+	OrientationMasks<L> orientationMasks(typename L::Value px, typename L::Value py, typename L::Value qx, typename L::Value qy,
+		typename L::Value rx, typename L::Value ry) {
+		typename L::Value value = L::sub(L::mul(L::sub(qy, py), L::sub(rx, qx)), L::mul(L::sub(qx, px), L::sub(ry, qy)));
+		typename L::Value zero = L::set(0.f);
+		OrientationMasks<L> masks;
+		masks.clockwise = L::greater(value, zero);
+		masks.counterclockwise = L::less(value, zero);
+		return masks;
+	}
+
+	template <typename L>
+	typename L::Value onSegmentMask(typename L::Value px, typename L::Value py, typename L::Value qx, typename L::Value qy,
+		typename L::Value rx, typename L::Value ry) {
+		typename L::Value inX = L::bitAnd(L::lessEqual(qx, L::max(px, rx)), L::greaterEqual(qx, L::min(px, rx)));
+		typename L::Value inY = L::bitAnd(L::lessEqual(qy, L::max(py, ry)), L::greaterEqual(qy, L::min(py, ry)));
+		return L::bitAnd(inX, inY);
+	}
+
+	// Lane-wise segmentsIntersect(AB, CD)
+	template <typename L>
+	typename L::Value intersectMask(typename L::Value ax, typename L::Value ay, typename L::Value bx, typename L::Value by,
+		typename L::Value cx, typename L::Value cy, typename L::Value dx, typename L::Value dy) {
+		OrientationMasks<L> o1 = orientationMasks<L>(ax, ay, bx, by, cx, cy);
+		OrientationMasks<L> o2 = orientationMasks<L>(ax, ay, bx, by, dx, dy);
+		OrientationMasks<L> o3 = orientationMasks<L>(cx, cy, dx, dy, ax, ay);
+		OrientationMasks<L> o4 = orientationMasks<L>(cx, cy, dx, dy, bx, by);
+
+		// Orientations differ when either of their sign masks differs
+		typename L::Value differ12 = L::bitOr(L::bitXor(o1.clockwise, o2.clockwise), L::bitXor(o1.counterclockwise, o2.counterclockwise));
+		typename L::Value differ34 = L::bitOr(L::bitXor(o3.clockwise, o4.clockwise), L::bitXor(o3.counterclockwise, o4.counterclockwise));
+		typename L::Value result = L::bitAnd(differ12, differ34);
+
+		// Collinear special cases: orientation is 0 when neither sign mask is set
+		typename L::Value collinear1 = L::bitAndNot(L::bitOr(o1.clockwise, o1.counterclockwise), onSegmentMask<L>(ax, ay, cx, cy, bx, by));
+		typename L::Value collinear2 = L::bitAndNot(L::bitOr(o2.clockwise, o2.counterclockwise), onSegmentMask<L>(ax, ay, dx, dy, bx, by));
+		typename L::Value collinear3 = L::bitAndNot(L::bitOr(o3.clockwise, o3.counterclockwise), onSegmentMask<L>(cx, cy, ax, ay, dx, dy));
+		typename L::Value collinear4 = L::bitAndNot(L::bitOr(o4.clockwise, o4.counterclockwise), onSegmentMask<L>(cx, cy, bx, by, dx, dy));
+		return L::bitOr(result, L::bitOr(L::bitOr(collinear1, collinear2), L::bitOr(collinear3, collinear4)));
+	}
+#endif
+}
+
+void SegmentArrays::push_back(const Segment& segment) {
+	startX.push_back(segment.start.x);
+	startY.push_back(segment.start.y);
+	endX.push_back(segment.end.x);
+	endY.push_back(segment.end.y);
+}
+
+void SegmentArrays::clear() {
+	startX.clear();
+	startY.clear();
+	endX.clear();
+	endY.clear();
+}
+
+void SegmentArrays::reserve(std::size_t count) {
+	startX.reserve(count);
+	startY.reserve(count);
+	endX.reserve(count);
+	endY.reserve(count);
+}
+
+void transformPoints(const Affine2D& transform, const float* x, const float* y, float* outX, float* outY, std::size_t count) {
+	std::size_t i = 0;
+#if GEOMETRY_SIMD
+	const Lanes::Value a = Lanes::set(transform.a), b = Lanes::set(transform.b);
+	const Lanes::Value c = Lanes::set(transform.c), d = Lanes::set(transform.d);
+	const Lanes::Value tx = Lanes::set(transform.tx), ty = Lanes::set(transform.ty);
+	for (; i + Lanes::width <= count; i += Lanes::width) {
+		Lanes::Value px = Lanes::load(x + i);
+		Lanes::Value py = Lanes::load(y + i);
+		// Same operation order as Affine2D::transformPoint
+		Lanes::store(outX + i, Lanes::add(Lanes::add(Lanes::mul(a, px), Lanes::mul(c, py)), tx));
+		Lanes::store(outY + i, Lanes::add(Lanes::add(Lanes::mul(b, px), Lanes::mul(d, py)), ty));
+	}
+#endif
+	for (; i < count; ++i) {
+		Vec2 point = transform.transformPoint(Vec2(x[i], y[i]));
+		outX[i] = point.x;
+		outY[i] = point.y;
+	}
+}
+
+void intersectSegmentPairs(const SegmentArrays& first, const SegmentArrays& second, std::uint8_t* results, std::size_t count) {
+	std::size_t i = 0;
+#if GEOMETRY_SIMD
+	for (; i + Lanes::width <= count; i += Lanes::width) {
+		int mask = Lanes::mask(intersectMask<Lanes>(
+			Lanes::load(&first.startX[i]), Lanes::load(&first.startY[i]), Lanes::load(&first.endX[i]), Lanes::load(&first.endY[i]),
+			Lanes::load(&second.startX[i]), Lanes::load(&second.startY[i]), Lanes::load(&second.endX[i]), Lanes::load(&second.endY[i])));
+		for (std::size_t lane = 0; lane < Lanes::width; ++lane) {
+			results[i + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		results[i] = segmentsIntersect(first[i], second[i]) ? 1 : 0;
+	}
+}
+
+std::size_t findIntersectingSegment(const Segment& segment, const SegmentArrays& segments, std::size_t begin, std::size_t end) {
+	std::size_t i = begin;
+#if GEOMETRY_SIMD
+	const Lanes::Value ax = Lanes::set(segment.start.x), ay = Lanes::set(segment.start.y);
+	const Lanes::Value bx = Lanes::set(segment.end.x), by = Lanes::set(segment.end.y);
+	for (; i + Lanes::width <= end; i += Lanes::width) {
+		int mask = Lanes::mask(intersectMask<Lanes>(ax, ay, bx, by,
+			Lanes::load(&segments.startX[i]), Lanes::load(&segments.startY[i]), Lanes::load(&segments.endX[i]), Lanes::load(&segments.endY[i])));
+		if (mask != 0) {
+			for (std::size_t lane = 0; lane < Lanes::width; ++lane) {
+				if (mask & (1 << lane)) {
+					return i + lane;
+				}
+			}
+		}
+	}
+#endif
+	for (; i < end; ++i) {
+		if (segmentsIntersect(segment, segments[i])) {
+			return i;
+		}
+	}
+	return end;
+}
+
+void computeSegmentBounds(const SegmentArrays& segments, AABB* bounds) {
+	const std::size_t count = segments.size();
+	std::size_t i = 0;
+#if GEOMETRY_SIMD
+	float minX[Lanes::width], minY[Lanes::width], maxX[Lanes::width], maxY[Lanes::width];
+	for (; i + Lanes::width <= count; i += Lanes::width) {
+		Lanes::Value startX = Lanes::load(&segments.startX[i]), startY = Lanes::load(&segments.startY[i]);
+		Lanes::Value endX = Lanes::load(&segments.endX[i]), endY = Lanes::load(&segments.endY[i]);
+		Lanes::store(minX, Lanes::min(startX, endX));
+		Lanes::store(minY, Lanes::min(startY, endY));
+		Lanes::store(maxX, Lanes::max(startX, endX));
+		Lanes::store(maxY, Lanes::max(startY, endY));
+		for (std::size_t lane = 0; lane < Lanes::width; ++lane) {
+			bounds[i + lane] = AABB(Vec2(minX[lane], minY[lane]), Vec2(maxX[lane], maxY[lane]));
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		bounds[i] = segments[i].bounds();
+	}
+}
+
+AABB computePointBounds(const float* x, const float* y, std::size_t count) {
+	if (count == 0) {
+		return AABB();
+	}
+
+	float minX = x[0], minY = y[0], maxX = x[0], maxY = y[0];
+	std::size_t i = 0;
+#if GEOMETRY_SIMD
+	if (count >= Lanes::width) {
+		Lanes::Value laneMinX = Lanes::load(x), laneMinY = Lanes::load(y);
+		Lanes::Value laneMaxX = laneMinX, laneMaxY = laneMinY;
+		for (i = Lanes::width; i + Lanes::width <= count; i += Lanes::width) {
+			Lanes::Value px = Lanes::load(x + i), py = Lanes::load(y + i);
+			laneMinX = Lanes::min(laneMinX, px);
+			laneMinY = Lanes::min(laneMinY, py);
+			laneMaxX = Lanes::max(laneMaxX, px);
+			laneMaxY = Lanes::max(laneMaxY, py);
+		}
+		minX = Lanes::reduceMin(laneMinX);
+		minY = Lanes::reduceMin(laneMinY);
+		maxX = Lanes::reduceMax(laneMaxX);
+		maxY = Lanes::reduceMax(laneMaxY);
+	}
+#endif
+	for (; i < count; ++i) {
+		minX = minOf(minX, x[i]);
+		minY = minOf(minY, y[i]);
+		maxX = maxOf(maxX, x[i]);
+		maxY = maxOf(maxY, y[i]);
+	}
+	return AABB(Vec2(minX, minY), Vec2(maxX, maxY));
+}
@@ -0,0 +1,162 @@
+//Geometry.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Plain 2D vector. Everything is inline and constexpr so it costs the same as two floats.
+struct Vec2 {
+    float x;
+    float y;
+
+    constexpr Vec2() : x(0.f), y(0.f) {}
+    constexpr Vec2(float _x, float _y) : x(_x), y(_y) {}
+    constexpr Vec2(const sf::Vector2f& vector) : x(vector.x), y(vector.y) {}
+
+    constexpr Vec2 operator+(const Vec2& other) const { return Vec2(x + other.x, y + other.y); }
+    constexpr Vec2 operator-(const Vec2& other) const { return Vec2(x - other.x, y - other.y); }
+    constexpr Vec2 operator-() const { return Vec2(-x, -y); }
+    constexpr Vec2 operator*(float factor) const { return Vec2(x * factor, y * factor); }
+    constexpr Vec2 operator/(float divisor) const { return Vec2(x / divisor, y / divisor); }
+    constexpr bool operator==(const Vec2& other) const { return x == other.x && y == other.y; }
+    constexpr bool operator!=(const Vec2& other) const { return !(*this == other); }
+
+    Vec2& operator+=(const Vec2& other) { x += other.x; y += other.y; return *this; }
+    Vec2& operator-=(const Vec2& other) { x -= other.x; y -= other.y; return *this; }
+    Vec2& operator*=(float factor) { x *= factor; y *= factor; return *this; }
+
+    constexpr float dot(const Vec2& other) const { return x * other.x + y * other.y; }
+    // z of the 3D cross product; positive when 'other' is counterclockwise in y-up space
+    constexpr float cross(const Vec2& other) const { return x * other.y - y * other.x; }
+    constexpr float lengthSquared() const { return x * x + y * y; }
+
+    sf::Vector2f toVector2f() const { return sf::Vector2f(x, y); }
+};
+
+constexpr Vec2 operator*(float factor, const Vec2& vector) { return vector * factor; }
+
+constexpr float minOf(float a, float b) { return a < b ? a : b; }
+constexpr float maxOf(float a, float b) { return a > b ? a : b; }
+
+// Axis-aligned bounding box; min/max are inclusive
+struct AABB {
+    Vec2 min;
+    Vec2 max;
+
+    constexpr AABB() : min(), max() {}
+    constexpr AABB(const Vec2& _min, const Vec2& _max) : min(_min), max(_max) {}
+
+    static constexpr AABB fromPoints(const Vec2& a, const Vec2& b) {
+        return AABB(Vec2(minOf(a.x, b.x), minOf(a.y, b.y)), Vec2(maxOf(a.x, b.x), maxOf(a.y, b.y)));
+    }
+    static constexpr AABB fromRect(const sf::FloatRect& rect) {
+        return AABB(Vec2(rect.left, rect.top), Vec2(rect.left + rect.width, rect.top + rect.height));
+    }
+
+    constexpr bool overlaps(const AABB& other) const {
+        return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+    }
+    constexpr bool contains(const Vec2& point) const {
+        return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+    }
+    constexpr AABB merged(const AABB& other) const {
+        return AABB(Vec2(minOf(min.x, other.min.x), minOf(min.y, other.min.y)), Vec2(maxOf(max.x, other.max.x), maxOf(max.y, other.max.y)));
+    }
+    constexpr Vec2 size() const { return max - min; }
+};
+
+struct Segment {
+    Vec2 start;
+    Vec2 end;
+
+    constexpr Segment() : start(), end() {}
+    constexpr Segment(const Vec2& _start, const Vec2& _end) : start(_start), end(_end) {}
+
+    constexpr AABB bounds() const { return AABB::fromPoints(start, end); }
+};
+
+// 2D affine matrix [a c tx; b d ty], enough for translate/rotate/scale
+struct Affine2D {
+    float a, b, c, d, tx, ty;
+
+    constexpr Affine2D() : a(1.f), b(0.f), c(0.f), d(1.f), tx(0.f), ty(0.f) {}
+    constexpr Affine2D(float _a, float _b, float _c, float _d, float _tx, float _ty) : a(_a), b(_b), c(_c), d(_d), tx(_tx), ty(_ty) {}
+
+    constexpr Vec2 transformPoint(const Vec2& point) const {
+        return Vec2(a * point.x + c * point.y + tx, b * point.x + d * point.y + ty);
+    }
+    // this * other: apply 'other' first
+    constexpr Affine2D operator*(const Affine2D& other) const {
+        return Affine2D(a * other.a + c * other.b, b * other.a + d * other.b,
+            a * other.c + c * other.d, b * other.c + d * other.d,
+            a * other.tx + c * other.ty + tx, b * other.tx + d * other.ty + ty);
+    }
+
+    sf::Transform toTransform() const {
+        return sf::Transform(a, c, tx, b, d, ty, 0.f, 0.f, 1.f);
+    }
+};
+
+// Orientation of the triplet (p, q, r): 0 collinear, 1 clockwise, 2 counterclockwise
+constexpr int orientation(const Vec2& p, const Vec2& q, const Vec2& r) {
+    const float value = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+    if (value == 0.f) {
+        return 0;
+    }
+    return value > 0.f ? 1 : 2;
+}
+
+// True if q lies within the bounding box of segment pr (meant for collinear points)
+constexpr bool onSegment(const Vec2& p, const Vec2& q, const Vec2& r) {
+    return q.x <= maxOf(p.x, r.x) && q.x >= minOf(p.x, r.x) && q.y <= maxOf(p.y, r.y) && q.y >= minOf(p.y, r.y);
+}
+
+constexpr bool segmentsIntersect(const Segment& first, const Segment& second) {
+    const int orientation1 = orientation(first.start, first.end, second.start);
+    const int orientation2 = orientation(first.start, first.end, second.end);
+    const int orientation3 = orientation(second.start, second.end, first.start);
+    const int orientation4 = orientation(second.start, second.end, first.end);
+
+    // General case: each segment's endpoints lie on different sides of the other
+    if (orientation1 != orientation2 && orientation3 != orientation4) {
+        return true;
+    }
+    // Collinear and overlapping
+    return (orientation1 == 0 && onSegment(first.start, second.start, first.end)) ||
+        (orientation2 == 0 && onSegment(first.start, second.end, first.end)) ||
+        (orientation3 == 0 && onSegment(second.start, first.start, second.end)) ||
+        (orientation4 == 0 && onSegment(second.start, first.end, second.end));
+}
+
+// Segments stored as structure of arrays, the layout the batch functions below work on
+struct SegmentArrays {
+    std::vector<float> startX, startY, endX, endY;
+
+    void push_back(const Segment& segment);
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const { return startX.size(); }
+    Segment operator[](std::size_t index) const {
+        return Segment(Vec2(startX[index], startY[index]), Vec2(endX[index], endY[index]));
+    }
+};
+
+// Batch kernels. Each processes whole SSE/AVX registers where the build enables them
+// and finishes the remainder with the scalar functions above, so results match exactly.
+
+// outX/outY[i] = transform * (x[i], y[i]); the output may alias the input
+void transformPoints(const Affine2D& transform, const float* x, const float* y, float* outX, float* outY, std::size_t count);
+
+// results[i] = segmentsIntersect(first[i], second[i]) for i in [0, count)
+void intersectSegmentPairs(const SegmentArrays& first, const SegmentArrays& second, std::uint8_t* results, std::size_t count);
+
+// Index of the first segment in [begin, end) that intersects 'segment', or end if none does
+std::size_t findIntersectingSegment(const Segment& segment, const SegmentArrays& segments, std::size_t begin, std::size_t end);
+
+// Bounding box of every segment
+void computeSegmentBounds(const SegmentArrays& segments, AABB* bounds);
+
+// Bounding box of a point cloud; an empty input gives an empty box at the origin
+AABB computePointBounds(const float* x, const float* y, std::size_t count);
@@ -0,0 +1,376 @@
+//InputSystem.cpp
+#include "InputSystem.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+	const char fileMagic[4] = { 'G', 'E', 'I', 'N' };
+	const std::uint8_t fileVersion = 1;
+
+	// Which optional fields follow the time delta of a record
+	enum RecordFlags {
+		KeysDownChanged = 1 << 0,
+		KeysPressedStored = 1 << 1,
+		MouseMoved = 1 << 2,
+		ButtonsDownChanged = 1 << 3,
+		ButtonsPressedStored = 1 << 4,
+		HasText = 1 << 5,
+		CloseRequested = 1 << 6
+	};
+
+	void writeVarint(std::ostream& stream, std::uint64_t value) {
+		while (value >= 0x80) {
+			stream.put(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		stream.put(static_cast<char>(value));
+	}
+
+	bool readVarint(std::istream& stream, std::uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			int byte = stream.get();
+			if (byte == std::char_traits<char>::eof()) {
+				return false;
+			}
+			value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Zigzag encoding keeps small negative numbers small
+	std::uint64_t encodeSigned(std::int64_t value) {
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	std::int64_t decodeSigned(std::uint64_t value) {
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+	void writeWords(std::ostream& stream, const std::uint64_t* words) {
+		for (int i = 0; i < InputSnapshot::keyWords; ++i) {
+			for (int byte = 0; byte < 8; ++byte) {
+				stream.put(static_cast<char>((words[i] >> (byte * 8)) & 0xFF));
+			}
+		}
+	}
+
+	bool readWords(std::istream& stream, std::uint64_t* words) {
+		for (int i = 0; i < InputSnapshot::keyWords; ++i) {
+			words[i] = 0;
+			for (int byte = 0; byte < 8; ++byte) {
+				int value = stream.get();
+				if (value == std::char_traits<char>::eof()) {
+					return false;
+				}
+				words[i] |= static_cast<std::uint64_t>(value & 0xFF) << (byte * 8);
+			}
+		}
+		return true;
+	}
+
+	bool isValidKey(int key) {
+		return key >= 0 && key < sf::Keyboard::KeyCount;
+	}
+}
+
+InputSnapshot::InputSnapshot() : tick(0), deltaMicroseconds(0), mouseButtonsDown(0), mouseButtonsPressed(0),
+closeRequested(false) {
+	std::memset(keysDown, 0, sizeof(keysDown));
+	std::memset(keysPressed, 0, sizeof(keysPressed));
+}
+
+bool InputSnapshot::isKeyDown(sf::Keyboard::Key key) const {
+	return isValidKey(key) && ((keysDown[key / 64] >> (key % 64)) & 1u);
+}
+
+bool InputSnapshot::wasKeyPressed(sf::Keyboard::Key key) const {
+	return isValidKey(key) && ((keysPressed[key / 64] >> (key % 64)) & 1u);
+}
+
+bool InputSnapshot::isMouseButtonDown(sf::Mouse::Button button) const {
+	return (mouseButtonsDown >> button) & 1u;
+}
+
+bool InputSnapshot::wasMouseButtonPressed(sf::Mouse::Button button) const {
+	return (mouseButtonsPressed >> button) & 1u;
+}
+
+float InputSnapshot::getDeltaSeconds() const {
+	return static_cast<float>(deltaMicroseconds) / 1000000.f;
+}
+
+InputSystem::InputSystem() : mode(Live), heldButtons(0), replayFinished(false), nextTick(0) {
+	std::memset(heldKeys, 0, sizeof(heldKeys));
+}
+
+InputSystem::~InputSystem() {
+	stop();
+}
+
+bool InputSystem::startRecording(const std::string& path) {
+	stop();
+	recordFile.open(path, std::ios::binary | std::ios::trunc);
+	if (!recordFile.is_open()) {
+		return false;
+	}
+	recordFile.write(fileMagic, sizeof(fileMagic));
+	recordFile.put(static_cast<char>(fileVersion));
+	// Deltas are encoded against an all-clear snapshot, just like the reader starts from
+	current = InputSnapshot();
+	nextTick = 0;
+	mode = Recording;
+	return true;
+}
+
+bool InputSystem::startReplay(const std::string& path) {
+	stop();
+	replayFile.open(path, std::ios::binary);
+	if (!replayFile.is_open()) {
+		return false;
+	}
+	char magic[sizeof(fileMagic)];
+	replayFile.read(magic, sizeof(magic));
+	int version = replayFile.get();
+	if (!replayFile || std::memcmp(magic, fileMagic, sizeof(fileMagic)) != 0 || version != fileVersion) {
+		replayFile.close();
+		return false;
+	}
+	current = InputSnapshot();
+	replayFinished = false;
+	nextTick = 0;
+	mode = Replaying;
+	return true;
+}
+
+void InputSystem::stop() {
+	if (recordFile.is_open()) {
+		recordFile.close();
+	}
+	if (replayFile.is_open()) {
+		replayFile.close();
+	}
+	mode = Live;
+}
+
+InputSystem::Mode InputSystem::getMode() const {
+	return mode;
+}
+
+const InputSnapshot& InputSystem::poll(sf::Window& window) {
+	beginTick();
+	sf::Event event;
+	while (window.pollEvent(event)) {
+		applyEvent(event);
+	}
+
+	if (mode == Replaying) {
+		// Only the request to close the real window survives into a replayed tick
+		bool windowClosed = current.closeRequested;
+		if (!readSnapshot(current)) {
+			replayFinished = true;
+		}
+		current.closeRequested = current.closeRequested || windowClosed || replayFinished;
+		return current;
+	}
+
+	finishLiveTick();
+	return current;
+}
+
+const InputSnapshot& InputSystem::poll() {
+	beginTick();
+	if (mode != Replaying || !readSnapshot(current)) {
+		replayFinished = true;
+		current.closeRequested = true;
+	}
+	return current;
+}
+
+const InputSnapshot& InputSystem::getSnapshot() const {
+	return current;
+}
+
+bool InputSystem::isReplayFinished() const {
+	return replayFinished;
+}
+
+void InputSystem::beginTick() {
+	// Swapping keeps the text buffers' capacity instead of reallocating them every tick
+	std::swap(previous, current);
+	current.tick = nextTick++;
+	current.deltaMicroseconds = tickClock.restart().asMicroseconds();
+	std::memset(current.keysPressed, 0, sizeof(current.keysPressed));
+	current.mouseButtonsPressed = 0;
+	current.closeRequested = false;
+	current.text.clear();
+}
+
+void InputSystem::applyEvent(const sf::Event& event) {
+	switch (event.type) {
+	case sf::Event::Closed:
+		current.closeRequested = true;
+		break;
+	case sf::Event::KeyPressed:
+		if (isValidKey(event.key.code)) {
+			heldKeys[event.key.code / 64] |= std::uint64_t(1) << (event.key.code % 64);
+			current.keysPressed[event.key.code / 64] |= std::uint64_t(1) << (event.key.code % 64);
+		}
+		break;
+	case sf::Event::KeyReleased:
+		if (isValidKey(event.key.code)) {
+			heldKeys[event.key.code / 64] &= ~(std::uint64_t(1) << (event.key.code % 64));
+		}
+		break;
+	case sf::Event::LostFocus:
+		// Releases are not reported while the window is in the background
+		std::memset(heldKeys, 0, sizeof(heldKeys));
+		heldButtons = 0;
+		break;
+	case sf::Event::MouseMoved:
+		mousePosition = sf::Vector2i(event.mouseMove.x, event.mouseMove.y);
+		break;
+	case sf::Event::MouseButtonPressed:
+		heldButtons |= static_cast<std::uint8_t>(1u << event.mouseButton.button);
+		current.mouseButtonsPressed |= static_cast<std::uint8_t>(1u << event.mouseButton.button);
+		mousePosition = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+		break;
+	case sf::Event::MouseButtonReleased:
+		heldButtons &= static_cast<std::uint8_t>(~(1u << event.mouseButton.button));
+		mousePosition = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+		break;
+	case sf::Event::TextEntered:
+		current.text.push_back(event.text.unicode);
+		break;
+	default:
+		break;
+	}
+}
+
+void InputSystem::finishLiveTick() {
+	std::memcpy(current.keysDown, heldKeys, sizeof(heldKeys));
+	current.mouseButtonsDown = heldButtons;
+	current.mousePosition = mousePosition;
+
+	if (mode == Recording) {
+		writeSnapshot(current);
+	}
+}
+
+bool InputSystem::readSnapshot(InputSnapshot& snapshot) {
+	std::uint64_t delta;
+	if (!readVarint(replayFile, delta)) {
+		return false;
+	}
+	int flags = replayFile.get();
+	if (flags == std::char_traits<char>::eof()) {
+		return false;
+	}
+	snapshot.deltaMicroseconds = static_cast<std::int64_t>(delta);
+
+	// Fields that were not stored are unchanged since the previous tick
+	if (flags & KeysDownChanged) {
+		if (!readWords(replayFile, snapshot.keysDown)) {
+			return false;
+		}
+	}
+	else {
+		std::memcpy(snapshot.keysDown, previous.keysDown, sizeof(snapshot.keysDown));
+	}
+	if (flags & KeysPressedStored) {
+		if (!readWords(replayFile, snapshot.keysPressed)) {
+			return false;
+		}
+	}
+	else {
+		for (int i = 0; i < InputSnapshot::keyWords; ++i) {
+			snapshot.keysPressed[i] = snapshot.keysDown[i] & ~previous.keysDown[i];
+		}
+	}
+	snapshot.mousePosition = previous.mousePosition;
+	if (flags & MouseMoved) {
+		std::uint64_t x, y;
+		if (!readVarint(replayFile, x) || !readVarint(replayFile, y)) {
+			return false;
+		}
+		snapshot.mousePosition = sf::Vector2i(static_cast<int>(decodeSigned(x)), static_cast<int>(decodeSigned(y)));
+	}
+	snapshot.mouseButtonsDown = (flags & ButtonsDownChanged) ? static_cast<std::uint8_t>(replayFile.get()) : previous.mouseButtonsDown;
+	snapshot.mouseButtonsPressed = (flags & ButtonsPressedStored) ? static_cast<std::uint8_t>(replayFile.get()) : 0;
+	snapshot.text.clear();
+	if (flags & HasText) {
+		std::uint64_t count;
+		if (!readVarint(replayFile, count)) {
+			return false;
+		}
+		for (std::uint64_t i = 0; i < count; ++i) {
+			std::uint64_t character;
+			if (!readVarint(replayFile, character)) {
+				return false;
+			}
+			snapshot.text.push_back(static_cast<std::uint32_t>(character));
+		}
+	}
+	snapshot.closeRequested = (flags & CloseRequested) != 0;
+	return static_cast<bool>(replayFile);
+}
+
+void InputSystem::writeSnapshot(const InputSnapshot& snapshot) {
+	int flags = 0;
+	bool derivedPressedMatches = true;
+	for (int i = 0; i < InputSnapshot::keyWords; ++i) {
+		if (snapshot.keysDown[i] != previous.keysDown[i]) {
+			flags |= KeysDownChanged;
+		}
+		if (snapshot.keysPressed[i] != (snapshot.keysDown[i] & ~previous.keysDown[i])) {
+			derivedPressedMatches = false;
+		}
+	}
+	// A key pressed and released within one tick cannot be derived from the held state
+	if (!derivedPressedMatches) {
+		flags |= KeysPressedStored;
+	}
+	if (snapshot.mousePosition != previous.mousePosition) {
+		flags |= MouseMoved;
+	}
+	if (snapshot.mouseButtonsDown != previous.mouseButtonsDown) {
+		flags |= ButtonsDownChanged;
+	}
+	if (snapshot.mouseButtonsPressed != 0) {
+		flags |= ButtonsPressedStored;
+	}
+	if (!snapshot.text.empty()) {
+		flags |= HasText;
+	}
+	if (snapshot.closeRequested) {
+		flags |= CloseRequested;
+	}
+
+	writeVarint(recordFile, static_cast<std::uint64_t>(snapshot.deltaMicroseconds < 0 ? 0 : snapshot.deltaMicroseconds));
+	recordFile.put(static_cast<char>(flags));
+	if (flags & KeysDownChanged) {
+		writeWords(recordFile, snapshot.keysDown);
+	}
+	if (flags & KeysPressedStored) {
+		writeWords(recordFile, snapshot.keysPressed);
+	}
+	if (flags & MouseMoved) {
+		writeVarint(recordFile, encodeSigned(snapshot.mousePosition.x));
+		writeVarint(recordFile, encodeSigned(snapshot.mousePosition.y));
+	}
+	if (flags & ButtonsDownChanged) {
+		recordFile.put(static_cast<char>(snapshot.mouseButtonsDown));
+	}
+	if (flags & ButtonsPressedStored) {
+		recordFile.put(static_cast<char>(snapshot.mouseButtonsPressed));
+	}
+	if (flags & HasText) {
+		writeVarint(recordFile, snapshot.text.size());
+		for (std::uint32_t character : snapshot.text) {
+			writeVarint(recordFile, character);
+		}
+	}
+}
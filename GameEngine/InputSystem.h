@@ -0,0 +1,88 @@
+//InputSystem.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Everything the game may know about input for one tick. Built once per tick by
+// InputSystem and only read afterwards, so live, recorded and replayed input look
+// the same to the code that consumes it.
+struct InputSnapshot {
+    static const int keyWords = (sf::Keyboard::KeyCount + 63) / 64;
+
+    std::uint32_t tick;
+    // Real time the tick took when it was recorded
+    std::int64_t deltaMicroseconds;
+    // Keys held down, and keys that went down during this tick
+    std::uint64_t keysDown[keyWords];
+    std::uint64_t keysPressed[keyWords];
+    sf::Vector2i mousePosition;
+    std::uint8_t mouseButtonsDown;
+    std::uint8_t mouseButtonsPressed;
+    bool closeRequested;
+    // Unicode characters typed during this tick
+    std::vector<std::uint32_t> text;
+
+    InputSnapshot();
+
+    bool isKeyDown(sf::Keyboard::Key key) const;
+    bool wasKeyPressed(sf::Keyboard::Key key) const;
+    bool isMouseButtonDown(sf::Mouse::Button button) const;
+    bool wasMouseButtonPressed(sf::Mouse::Button button) const;
+    float getDeltaSeconds() const;
+};
+
+// Turns the window's event queue into one InputSnapshot per tick. The snapshot stream
+// can be recorded to a compact binary file and replayed later without a window, which
+// makes a gameplay session exactly reproducible.
+class InputSystem {
+public:
+    enum Mode {
+        Live,
+        Recording,
+        Replaying
+    };
+
+private:
+    Mode mode;
+    InputSnapshot current;
+    InputSnapshot previous;
+    // Key and button state tracked from events between ticks
+    std::uint64_t heldKeys[InputSnapshot::keyWords];
+    std::uint8_t heldButtons;
+    sf::Vector2i mousePosition;
+    sf::Clock tickClock;
+    std::ofstream recordFile;
+    std::ifstream replayFile;
+    bool replayFinished;
+    std::uint32_t nextTick;
+
+public:
+    InputSystem();
+    ~InputSystem();
+
+    bool startRecording(const std::string& path);
+    bool startReplay(const std::string& path);
+    void stop();
+    Mode getMode() const;
+
+    // Build the next snapshot from the window's events, or from the replay file when replaying.
+    // The window's events are drained in every mode so it keeps responding.
+    const InputSnapshot& poll(sf::Window& window);
+    // Headless replay: build the next snapshot from the replay file only
+    const InputSnapshot& poll();
+
+    const InputSnapshot& getSnapshot() const;
+    // True once a replay has run out of recorded ticks; later snapshots request closing
+    bool isReplayFinished() const;
+
+private:
+    void beginTick();
+    void applyEvent(const sf::Event& event);
+    void finishLiveTick();
+    bool readSnapshot(InputSnapshot& snapshot);
+    void writeSnapshot(const InputSnapshot& snapshot);
+};
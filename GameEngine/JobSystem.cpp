@@ -0,0 +1,199 @@
+//JobSystem.cpp
+#include "JobSystem.h"
+
+namespace {
+	// Which system and queue the current thread works for, if it is a worker
+	thread_local const JobSystem* currentSystem = nullptr;
+	thread_local unsigned currentWorker = 0;
+}
+
+JobSystem::JobSystem(unsigned _workerCount) : workerCount(_workerCount), pendingJobs(0), stopping(false), deterministic(false) {
+	if (workerCount == 0) {
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	// Queues must all exist before the first worker starts looking at them
+	for (unsigned i = 0; i <= workerCount; ++i) {
+		queues.emplace_back(new WorkQueue());
+	}
+	workers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; ++i) {
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void JobSystem::run(Job job, JobCounter* counter) {
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (deterministic) {
+		std::pair<Job, JobCounter*> item(std::move(job), counter);
+		execute(item);
+		return;
+	}
+	push(std::move(job), counter);
+}
+
+void JobSystem::runAfter(JobCounter& dependency, Job job, JobCounter* counter) {
+	if (counter) {
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (dependency.value.load(std::memory_order_acquire) > 0) {
+			dependency.continuations.emplace_back(std::move(job), counter);
+			return;
+		}
+	}
+	// The dependency has already finished
+	if (deterministic) {
+		std::pair<Job, JobCounter*> item(std::move(job), counter);
+		execute(item);
+		return;
+	}
+	push(std::move(job), counter);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	unsigned queueIndex = getCurrentQueue();
+	while (!counter.isDone()) {
+		if (!tryRunJob(queueIndex)) {
+			std::this_thread::yield();
+		}
+	}
+	// The thread that finished the last job may still hold the counter's lock
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::setDeterministic(bool enabled) {
+	deterministic = enabled;
+}
+
+bool JobSystem::isDeterministic() const {
+	return deterministic;
+}
+
+unsigned JobSystem::getWorkerCount() const {
+	return workerCount;
+}
+
+void JobSystem::workerLoop(unsigned index) {
+	currentSystem = this;
+	currentWorker = index;
+
+	while (true) {
+		if (tryRunJob(index)) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() { return stopping || pendingJobs.load() > 0; });
+		if (stopping && pendingJobs.load() == 0) {
+			return;
+		}
+	}
+}
+
+bool JobSystem::tryRunJob(unsigned queueIndex) {
+	std::pair<Job, JobCounter*> job;
+	if (!popJob(queueIndex, job)) {
+		return false;
+	}
+	pendingJobs.fetch_sub(1);
+	execute(job);
+	return true;
+}
+
+bool JobSystem::popJob(unsigned queueIndex, std::pair<Job, JobCounter*>& job) {
+	const unsigned queueCount = workerCount + 1;
+
+	// Own queue first: newest job for workers (cache-warm), oldest for the shared queue
+	{
+		WorkQueue& own = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			if (queueIndex < workerCount) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+			}
+			else {
+				job = std::move(own.jobs.front());
+				own.jobs.pop_front();
+			}
+			return true;
+		}
+	}
+
+	// Then steal the oldest job of any other queue
+	for (unsigned offset = 1; offset < queueCount; ++offset) {
+		WorkQueue& victim = *queues[(queueIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(std::pair<Job, JobCounter*>& job) {
+	job.first();
+	finish(job.second);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+	if (!counter) {
+		return;
+	}
+
+	std::vector<std::pair<Job, JobCounter*>> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			ready.swap(counter->continuations);
+		}
+	}
+
+	// Continuations already counted themselves in runAfter
+	for (std::pair<Job, JobCounter*>& continuation : ready) {
+		if (deterministic) {
+			execute(continuation);
+		}
+		else {
+			push(std::move(continuation.first), continuation.second);
+		}
+	}
+}
+
+void JobSystem::push(Job job, JobCounter* counter) {
+	WorkQueue& queue = *queues[getCurrentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.emplace_back(std::move(job), counter);
+	}
+	pendingJobs.fetch_add(1);
+	{
+		// Pairs with the predicate check in workerLoop so a wake-up cannot be lost
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeUp.notify_one();
+}
+
+unsigned JobSystem::getCurrentQueue() const {
+	if (currentSystem == this) {
+		return currentWorker;
+	}
+	return workerCount;
+}
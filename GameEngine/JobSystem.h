@@ -0,0 +1,143 @@
+//JobSystem.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counts jobs that have not finished yet. Jobs can be chained after a counter with
+// JobSystem::runAfter, and JobSystem::wait helps run jobs until it drops to zero.
+class JobCounter {
+private:
+    friend class JobSystem;
+
+    std::atomic<int> value;
+    std::mutex mutex;
+    std::vector<std::pair<std::function<void()>, JobCounter*>> continuations;
+
+public:
+    JobCounter() : value(0) {}
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing scheduler. Every worker owns a deque: it pushes and pops its own jobs
+// at the back and steals from the front of the others when it runs dry. Threads that
+// are not workers (the main thread) submit to a shared queue and help out in wait().
+class JobSystem {
+public:
+    typedef std::function<void()> Job;
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::pair<Job, JobCounter*>> jobs;
+    };
+
+    unsigned workerCount;
+    std::vector<std::thread> workers;
+    // One queue per worker plus the shared queue for outside threads at the end
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::atomic<int> pendingJobs;
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    // Set from the owning thread while workers read it
+    std::atomic<bool> deterministic;
+
+public:
+    // workerCount 0 uses one worker per hardware thread besides the caller
+    explicit JobSystem(unsigned _workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void run(Job job, JobCounter* counter = nullptr);
+    // Schedule 'job' once every job counted by 'dependency' has finished
+    void runAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+    // Run jobs on the calling thread until the counter reaches zero
+    void wait(JobCounter& counter);
+
+    // Calls function(begin, end) for consecutive ranges of at most grainSize indices.
+    // Range boundaries only depend on count and grainSize, never on the thread count,
+    // so per-range results can be combined in range order for reproducible output.
+    template <typename Function>
+    void parallelFor(size_t count, size_t grainSize, Function function);
+
+    // Deterministic mode runs every job inline on the submitting thread, in submission
+    // order. Use it for replays and debugging, where the simulation must not depend on
+    // scheduling.
+    void setDeterministic(bool enabled);
+    bool isDeterministic() const;
+
+    unsigned getWorkerCount() const;
+
+private:
+    void workerLoop(unsigned index);
+    bool tryRunJob(unsigned queueIndex);
+    bool popJob(unsigned queueIndex, std::pair<Job, JobCounter*>& job);
+    void execute(std::pair<Job, JobCounter*>& job);
+    void finish(JobCounter* counter);
+    void push(Job job, JobCounter* counter);
+    unsigned getCurrentQueue() const;
+};
+
+template <typename Function>
+void JobSystem::parallelFor(size_t count, size_t grainSize, Function function) {
+    if (count == 0) {
+        return;
+    }
+    if (grainSize == 0) {
+        grainSize = 1;
+    }
+
+    if (deterministic || workerCount == 0 || count <= grainSize) {
+        for (size_t begin = 0; begin < count; begin += grainSize) {
+            function(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    // Chunks are handed out through one atomic index instead of a job each: one helper job per
+    // worker that can help, and the caller, keep claiming the next chunk until none are left.
+    // Helpers capture only a pointer so they fit in std::function's local buffer.
+    struct Range {
+        Function* function;
+        size_t grainSize;
+        size_t count;
+        size_t chunkCount;
+        std::atomic<size_t> nextChunk;
+
+        void runChunks() {
+            for (size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed); chunk < chunkCount;
+                chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) {
+                size_t begin = chunk * grainSize;
+                (*function)(begin, std::min(begin + grainSize, count));
+            }
+        }
+    };
+    Range range;
+    range.function = &function;
+    range.grainSize = grainSize;
+    range.count = count;
+    range.chunkCount = (count + grainSize - 1) / grainSize;
+    range.nextChunk.store(0, std::memory_order_relaxed);
+
+    JobCounter counter;
+    size_t helperCount = std::min<size_t>(workerCount, range.chunkCount - 1);
+    for (size_t helper = 0; helper < helperCount; ++helper) {
+        run([&range]() { range.runChunks(); }, &counter);
+    }
+    range.runChunks();
+    wait(counter);
+}
@@ -5,14 +5,18 @@
 LineSegment::LineSegment(const Point2D& _startPoint, const Point2D& _endPoint)
 	: startPoint(_startPoint), endPoint(_endPoint) {}
 
-Point2D LineSegment::getStartPoint() const {
+const Point2D& LineSegment::getStartPoint() const {
 	return startPoint;
 }
 
-Point2D LineSegment::getEndPoint() const {
+const Point2D& LineSegment::getEndPoint() const {
 	return endPoint;
 }
 
+Segment LineSegment::toSegment() const {
+	return Segment(startPoint.toVec2(), endPoint.toVec2());
+}
+
 void LineSegment::setStartPoint(const Point2D& point) {
 	startPoint = point;
 }
@@ -13,8 +13,9 @@ private:
 public:
 	LineSegment(const Point2D& _startPoint, const Point2D& _endPoint);
 
-	Point2D getStartPoint() const;
-	Point2D getEndPoint() const;
+	const Point2D& getStartPoint() const;
+	const Point2D& getEndPoint() const;
+	Segment toSegment() const;
 	void setStartPoint(const Point2D& point);
 	void setEndPoint(const Point2D& point);
 	void draw(PrimitiveRenderer& renderer, sf::Color color, bool useIncrementalAlgorithm = false);
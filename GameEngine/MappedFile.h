@@ -0,0 +1,34 @@
+//MappedFile.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are loaded by the OS on first
+// touch, so opening is cheap and only the bytes actually used are ever read from disk.
+class MappedFile {
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int descriptor;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    const std::uint8_t* getData() const;
+    std::size_t getSize() const;
+};
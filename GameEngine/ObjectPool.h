@@ -0,0 +1,197 @@
+//ObjectPool.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Stable reference to an object living in an ObjectPool.
+// The generation changes every time a slot is reused, so stale handles are detected.
+struct PoolHandle {
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    PoolHandle() : index(0xFFFFFFFFu), generation(0) {}
+    PoolHandle(std::uint32_t _index, std::uint32_t _generation) : index(_index), generation(_generation) {}
+
+    bool isNull() const { return index == 0xFFFFFFFFu; }
+};
+
+// Typed pool with a free list. Objects are constructed in place inside fixed-size
+// blocks that never move, so pointers stay valid until the object is destroyed and
+// creating or destroying objects does not touch the heap once the pool is warm.
+template <typename T, std::size_t BlockSize = 256>
+class ObjectPool {
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        std::uint32_t generation;
+        std::uint32_t nextFree;
+        std::uint32_t denseIndex;
+        bool alive;
+    };
+
+    static const std::uint32_t noSlot = 0xFFFFFFFFu;
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    // Indices of live slots, packed for iteration
+    std::vector<std::uint32_t> dense;
+    std::uint32_t freeHead;
+    std::size_t slotCount;
+
+public:
+    explicit ObjectPool(std::size_t initialCapacity = 0) : freeHead(noSlot), slotCount(0) {
+        reserve(initialCapacity);
+    }
+
+    ~ObjectPool() {
+        clear();
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Grow the pool so that at least 'capacity' objects fit without allocating
+    void reserve(std::size_t capacity) {
+        while (slotCount < capacity) {
+            addBlock();
+        }
+        dense.reserve(capacity);
+    }
+
+    template <typename... Args>
+    PoolHandle create(Args&&... args) {
+        if (freeHead == noSlot) {
+            addBlock();
+        }
+        std::uint32_t index = freeHead;
+        Slot& slot = getSlot(index);
+        new (slot.storage) T(std::forward<Args>(args)...);
+        freeHead = slot.nextFree;
+        slot.alive = true;
+        slot.denseIndex = static_cast<std::uint32_t>(dense.size());
+        dense.push_back(index);
+        return PoolHandle(index, slot.generation);
+    }
+
+    void destroy(PoolHandle handle) {
+        if (!isAlive(handle)) {
+            return;
+        }
+        Slot& slot = getSlot(handle.index);
+        reinterpret_cast<T*>(slot.storage)->~T();
+        slot.alive = false;
+        slot.generation++;
+
+        // Swap-remove from the packed list
+        std::uint32_t moved = dense.back();
+        dense[slot.denseIndex] = moved;
+        getSlot(moved).denseIndex = slot.denseIndex;
+        dense.pop_back();
+
+        slot.nextFree = freeHead;
+        freeHead = handle.index;
+    }
+
+    void clear() {
+        while (!dense.empty()) {
+            std::uint32_t index = dense.back();
+            destroy(PoolHandle(index, getSlot(index).generation));
+        }
+    }
+
+    bool isAlive(PoolHandle handle) const {
+        if (handle.isNull() || handle.index >= slotCount) {
+            return false;
+        }
+        const Slot& slot = getSlot(handle.index);
+        return slot.alive && slot.generation == handle.generation;
+    }
+
+    // Returns nullptr for stale or null handles
+    T* get(PoolHandle handle) {
+        return isAlive(handle) ? reinterpret_cast<T*>(getSlot(handle.index).storage) : nullptr;
+    }
+
+    const T* get(PoolHandle handle) const {
+        return isAlive(handle) ? reinterpret_cast<const T*>(getSlot(handle.index).storage) : nullptr;
+    }
+
+    // Number of live objects; live objects are addressed 0..size()-1 through handleAt()
+    std::size_t size() const {
+        return dense.size();
+    }
+
+    std::size_t capacity() const {
+        return slotCount;
+    }
+
+    PoolHandle handleAt(std::size_t denseIndex) const {
+        std::uint32_t index = dense[denseIndex];
+        return PoolHandle(index, getSlot(index).generation);
+    }
+
+    T& at(std::size_t denseIndex) {
+        return *reinterpret_cast<T*>(getSlot(dense[denseIndex]).storage);
+    }
+
+    template <typename Function>
+    void forEach(Function function) {
+        for (std::size_t i = 0; i < dense.size(); ++i) {
+            function(at(i));
+        }
+    }
+
+private:
+    void addBlock() {
+        std::unique_ptr<Slot[]> block(new Slot[BlockSize]);
+        std::uint32_t first = static_cast<std::uint32_t>(slotCount);
+        // Chain the new slots so they are handed out in index order
+        for (std::size_t i = 0; i < BlockSize; ++i) {
+            block[i].generation = 0;
+            block[i].alive = false;
+            block[i].denseIndex = 0;
+            block[i].nextFree = (i + 1 < BlockSize) ? first + static_cast<std::uint32_t>(i + 1) : freeHead;
+        }
+        blocks.push_back(std::move(block));
+        slotCount += BlockSize;
+        freeHead = first;
+    }
+
+    Slot& getSlot(std::uint32_t index) {
+        return blocks[index / BlockSize][index % BlockSize];
+    }
+
+    const Slot& getSlot(std::uint32_t index) const {
+        return blocks[index / BlockSize][index % BlockSize];
+    }
+};
+
+// Hands out cleared vectors for per-frame temporaries. The vectors keep their
+// capacity between frames, so after the first few frames filling them is free.
+template <typename T>
+class VectorPool {
+private:
+    std::vector<std::unique_ptr<std::vector<T>>> vectors;
+    std::size_t used;
+
+public:
+    VectorPool() : used(0) {}
+
+    std::vector<T>& acquire() {
+        if (used == vectors.size()) {
+            vectors.emplace_back(new std::vector<T>());
+        }
+        std::vector<T>& vector = *vectors[used++];
+        vector.clear();
+        return vector;
+    }
+
+    // Returns every acquired vector to the pool; call once per frame
+    void releaseAll() {
+        used = 0;
+    }
+};
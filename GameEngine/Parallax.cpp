@@ -0,0 +1,73 @@
+//Parallax.cpp
+#include "Parallax.h"
+
+#include <cmath>
+
+ParallaxBackground::ParallaxBackground() : cameraX(0.0), cameraY(0.0) {}
+
+std::size_t ParallaxBackground::addLayer(sf::Texture& texture, const sf::FloatRect& area, sf::Vector2f factor, float scale) {
+	texture.setRepeated(true);
+
+	Layer layer;
+	layer.texture = &texture;
+	layer.factor = factor;
+	layer.scale = scale > 0.f ? scale : 1.f;
+	layer.vertices[0].position = sf::Vector2f(area.left, area.top);
+	layer.vertices[1].position = sf::Vector2f(area.left + area.width, area.top);
+	layer.vertices[2].position = sf::Vector2f(area.left + area.width, area.top + area.height);
+	layer.vertices[3].position = sf::Vector2f(area.left, area.top + area.height);
+	updateTextureCoordinates(layer);
+
+	layers.push_back(layer);
+	return layers.size() - 1;
+}
+
+std::size_t ParallaxBackground::getLayerCount() const {
+	return layers.size();
+}
+
+void ParallaxBackground::setCameraPosition(double x, double y) {
+	cameraX = x;
+	cameraY = y;
+	for (Layer& layer : layers) {
+		updateTextureCoordinates(layer);
+	}
+}
+
+void ParallaxBackground::moveCamera(double dx, double dy) {
+	setCameraPosition(cameraX + dx, cameraY + dy);
+}
+
+void ParallaxBackground::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+	for (const Layer& layer : layers) {
+		states.texture = layer.texture;
+		target.draw(layer.vertices, 4, sf::Quads, states);
+	}
+}
+
+void ParallaxBackground::updateTextureCoordinates(Layer& layer) const {
+	sf::Vector2u textureSize = layer.texture->getSize();
+	if (textureSize.x == 0 || textureSize.y == 0) {
+		return;
+	}
+
+	// Wrap the offset into one texture period in double precision, so the float
+	// texture coordinates stay small and exact however far the camera has moved
+	double u = std::fmod(cameraX * layer.factor.x / layer.scale, static_cast<double>(textureSize.x));
+	double v = std::fmod(cameraY * layer.factor.y / layer.scale, static_cast<double>(textureSize.y));
+	if (u < 0.0) {
+		u += textureSize.x;
+	}
+	if (v < 0.0) {
+		v += textureSize.y;
+	}
+
+	float width = (layer.vertices[1].position.x - layer.vertices[0].position.x) / layer.scale;
+	float height = (layer.vertices[3].position.y - layer.vertices[0].position.y) / layer.scale;
+	float left = static_cast<float>(u);
+	float top = static_cast<float>(v);
+	layer.vertices[0].texCoords = sf::Vector2f(left, top);
+	layer.vertices[1].texCoords = sf::Vector2f(left + width, top);
+	layer.vertices[2].texCoords = sf::Vector2f(left + width, top + height);
+	layer.vertices[3].texCoords = sf::Vector2f(left, top + height);
+}
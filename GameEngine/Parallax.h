@@ -0,0 +1,42 @@
+//Parallax.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Scrolling background made of any number of layers. Each layer is one quad drawn with
+// a repeating texture; scrolling only moves its texture coordinates, so a layer costs
+// a single four-vertex draw no matter how far the camera has travelled.
+class ParallaxBackground : public sf::Drawable {
+private:
+    struct Layer {
+        const sf::Texture* texture;
+        // How far the layer moves per unit of camera movement (0 = fixed, 1 = foreground)
+        sf::Vector2f factor;
+        // Screen pixels per texture pixel
+        float scale;
+        sf::Vertex vertices[4];
+    };
+
+    std::vector<Layer> layers;
+    // Kept in double so long sessions do not lose sub-pixel precision
+    double cameraX;
+    double cameraY;
+
+public:
+    ParallaxBackground();
+
+    // Add a layer covering the screen rectangle 'area'; the texture is switched to repeat mode.
+    // Layers are drawn in the order they are added.
+    std::size_t addLayer(sf::Texture& texture, const sf::FloatRect& area, sf::Vector2f factor, float scale = 1.f);
+    std::size_t getLayerCount() const;
+
+    void setCameraPosition(double x, double y);
+    void moveCamera(double dx, double dy);
+
+protected:
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    void updateTextureCoordinates(Layer& layer) const;
+};
@@ -0,0 +1,203 @@
+//ParticleSystem.cpp
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLES_SSE 1
+#endif
+
+namespace {
+	// Particles per job; a multiple of the SIMD width so only the last range has a scalar tail
+	const std::size_t grainSize = 16384;
+}
+
+ParticleSystem::ParticleSystem(std::size_t _capacity)
+	: capacity(_capacity), count(0), positionX(_capacity), positionY(_capacity), velocityX(_capacity), velocityY(_capacity),
+	life(_capacity), inverseLifetime(_capacity), colors(_capacity), vertices(_capacity),
+	gravity(0.f, 0.f), drag(0.f), randomState(0x9e3779b9u), droppedCount(0) {}
+
+void ParticleSystem::setGravity(sf::Vector2f _gravity) {
+	gravity = _gravity;
+}
+
+void ParticleSystem::setDrag(float _drag) {
+	drag = std::max(_drag, 0.f);
+}
+
+void ParticleSystem::setSeed(std::uint32_t seed) {
+	// xorshift never leaves zero
+	randomState = seed != 0 ? seed : 0x9e3779b9u;
+}
+
+std::size_t ParticleSystem::addEmitter(const ParticleSettings& settings, sf::Vector2f position) {
+	Emitter emitter = { settings, position, 0.f, true };
+	emitters.push_back(emitter);
+	return emitters.size() - 1;
+}
+
+void ParticleSystem::setEmitterPosition(std::size_t emitter, sf::Vector2f position) {
+	emitters[emitter].position = position;
+}
+
+void ParticleSystem::setEmitterActive(std::size_t emitter, bool active) {
+	emitters[emitter].active = active;
+	emitters[emitter].accumulator = 0.f;
+}
+
+void ParticleSystem::burst(const ParticleSettings& settings, sf::Vector2f position, std::size_t amount) {
+	spawn(settings, position, amount);
+	// Draw the new particles even if update() does not run before the next draw
+	buildVertices(count - std::min(count, amount), count);
+}
+
+void ParticleSystem::update(float deltaSeconds, JobSystem* jobs) {
+	for (Emitter& emitter : emitters) {
+		if (!emitter.active) {
+			continue;
+		}
+		emitter.accumulator += emitter.settings.rate * deltaSeconds;
+		const std::size_t amount = static_cast<std::size_t>(emitter.accumulator);
+		emitter.accumulator -= static_cast<float>(amount);
+		spawn(emitter.settings, emitter.position, amount);
+	}
+
+	// Implicit drag stays stable however large the step is
+	const float damping = 1.f / (1.f + drag * deltaSeconds);
+	if (jobs) {
+		jobs->parallelFor(count, grainSize, [this, deltaSeconds, damping](std::size_t begin, std::size_t end) {
+			integrate(begin, end, deltaSeconds, damping);
+		});
+	}
+	else {
+		integrate(0, count, deltaSeconds, damping);
+	}
+
+	compact();
+
+	if (jobs) {
+		jobs->parallelFor(count, grainSize, [this](std::size_t begin, std::size_t end) {
+			buildVertices(begin, end);
+		});
+	}
+	else {
+		buildVertices(0, count);
+	}
+}
+
+void ParticleSystem::clear() {
+	count = 0;
+	for (Emitter& emitter : emitters) {
+		emitter.accumulator = 0.f;
+	}
+}
+
+std::size_t ParticleSystem::getCount() const {
+	return count;
+}
+
+std::size_t ParticleSystem::getCapacity() const {
+	return capacity;
+}
+
+std::size_t ParticleSystem::getDroppedCount() const {
+	return droppedCount;
+}
+
+void ParticleSystem::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+	if (count > 0) {
+		target.draw(vertices.data(), count, sf::Points, states);
+	}
+}
+
+void ParticleSystem::spawn(const ParticleSettings& settings, sf::Vector2f position, std::size_t amount) {
+	if (amount > capacity - count) {
+		droppedCount += amount - (capacity - count);
+		amount = capacity - count;
+	}
+	const sf::Vector2f halfSpread = settings.spread * 0.5f;
+	for (std::size_t end = count + amount; count < end; ++count) {
+		positionX[count] = position.x + random(-halfSpread.x, halfSpread.x);
+		positionY[count] = position.y + random(-halfSpread.y, halfSpread.y);
+		velocityX[count] = random(settings.minVelocity.x, settings.maxVelocity.x);
+		velocityY[count] = random(settings.minVelocity.y, settings.maxVelocity.y);
+		const float lifetime = std::max(random(settings.minLifetime, settings.maxLifetime), 1e-3f);
+		life[count] = lifetime;
+		inverseLifetime[count] = 1.f / lifetime;
+		colors[count] = settings.color;
+	}
+}
+
+void ParticleSystem::integrate(std::size_t begin, std::size_t end, float deltaSeconds, float damping) {
+	float* px = positionX.data();
+	float* py = positionY.data();
+	float* vx = velocityX.data();
+	float* vy = velocityY.data();
+	float* remaining = life.data();
+	const float gravityX = gravity.x * deltaSeconds;
+	const float gravityY = gravity.y * deltaSeconds;
+
+	std::size_t i = begin;
+#if PARTICLES_SSE
+	const __m128 step = _mm_set1_ps(deltaSeconds);
+	const __m128 dampingLanes = _mm_set1_ps(damping);
+	const __m128 gravityXLanes = _mm_set1_ps(gravityX);
+	const __m128 gravityYLanes = _mm_set1_ps(gravityY);
+	for (; i + 4 <= end; i += 4) {
+		// Semi-implicit Euler: the new velocity moves the particle
+		const __m128 newVx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), gravityXLanes), dampingLanes);
+		const __m128 newVy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), gravityYLanes), dampingLanes);
+		_mm_storeu_ps(vx + i, newVx);
+		_mm_storeu_ps(vy + i, newVy);
+		_mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(newVx, step)));
+		_mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(newVy, step)));
+		_mm_storeu_ps(remaining + i, _mm_sub_ps(_mm_loadu_ps(remaining + i), step));
+	}
+#endif
+	for (; i < end; ++i) {
+		vx[i] = (vx[i] + gravityX) * damping;
+		vy[i] = (vy[i] + gravityY) * damping;
+		px[i] += vx[i] * deltaSeconds;
+		py[i] += vy[i] * deltaSeconds;
+		remaining[i] -= deltaSeconds;
+	}
+}
+
+void ParticleSystem::compact() {
+	std::size_t i = 0;
+	while (i < count) {
+		if (life[i] > 0.f) {
+			++i;
+			continue;
+		}
+		// Move the last particle into the hole; it is checked on the next pass of the loop
+		const std::size_t last = --count;
+		positionX[i] = positionX[last];
+		positionY[i] = positionY[last];
+		velocityX[i] = velocityX[last];
+		velocityY[i] = velocityY[last];
+		life[i] = life[last];
+		inverseLifetime[i] = inverseLifetime[last];
+		colors[i] = colors[last];
+	}
+}
+
+void ParticleSystem::buildVertices(std::size_t begin, std::size_t end) {
+	for (std::size_t i = begin; i < end; ++i) {
+		sf::Vertex& vertex = vertices[i];
+		vertex.position.x = positionX[i];
+		vertex.position.y = positionY[i];
+		vertex.color = colors[i];
+		const float fade = std::min(life[i] * inverseLifetime[i], 1.f);
+		vertex.color.a = static_cast<sf::Uint8>(colors[i].a * fade);
+	}
+}
+
+float ParticleSystem::random(float low, float high) {
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	// Top 24 bits give an exact float in [0, 1)
+	return low + (high - low) * static_cast<float>(randomState >> 8) * (1.f / 16777216.f);
+}
@@ -0,0 +1,98 @@
+//ParticleSystem.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// How an emitter or a burst creates particles
+struct ParticleSettings {
+    // Particles per second for emitters; bursts ignore it
+    float rate;
+    // Spawn area: a rectangle of this size centered on the emitter position
+    sf::Vector2f spread;
+    // Initial velocity in pixels per second, picked uniformly between the two
+    sf::Vector2f minVelocity;
+    sf::Vector2f maxVelocity;
+    // Lifetime in seconds, picked uniformly between the two
+    float minLifetime;
+    float maxLifetime;
+    // The alpha fades to zero over the lifetime
+    sf::Color color;
+
+    ParticleSettings()
+        : rate(0.f), spread(0.f, 0.f), minVelocity(0.f, 0.f), maxVelocity(0.f, 0.f),
+        minLifetime(1.f), maxLifetime(1.f), color(sf::Color::White) {}
+};
+
+// Point particles kept as structure of arrays, so the update streams through a few
+// float arrays and integrates four particles per SSE instruction. Dead particles are
+// swapped with the last live one, which keeps the live range packed at the front.
+// All live particles are drawn as one batch of points.
+class ParticleSystem : public sf::Drawable {
+private:
+    struct Emitter {
+        ParticleSettings settings;
+        sf::Vector2f position;
+        // Fraction of a particle carried over to the next update
+        float accumulator;
+        bool active;
+    };
+
+    std::size_t capacity;
+    std::size_t count;
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    // Seconds left to live, and the inverse of the full lifetime for fading
+    std::vector<float> life;
+    std::vector<float> inverseLifetime;
+    std::vector<sf::Color> colors;
+    std::vector<sf::Vertex> vertices;
+
+    std::vector<Emitter> emitters;
+    sf::Vector2f gravity;
+    float drag;
+    // Seeded per system so replays spawn the same particles
+    std::uint32_t randomState;
+    std::size_t droppedCount;
+
+public:
+    explicit ParticleSystem(std::size_t _capacity);
+
+    // Constant acceleration in pixels per second squared
+    void setGravity(sf::Vector2f _gravity);
+    // Fraction of the velocity lost per second
+    void setDrag(float _drag);
+    void setSeed(std::uint32_t seed);
+
+    // Emitters spawn 'rate' particles per second from update() while active
+    std::size_t addEmitter(const ParticleSettings& settings, sf::Vector2f position);
+    void setEmitterPosition(std::size_t emitter, sf::Vector2f position);
+    void setEmitterActive(std::size_t emitter, bool active);
+    // Spawn 'amount' particles at once, e.g. dust when landing
+    void burst(const ParticleSettings& settings, sf::Vector2f position, std::size_t amount);
+
+    // Run the emitters, integrate every particle and drop the dead ones.
+    // With a job system the integration and vertex building are split over its workers.
+    void update(float deltaSeconds, JobSystem* jobs = nullptr);
+    void clear();
+
+    std::size_t getCount() const;
+    std::size_t getCapacity() const;
+    // Particles not spawned because the system was full
+    std::size_t getDroppedCount() const;
+
+protected:
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    void spawn(const ParticleSettings& settings, sf::Vector2f position, std::size_t amount);
+    void integrate(std::size_t begin, std::size_t end, float deltaSeconds, float damping);
+    void compact();
+    void buildVertices(std::size_t begin, std::size_t end);
+    float random(float low, float high);
+};
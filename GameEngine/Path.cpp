@@ -0,0 +1,312 @@
+//Path.cpp
+#include "Path.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+	const float pi = 3.141592654f;
+	// Deep enough for any curve that fits on screen at sub-pixel tolerance
+	const int maxSubdivisionDepth = 16;
+	const std::uint32_t minEllipseSegments = 4;
+	const std::uint32_t maxEllipseSegments = 1024;
+	// Scale buckets per doubling of the scale
+	const float bucketsPerOctave = 4.f;
+
+	std::atomic<std::uint64_t> nextPathId(1);
+
+	float length(const Vec2& vector) {
+		return std::sqrt(vector.lengthSquared());
+	}
+
+	// The curve stays within |p0 - 2c + p2| / 4 of its chord
+	void flattenQuadratic(const Vec2& p0, const Vec2& c, const Vec2& p2, float tolerance, int depth, std::vector<Vec2>& output) {
+		if (depth >= maxSubdivisionDepth || length(p0 - c * 2.f + p2) * 0.25f <= tolerance) {
+			output.push_back(p2);
+			return;
+		}
+		const Vec2 c0 = (p0 + c) * 0.5f;
+		const Vec2 c1 = (c + p2) * 0.5f;
+		const Vec2 middle = (c0 + c1) * 0.5f;
+		flattenQuadratic(p0, c0, middle, tolerance, depth + 1, output);
+		flattenQuadratic(middle, c1, p2, tolerance, depth + 1, output);
+	}
+
+	// The curve stays within 3/4 of the larger second difference of its control points from its chord
+	void flattenCubic(const Vec2& p0, const Vec2& c1, const Vec2& c2, const Vec2& p3, float tolerance, int depth, std::vector<Vec2>& output) {
+		const float error = std::max(length(p0 - c1 * 2.f + c2), length(c1 - c2 * 2.f + p3)) * 0.75f;
+		if (depth >= maxSubdivisionDepth || error <= tolerance) {
+			output.push_back(p3);
+			return;
+		}
+		const Vec2 a = (p0 + c1) * 0.5f;
+		const Vec2 b = (c1 + c2) * 0.5f;
+		const Vec2 c = (c2 + p3) * 0.5f;
+		const Vec2 ab = (a + b) * 0.5f;
+		const Vec2 bc = (b + c) * 0.5f;
+		const Vec2 middle = (ab + bc) * 0.5f;
+		flattenCubic(p0, a, ab, middle, tolerance, depth + 1, output);
+		flattenCubic(middle, bc, c, p3, tolerance, depth + 1, output);
+	}
+
+	Vec2 pointOnEllipse(const Vec2& center, const Vec2& radii, float degrees) {
+		const float radians = degrees * pi / 180.f;
+		return Vec2(center.x + radii.x * std::cos(radians), center.y + radii.y * std::sin(radians));
+	}
+}
+
+Path::Path() : id(nextPathId++) {}
+
+Path& Path::moveTo(float x, float y) {
+	verbs.push_back(MoveTo);
+	points.push_back(Vec2(x, y));
+	changed();
+	return *this;
+}
+
+Path& Path::lineTo(float x, float y) {
+	verbs.push_back(LineTo);
+	points.push_back(Vec2(x, y));
+	changed();
+	return *this;
+}
+
+Path& Path::quadTo(float controlX, float controlY, float x, float y) {
+	verbs.push_back(QuadTo);
+	points.push_back(Vec2(controlX, controlY));
+	points.push_back(Vec2(x, y));
+	changed();
+	return *this;
+}
+
+Path& Path::cubicTo(float control1X, float control1Y, float control2X, float control2Y, float x, float y) {
+	verbs.push_back(CubicTo);
+	points.push_back(Vec2(control1X, control1Y));
+	points.push_back(Vec2(control2X, control2Y));
+	points.push_back(Vec2(x, y));
+	changed();
+	return *this;
+}
+
+Path& Path::arc(float centerX, float centerY, float radiusX, float radiusY, float startAngle, float sweepAngle) {
+	const Vec2 start = pointOnEllipse(Vec2(centerX, centerY), Vec2(radiusX, radiusY), startAngle);
+	if (verbs.empty() || verbs.back() == Close) {
+		moveTo(start.x, start.y);
+	}
+	else {
+		lineTo(start.x, start.y);
+	}
+	verbs.push_back(ArcTo);
+	points.push_back(Vec2(centerX, centerY));
+	points.push_back(Vec2(radiusX, radiusY));
+	points.push_back(Vec2(startAngle, sweepAngle));
+	changed();
+	return *this;
+}
+
+Path& Path::close() {
+	verbs.push_back(Close);
+	changed();
+	return *this;
+}
+
+void Path::clear() {
+	verbs.clear();
+	points.clear();
+	changed();
+}
+
+bool Path::isEmpty() const {
+	return verbs.empty();
+}
+
+std::uint64_t Path::getId() const {
+	return id;
+}
+
+const std::vector<std::uint8_t>& Path::getVerbs() const {
+	return verbs;
+}
+
+const std::vector<Vec2>& Path::getPoints() const {
+	return points;
+}
+
+void Path::changed() {
+	id = nextPathId++;
+}
+
+void FlattenedPath::clear() {
+	points.clear();
+	contours.clear();
+}
+
+void flattenPath(const Path& path, float tolerance, FlattenedPath& output) {
+	output.clear();
+	tolerance = std::max(tolerance, 1e-4f);
+	const std::vector<Vec2>& points = path.getPoints();
+
+	Vec2 current, contourStart;
+	bool inContour = false;
+	auto finishContour = [&output, &inContour](bool closed) {
+		if (!inContour) {
+			return;
+		}
+		FlattenedPath::Contour& contour = output.contours.back();
+		contour.count = static_cast<std::uint32_t>(output.points.size() - contour.first);
+		contour.closed = closed;
+		// A contour that never left its first point has nothing to draw
+		if (contour.count < 2) {
+			output.points.resize(contour.first);
+			output.contours.pop_back();
+		}
+		inContour = false;
+	};
+	auto beginContour = [&output, &inContour, &contourStart](const Vec2& start) {
+		FlattenedPath::Contour contour = { static_cast<std::uint32_t>(output.points.size()), 0, false };
+		output.contours.push_back(contour);
+		output.points.push_back(start);
+		contourStart = start;
+		inContour = true;
+	};
+
+	std::size_t p = 0;
+	for (std::uint8_t verb : path.getVerbs()) {
+		if (verb == Path::MoveTo) {
+			finishContour(false);
+			current = points[p++];
+			beginContour(current);
+			continue;
+		}
+		if (verb == Path::Close) {
+			finishContour(true);
+			current = contourStart;
+			continue;
+		}
+		if (!inContour) {
+			beginContour(current);
+		}
+
+		switch (verb) {
+		case Path::LineTo:
+			current = points[p++];
+			output.points.push_back(current);
+			break;
+		case Path::QuadTo:
+			flattenQuadratic(current, points[p], points[p + 1], tolerance, 0, output.points);
+			current = points[p + 1];
+			p += 2;
+			break;
+		case Path::CubicTo:
+			flattenCubic(current, points[p], points[p + 1], points[p + 2], tolerance, 0, output.points);
+			current = points[p + 2];
+			p += 3;
+			break;
+		case Path::ArcTo: {
+			const Vec2& center = points[p];
+			const Vec2& radii = points[p + 1];
+			const float startAngle = points[p + 2].x;
+			const float sweepAngle = points[p + 2].y;
+			p += 3;
+			const std::uint32_t fullCount = ellipseSegmentCount(std::max(std::fabs(radii.x), std::fabs(radii.y)), tolerance);
+			const std::uint32_t count = std::max(1u, static_cast<std::uint32_t>(std::ceil(fullCount * std::fabs(sweepAngle) / 360.f)));
+			for (std::uint32_t i = 1; i <= count; ++i) {
+				output.points.push_back(pointOnEllipse(center, radii, startAngle + sweepAngle * i / count));
+			}
+			current = output.points.back();
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	finishContour(false);
+}
+
+std::uint32_t ellipseSegmentCount(float radius, float tolerance) {
+	if (!(radius > tolerance)) {
+		return minEllipseSegments;
+	}
+	// A chord spanning 'step' radians strays radius * (1 - cos(step / 2)) from the arc
+	const float step = 2.f * std::acos(1.f - tolerance / radius);
+	const float count = std::ceil(2.f * pi / step);
+	if (!(count < static_cast<float>(maxEllipseSegments))) {
+		return maxEllipseSegments;
+	}
+	return std::max(minEllipseSegments, static_cast<std::uint32_t>(count));
+}
+
+TessellationCache::TessellationCache(float _tolerance)
+	: tolerance(_tolerance), frame(0), maxIdleFrames(120), hits(0), misses(0) {}
+
+void TessellationCache::setTolerance(float _tolerance) {
+	if (_tolerance != tolerance) {
+		tolerance = _tolerance;
+		clear();
+	}
+}
+
+float TessellationCache::getTolerance() const {
+	return tolerance;
+}
+
+const FlattenedPath& TessellationCache::getPath(const Path& path, float scale) {
+	// Round the scale up to its bucket, so the flattening is fine enough for every scale in it
+	const int bucket = static_cast<int>(std::ceil(std::log2(std::max(scale, 1e-6f)) * bucketsPerOctave));
+	const std::uint64_t key = (path.getId() << 10) | static_cast<std::uint64_t>((bucket + 512) & 1023);
+
+	auto found = paths.find(key);
+	if (found != paths.end()) {
+		++hits;
+		found->second.lastUsed = frame;
+		return found->second.flattened;
+	}
+
+	++misses;
+	Entry& entry = paths[key];
+	entry.lastUsed = frame;
+	flattenPath(path, tolerance / std::exp2(bucket / bucketsPerOctave), entry.flattened);
+	return entry.flattened;
+}
+
+const std::vector<Vec2>& TessellationCache::getCircle(float radius) {
+	const std::uint32_t count = ellipseSegmentCount(radius, tolerance);
+	std::vector<Vec2>& circle = circles[count];
+	if (circle.empty()) {
+		circle.reserve(count);
+		for (std::uint32_t i = 0; i < count; ++i) {
+			const float angle = 2.f * pi * i / count;
+			circle.push_back(Vec2(std::cos(angle), std::sin(angle)));
+		}
+	}
+	return circle;
+}
+
+void TessellationCache::endFrame() {
+	++frame;
+	// Sweep for idle paths now and then rather than every frame
+	if (frame % 64 != 0) {
+		return;
+	}
+	for (auto it = paths.begin(); it != paths.end();) {
+		if (frame - it->second.lastUsed > maxIdleFrames) {
+			it = paths.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void TessellationCache::clear() {
+	paths.clear();
+	circles.clear();
+}
+
+std::size_t TessellationCache::getHitCount() const {
+	return hits;
+}
+
+std::size_t TessellationCache::getMissCount() const {
+	return misses;
+}
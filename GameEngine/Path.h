@@ -0,0 +1,106 @@
+//Path.h
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Geometry.h"
+
+// Vector path made of straight lines, Bezier curves and elliptic arcs.
+// Every edit gives the path a new id, which is what tessellations are cached under.
+class Path {
+public:
+    enum Verb : std::uint8_t {
+        MoveTo,     // 1 point
+        LineTo,     // 1 point
+        QuadTo,     // control, end
+        CubicTo,    // control 1, control 2, end
+        ArcTo,      // center, radii, (start angle, sweep angle) in degrees
+        Close       // no points
+    };
+
+private:
+    std::vector<std::uint8_t> verbs;
+    std::vector<Vec2> points;
+    std::uint64_t id;
+
+public:
+    Path();
+
+    Path& moveTo(float x, float y);
+    Path& lineTo(float x, float y);
+    Path& quadTo(float controlX, float controlY, float x, float y);
+    Path& cubicTo(float control1X, float control1Y, float control2X, float control2Y, float x, float y);
+    // Elliptic arc around (centerX, centerY), clockwise on screen for positive sweeps.
+    // It is joined to the current point with a line, or starts a new contour if there is none.
+    Path& arc(float centerX, float centerY, float radiusX, float radiusY, float startAngle, float sweepAngle);
+    Path& close();
+    void clear();
+
+    bool isEmpty() const;
+    std::uint64_t getId() const;
+    const std::vector<std::uint8_t>& getVerbs() const;
+    const std::vector<Vec2>& getPoints() const;
+
+private:
+    void changed();
+};
+
+// A path turned into straight segments: one run of points per contour
+struct FlattenedPath {
+    struct Contour {
+        std::uint32_t first;
+        std::uint32_t count;
+        bool closed;
+    };
+
+    std::vector<Vec2> points;
+    std::vector<Contour> contours;
+
+    void clear();
+};
+
+// Flatten 'path' so no segment strays more than 'tolerance' path units from the true curve.
+// Curves are subdivided adaptively, so flat stretches get few points and tight bends many.
+void flattenPath(const Path& path, float tolerance, FlattenedPath& output);
+
+// Segments needed for a full ellipse whose larger radius is 'radius' screen pixels
+std::uint32_t ellipseSegmentCount(float radius, float tolerance);
+
+// Flattenings shared by every path, circle and ellipse drawn through the renderer.
+// Paths are cached per id and scale bucket (scales within 19% of each other share one),
+// so moving or rotating a path reuses its flattening and only scaling far enough re-flattens.
+// Entries not used for a number of frames are dropped by endFrame().
+class TessellationCache {
+private:
+    struct Entry {
+        FlattenedPath flattened;
+        std::uint32_t lastUsed;
+    };
+
+    std::unordered_map<std::uint64_t, Entry> paths;
+    // Unit circles indexed by segment count
+    std::unordered_map<std::uint32_t, std::vector<Vec2>> circles;
+    float tolerance;
+    std::uint32_t frame;
+    std::uint32_t maxIdleFrames;
+    std::size_t hits;
+    std::size_t misses;
+
+public:
+    explicit TessellationCache(float _tolerance = 0.25f);
+
+    // Maximum distance in screen pixels between a curve and its flattening; clears the cache
+    void setTolerance(float _tolerance);
+    float getTolerance() const;
+
+    // Flattening of 'path' in path space, fine enough for drawing it at 'scale'
+    const FlattenedPath& getPath(const Path& path, float scale);
+    // Points of a unit circle with enough segments for a radius of 'radius' screen pixels
+    const std::vector<Vec2>& getCircle(float radius);
+
+    void endFrame();
+    void clear();
+    std::size_t getHitCount() const;
+    std::size_t getMissCount() const;
+};
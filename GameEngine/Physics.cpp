@@ -0,0 +1,560 @@
+//Physics.cpp
+#include "Physics.h"
+#include <algorithm>
+#include <cmath>
+
+const PhysicsWorld::BodyId PhysicsWorld::invalidBody;
+
+namespace {
+	// Penetration left alone, and the share of the rest removed per step, in pixels
+	const float penetrationSlop = 0.5f;
+	const float correctionPercent = 0.8f;
+	// Slower than this (pixels per second) for sleepDelay seconds puts a body to sleep
+	const float sleepSpeed = 4.f;
+	const float sleepDelay = 0.5f;
+	// Impacts slower than this do not bounce, so resting contacts settle
+	const float bounceSpeed = 30.f;
+	// Contact normals steeper than this count as standing on something
+	const float groundSlope = 0.7f;
+
+	float length(const Vec2& vector) {
+		return std::sqrt(vector.lengthSquared());
+	}
+
+	// Entry time of the ray 'origin + motion * t' into 'box' for t in [0, 1], or 1 when it
+	// misses or starts inside. 'normal' gets the face that was crossed.
+	float rayBox(const Vec2& origin, const Vec2& motion, const AABB& box, Vec2& normal) {
+		float entry = 0.f, exit = 1.f;
+		Vec2 entryNormal;
+		const float origins[2] = { origin.x, origin.y };
+		const float motions[2] = { motion.x, motion.y };
+		const float mins[2] = { box.min.x, box.min.y };
+		const float maxs[2] = { box.max.x, box.max.y };
+		for (int axis = 0; axis < 2; ++axis) {
+			if (motions[axis] == 0.f) {
+				if (origins[axis] <= mins[axis] || origins[axis] >= maxs[axis]) {
+					return 1.f;
+				}
+				continue;
+			}
+			const float inverse = 1.f / motions[axis];
+			float near = (mins[axis] - origins[axis]) * inverse;
+			float far = (maxs[axis] - origins[axis]) * inverse;
+			float side = -1.f;
+			if (near > far) {
+				std::swap(near, far);
+				side = 1.f;
+			}
+			if (near > entry) {
+				entry = near;
+				entryNormal = axis == 0 ? Vec2(side, 0.f) : Vec2(0.f, side);
+			}
+			exit = std::min(exit, far);
+			if (entry > exit) {
+				return 1.f;
+			}
+		}
+		// Starting inside is left to the contact solver
+		if (entry <= 0.f) {
+			return 1.f;
+		}
+		normal = entryNormal;
+		return entry;
+	}
+
+	// Entry time of the ray into a circle around 'center', or 1 when it misses or starts inside
+	float rayCircle(const Vec2& origin, const Vec2& motion, const Vec2& center, float radius, Vec2& normal) {
+		const Vec2 offset = origin - center;
+		const float a = motion.lengthSquared();
+		const float b = offset.dot(motion);
+		const float c = offset.lengthSquared() - radius * radius;
+		if (a == 0.f || c <= 0.f || b >= 0.f) {
+			return 1.f;
+		}
+		const float discriminant = b * b - a * c;
+		if (discriminant < 0.f) {
+			return 1.f;
+		}
+		const float t = (-b - std::sqrt(discriminant)) / a;
+		if (t < 0.f || t >= 1.f) {
+			return 1.f;
+		}
+		normal = (offset + motion * t) / radius;
+		return t;
+	}
+}
+
+PhysicsWorld::PhysicsWorld(float _fixedStep, float cellSize)
+	: broadphase(cellSize), gravity(0.f, 980.f), fixedStep(_fixedStep), accumulator(0.f), maxStepsPerUpdate(8),
+	velocityIterations(8), bodyCount(0) {}
+
+void PhysicsWorld::setGravity(const Vec2& _gravity) {
+	gravity = _gravity;
+}
+
+const Vec2& PhysicsWorld::getGravity() const {
+	return gravity;
+}
+
+PhysicsWorld::BodyId PhysicsWorld::createBody(const BodyDefinition& definition) {
+	BodyId id;
+	if (!freeBodies.empty()) {
+		id = freeBodies.back();
+		freeBodies.pop_back();
+	}
+	else {
+		id = static_cast<BodyId>(bodies.size());
+		bodies.push_back(Body());
+	}
+
+	Body& body = bodies[id];
+	body.type = definition.type;
+	body.shape = definition.shape;
+	body.position = definition.position;
+	body.previousPosition = definition.position;
+	body.velocity = definition.type == StaticBody ? Vec2() : definition.velocity;
+	body.force = Vec2();
+	body.halfExtents = definition.shape == BodyCircle ? Vec2(definition.radius, definition.radius) : definition.halfExtents;
+	body.radius = definition.radius;
+	body.inverseMass = definition.type == DynamicBody && definition.mass > 0.f ? 1.f / definition.mass : 0.f;
+	body.restitution = definition.restitution;
+	body.friction = definition.friction;
+	body.gravityScale = definition.gravityScale;
+	body.damping = definition.damping;
+	body.sleepTime = 0.f;
+	body.category = definition.category;
+	body.collidesWith = definition.collidesWith;
+	body.bullet = definition.bullet;
+	body.alive = true;
+	body.awake = definition.type != StaticBody;
+	body.grounded = false;
+
+	broadphase.insert(id, computeBounds(body));
+	++bodyCount;
+	return id;
+}
+
+std::uint64_t PhysicsWorld::pairKey(BodyId a, BodyId b) {
+	return (static_cast<std::uint64_t>(a) << 32) | b;
+}
+
+bool PhysicsWorld::canCollide(const Body& a, const Body& b) {
+	return (a.category & b.collidesWith) != 0 && (b.category & a.collidesWith) != 0;
+}
+
+void PhysicsWorld::destroyBody(BodyId body) {
+	if (!isValid(body)) {
+		return;
+	}
+	// Whatever rested on it has to fall now
+	candidates.clear();
+	broadphase.query(computeBounds(bodies[body]), candidates);
+	for (std::uint32_t other : candidates) {
+		wake(other);
+	}
+	broadphase.remove(body);
+	bodies[body].alive = false;
+	freeBodies.push_back(body);
+	--bodyCount;
+}
+
+bool PhysicsWorld::isValid(BodyId body) const {
+	return body < bodies.size() && bodies[body].alive;
+}
+
+const Vec2& PhysicsWorld::getPosition(BodyId body) const {
+	return bodies[body].position;
+}
+
+Vec2 PhysicsWorld::getInterpolatedPosition(BodyId body) const {
+	const Body& b = bodies[body];
+	const float alpha = accumulator / fixedStep;
+	return b.previousPosition + (b.position - b.previousPosition) * alpha;
+}
+
+void PhysicsWorld::setPosition(BodyId body, const Vec2& position) {
+	Body& b = bodies[body];
+	b.position = position;
+	b.previousPosition = position;
+	broadphase.update(body, computeBounds(b));
+	wake(body);
+}
+
+const Vec2& PhysicsWorld::getVelocity(BodyId body) const {
+	return bodies[body].velocity;
+}
+
+void PhysicsWorld::setVelocity(BodyId body, const Vec2& velocity) {
+	Body& b = bodies[body];
+	if (b.type == StaticBody) {
+		return;
+	}
+	b.velocity = velocity;
+	wake(body);
+}
+
+void PhysicsWorld::applyImpulse(BodyId body, const Vec2& impulse) {
+	Body& b = bodies[body];
+	b.velocity += impulse * b.inverseMass;
+	wake(body);
+}
+
+void PhysicsWorld::applyForce(BodyId body, const Vec2& force) {
+	bodies[body].force += force;
+	wake(body);
+}
+
+void PhysicsWorld::wake(BodyId body) {
+	Body& b = bodies[body];
+	if (b.alive && b.type != StaticBody) {
+		b.awake = true;
+		b.sleepTime = 0.f;
+	}
+}
+
+bool PhysicsWorld::isAwake(BodyId body) const {
+	return bodies[body].awake;
+}
+
+bool PhysicsWorld::isGrounded(BodyId body) const {
+	return bodies[body].grounded;
+}
+
+int PhysicsWorld::update(float seconds) {
+	accumulator += seconds;
+	int steps = 0;
+	while (accumulator >= fixedStep && steps < maxStepsPerUpdate) {
+		step();
+		accumulator -= fixedStep;
+		++steps;
+	}
+	if (steps == maxStepsPerUpdate) {
+		accumulator = std::min(accumulator, fixedStep);
+	}
+	return steps;
+}
+
+void PhysicsWorld::step() {
+	active.clear();
+	for (BodyId id = 0; id < bodies.size(); ++id) {
+		Body& body = bodies[id];
+		if (!body.alive || !body.awake) {
+			continue;
+		}
+		active.push_back(id);
+		body.previousPosition = body.position;
+		body.grounded = false;
+		if (body.type != DynamicBody) {
+			continue;
+		}
+		// Semi-implicit Euler: velocities first, then positions move with the new velocity
+		body.velocity += (gravity * body.gravityScale + body.force * body.inverseMass) * fixedStep;
+		body.velocity *= 1.f / (1.f + body.damping * fixedStep);
+		body.force = Vec2();
+	}
+
+	findContacts();
+	solveVelocities();
+	wakeTouched();
+	integratePositions();
+	correctPositions();
+	updateSleep();
+}
+
+float PhysicsWorld::getFixedStep() const {
+	return fixedStep;
+}
+
+std::size_t PhysicsWorld::getBodyCount() const {
+	return bodyCount;
+}
+
+std::size_t PhysicsWorld::getAwakeCount() const {
+	return active.size();
+}
+
+std::size_t PhysicsWorld::getContactCount() const {
+	return contacts.size();
+}
+
+AABB PhysicsWorld::computeBounds(const Body& body) const {
+	return AABB(body.position - body.halfExtents, body.position + body.halfExtents);
+}
+
+void PhysicsWorld::findContacts() {
+	contacts.clear();
+	for (BodyId a : active) {
+		candidates.clear();
+		broadphase.query(computeBounds(bodies[a]), candidates);
+		for (std::uint32_t b : candidates) {
+			const Body& other = bodies[b];
+			// Pairs of two moving bodies are found from both sides; keep the one from the lower id
+			const bool otherActive = other.awake && other.type != StaticBody;
+			if (b == a || (otherActive && b < a)) {
+				continue;
+			}
+			// Two bodies that cannot be pushed have nothing to resolve
+			if ((bodies[a].inverseMass == 0.f && other.inverseMass == 0.f) || !canCollide(bodies[a], other)) {
+				continue;
+			}
+			Contact contact;
+			if (collide(a, b, contact)) {
+				contacts.push_back(contact);
+			}
+		}
+	}
+
+	for (const Contact& contact : contacts) {
+		Body& a = bodies[contact.a];
+		Body& b = bodies[contact.b];
+		if (contact.normal.y > groundSlope) {
+			a.grounded = true;
+		}
+		if (contact.normal.y < -groundSlope) {
+			b.grounded = true;
+		}
+	}
+}
+
+bool PhysicsWorld::collide(BodyId a, BodyId b, Contact& contact) const {
+	const Body& first = bodies[a];
+	const Body& second = bodies[b];
+	contact.a = a;
+	contact.b = b;
+	const Vec2 offset = second.position - first.position;
+
+	if (first.shape == BodyCircle && second.shape == BodyCircle) {
+		const float radii = first.radius + second.radius;
+		const float distanceSquared = offset.lengthSquared();
+		if (distanceSquared >= radii * radii) {
+			return false;
+		}
+		const float distance = std::sqrt(distanceSquared);
+		contact.normal = distance > 0.f ? offset / distance : Vec2(0.f, 1.f);
+		contact.penetration = radii - distance;
+		return true;
+	}
+
+	if (first.shape == BodyBox && second.shape == BodyBox) {
+		const float overlapX = first.halfExtents.x + second.halfExtents.x - std::fabs(offset.x);
+		const float overlapY = first.halfExtents.y + second.halfExtents.y - std::fabs(offset.y);
+		if (overlapX <= 0.f || overlapY <= 0.f) {
+			return false;
+		}
+		// Separate along the axis of least overlap
+		if (overlapX < overlapY) {
+			contact.normal = Vec2(offset.x < 0.f ? -1.f : 1.f, 0.f);
+			contact.penetration = overlapX;
+		}
+		else {
+			contact.normal = Vec2(0.f, offset.y < 0.f ? -1.f : 1.f);
+			contact.penetration = overlapY;
+		}
+		return true;
+	}
+
+	// Circle against box, worked out from the circle's side and flipped if the box came first
+	const bool circleFirst = first.shape == BodyCircle;
+	const Body& circle = circleFirst ? first : second;
+	const Body& box = circleFirst ? second : first;
+	const Vec2 relative = circle.position - box.position;
+	const Vec2 closest(std::max(-box.halfExtents.x, std::min(relative.x, box.halfExtents.x)),
+		std::max(-box.halfExtents.y, std::min(relative.y, box.halfExtents.y)));
+	Vec2 normal;
+	float penetration;
+	if (closest == relative) {
+		// The center is inside the box: push out through the nearest face
+		const float distanceX = box.halfExtents.x - std::fabs(relative.x);
+		const float distanceY = box.halfExtents.y - std::fabs(relative.y);
+		if (distanceX < distanceY) {
+			normal = Vec2(relative.x < 0.f ? -1.f : 1.f, 0.f);
+			penetration = distanceX + circle.radius;
+		}
+		else {
+			normal = Vec2(0.f, relative.y < 0.f ? -1.f : 1.f);
+			penetration = distanceY + circle.radius;
+		}
+	}
+	else {
+		const Vec2 toCircle = relative - closest;
+		const float distanceSquared = toCircle.lengthSquared();
+		if (distanceSquared >= circle.radius * circle.radius) {
+			return false;
+		}
+		const float distance = std::sqrt(distanceSquared);
+		normal = toCircle / distance;
+		penetration = circle.radius - distance;
+	}
+	// 'normal' points from the box to the circle
+	contact.normal = circleFirst ? -normal : normal;
+	contact.penetration = penetration;
+	return true;
+}
+
+void PhysicsWorld::solveVelocities() {
+	for (Contact& contact : contacts) {
+		Body& a = bodies[contact.a];
+		Body& b = bodies[contact.b];
+		const float normalSpeed = (b.velocity - a.velocity).dot(contact.normal);
+		contact.inverseMassA = a.inverseMass;
+		contact.inverseMassB = b.awake ? b.inverseMass : 0.f;
+		contact.approachSpeed = -normalSpeed;
+		contact.bounce = normalSpeed < -bounceSpeed ? -normalSpeed * std::max(a.restitution, b.restitution) : 0.f;
+
+		// Resting contacts need about the same impulses every step; starting from last step's
+		// lets stacks settle within a few iterations
+		contact.normalImpulse = 0.f;
+		contact.tangentImpulse = 0.f;
+		auto warm = warmImpulses.find(pairKey(contact.a, contact.b));
+		if (warm != warmImpulses.end() && contact.bounce == 0.f) {
+			contact.normalImpulse = warm->second.x;
+			contact.tangentImpulse = warm->second.y;
+			const Vec2 tangent(-contact.normal.y, contact.normal.x);
+			const Vec2 impulse = contact.normal * contact.normalImpulse + tangent * contact.tangentImpulse;
+			a.velocity -= impulse * contact.inverseMassA;
+			b.velocity += impulse * contact.inverseMassB;
+		}
+	}
+
+	// Sequential impulses: the totals per contact are clamped rather than each correction,
+	// so a stack passes its weight down over the iterations instead of jittering
+	for (int iteration = 0; iteration < velocityIterations; ++iteration) {
+		for (Contact& contact : contacts) {
+			Body& a = bodies[contact.a];
+			Body& b = bodies[contact.b];
+			const float inverseMassSum = contact.inverseMassA + contact.inverseMassB;
+			if (inverseMassSum == 0.f) {
+				continue;
+			}
+
+			const float normalSpeed = (b.velocity - a.velocity).dot(contact.normal);
+			const float total = std::max(contact.normalImpulse + (contact.bounce - normalSpeed) / inverseMassSum, 0.f);
+			const float impulse = total - contact.normalImpulse;
+			contact.normalImpulse = total;
+			a.velocity -= contact.normal * (impulse * contact.inverseMassA);
+			b.velocity += contact.normal * (impulse * contact.inverseMassB);
+
+			// Friction along the contact, limited by the normal impulse
+			const Vec2 tangent(-contact.normal.y, contact.normal.x);
+			const float tangentSpeed = (b.velocity - a.velocity).dot(tangent);
+			const float limit = contact.normalImpulse * (a.friction + b.friction) * 0.5f;
+			const float tangentTotal = std::max(-limit, std::min(contact.tangentImpulse - tangentSpeed / inverseMassSum, limit));
+			const float tangentImpulse = tangentTotal - contact.tangentImpulse;
+			contact.tangentImpulse = tangentTotal;
+			a.velocity -= tangent * (tangentImpulse * contact.inverseMassA);
+			b.velocity += tangent * (tangentImpulse * contact.inverseMassB);
+		}
+	}
+
+	warmImpulses.clear();
+	for (const Contact& contact : contacts) {
+		warmImpulses[pairKey(contact.a, contact.b)] = Vec2(contact.normalImpulse, contact.tangentImpulse);
+	}
+}
+
+void PhysicsWorld::wakeTouched() {
+	// Only a real impact wakes a sleeping body; a resting neighbour pressing on it does not
+	for (const Contact& contact : contacts) {
+		if (!bodies[contact.b].awake && contact.approachSpeed > bounceSpeed) {
+			wake(contact.b);
+		}
+	}
+}
+
+void PhysicsWorld::integratePositions() {
+	for (BodyId id : active) {
+		Body& body = bodies[id];
+		Vec2 motion = body.velocity * fixedStep;
+		// Bodies moving more than half their size per step could skip over thin obstacles
+		const float smallest = std::min(body.halfExtents.x, body.halfExtents.y);
+		if (body.type == DynamicBody && (body.bullet || motion.lengthSquared() > smallest * smallest)) {
+			Vec2 normal;
+			const float hit = sweep(body, motion, id, normal);
+			if (hit < 1.f) {
+				motion = motion * hit;
+				// Stop at the surface and bounce off it like a contact would
+				const float normalSpeed = body.velocity.dot(normal);
+				if (normalSpeed < 0.f) {
+					body.velocity -= normal * ((1.f + body.restitution) * normalSpeed);
+				}
+			}
+		}
+		body.position += motion;
+		broadphase.update(id, computeBounds(body));
+	}
+}
+
+float PhysicsWorld::sweep(const Body& body, const Vec2& motion, BodyId self, Vec2& hitNormal) {
+	// Everything the body could touch on the way
+	const AABB start = computeBounds(body);
+	const AABB end(start.min + motion, start.max + motion);
+	candidates.clear();
+	broadphase.query(start.merged(end), candidates);
+
+	float earliest = 1.f;
+	for (std::uint32_t id : candidates) {
+		const Body& other = bodies[id];
+		if (id == self || other.type != StaticBody || !canCollide(body, other)) {
+			continue;
+		}
+		// Shrink the moving body to a point and grow the obstacle by its size instead
+		Vec2 normal;
+		float hit;
+		if (body.shape == BodyCircle && other.shape == BodyCircle) {
+			hit = rayCircle(body.position, motion, other.position, body.radius + other.radius, normal);
+		}
+		else {
+			const Vec2 grow = body.halfExtents + other.halfExtents;
+			hit = rayBox(body.position, motion, AABB(other.position - grow, other.position + grow), normal);
+		}
+		if (hit < earliest) {
+			earliest = hit;
+			hitNormal = normal;
+		}
+	}
+	// Stop just short of the surface so the next step starts outside it
+	if (earliest < 1.f) {
+		const float distance = length(motion);
+		earliest = std::max(0.f, earliest - 0.01f / std::max(distance, 1e-6f));
+	}
+	return earliest;
+}
+
+void PhysicsWorld::correctPositions() {
+	for (const Contact& contact : contacts) {
+		Body& a = bodies[contact.a];
+		Body& b = bodies[contact.b];
+		const float inverseMassSum = contact.inverseMassA + contact.inverseMassB;
+		const float depth = contact.penetration - penetrationSlop;
+		if (depth <= 0.f || inverseMassSum == 0.f) {
+			continue;
+		}
+		const Vec2 correction = contact.normal * (depth * correctionPercent / inverseMassSum);
+		if (contact.inverseMassA > 0.f) {
+			a.position -= correction * contact.inverseMassA;
+			broadphase.update(contact.a, computeBounds(a));
+		}
+		if (contact.inverseMassB > 0.f) {
+			b.position += correction * contact.inverseMassB;
+			broadphase.update(contact.b, computeBounds(b));
+		}
+	}
+}
+
+void PhysicsWorld::updateSleep() {
+	for (BodyId id : active) {
+		Body& body = bodies[id];
+		if (body.type != DynamicBody) {
+			continue;
+		}
+		if (body.velocity.lengthSquared() > sleepSpeed * sleepSpeed) {
+			body.sleepTime = 0.f;
+			continue;
+		}
+		body.sleepTime += fixedStep;
+		if (body.sleepTime >= sleepDelay) {
+			body.awake = false;
+			body.velocity = Vec2();
+		}
+	}
+}
@@ -0,0 +1,160 @@
+//Physics.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Geometry.h"
+#include "ViewCuller.h"
+
+enum BodyType {
+    StaticBody,     // never moves
+    KinematicBody,  // moves by its velocity, pushes dynamic bodies and is never pushed back
+    DynamicBody     // moved by gravity, impulses and contacts
+};
+
+enum BodyShape {
+    BodyCircle,
+    BodyBox
+};
+
+struct BodyDefinition {
+    BodyType type;
+    BodyShape shape;
+    // Center of the body
+    Vec2 position;
+    Vec2 velocity;
+    float radius;
+    Vec2 halfExtents;
+    float mass;
+    // Bounciness in [0, 1] and Coulomb friction; a contact uses the larger and the mean
+    float restitution;
+    float friction;
+    float gravityScale;
+    // Fraction of the velocity lost per second
+    float damping;
+    // Always sweep the motion against static bodies, however slow the body is
+    bool bullet;
+    // Two bodies only collide if each one's category is in the other's collidesWith bits
+    std::uint32_t category;
+    std::uint32_t collidesWith;
+
+    BodyDefinition()
+        : type(DynamicBody), shape(BodyBox), radius(0.f), halfExtents(0.5f, 0.5f), mass(1.f),
+        restitution(0.f), friction(0.3f), gravityScale(1.f), damping(0.f), bullet(false),
+        category(1), collidesWith(0xFFFFFFFFu) {}
+};
+
+// 2D rigid body physics for axis-aligned boxes and circles (no rotation).
+// Bodies are advanced in fixed steps with semi-implicit Euler, contacts are resolved with
+// impulses plus a positional correction, and fast bodies sweep their motion against static
+// bodies so they cannot tunnel through thin ones. Bodies that rest for a while fall asleep
+// and cost nothing until something touches them. Contact candidates come from a SpatialGrid.
+class PhysicsWorld {
+public:
+    typedef std::uint32_t BodyId;
+    static const BodyId invalidBody = 0xFFFFFFFFu;
+
+private:
+    struct Body {
+        BodyType type;
+        BodyShape shape;
+        Vec2 position;
+        Vec2 previousPosition;
+        Vec2 velocity;
+        Vec2 force;
+        Vec2 halfExtents;
+        float radius;
+        float inverseMass;
+        float restitution;
+        float friction;
+        float gravityScale;
+        float damping;
+        float sleepTime;
+        std::uint32_t category;
+        std::uint32_t collidesWith;
+        bool bullet;
+        bool alive;
+        bool awake;
+        bool grounded;
+    };
+
+    struct Contact {
+        BodyId a;
+        BodyId b;
+        // Points from a to b
+        Vec2 normal;
+        float penetration;
+        // Sleeping bodies take part with infinite mass, so leaning on them does not wake them
+        float inverseMassA;
+        float inverseMassB;
+        float approachSpeed;
+        // Separating speed the solver aims for, and the impulses applied so far this step
+        float bounce;
+        float normalImpulse;
+        float tangentImpulse;
+    };
+
+    std::vector<Body> bodies;
+    std::vector<BodyId> freeBodies;
+    std::vector<BodyId> active;
+    std::vector<Contact> contacts;
+    // Impulses each touching pair ended the last step with, to start the solver from
+    std::unordered_map<std::uint64_t, Vec2> warmImpulses;
+    std::vector<std::uint32_t> candidates;
+    SpatialGrid broadphase;
+
+    Vec2 gravity;
+    float fixedStep;
+    float accumulator;
+    int maxStepsPerUpdate;
+    int velocityIterations;
+    std::size_t bodyCount;
+
+public:
+    explicit PhysicsWorld(float _fixedStep = 1.f / 120.f, float cellSize = 128.f);
+
+    void setGravity(const Vec2& _gravity);
+    const Vec2& getGravity() const;
+
+    BodyId createBody(const BodyDefinition& definition);
+    void destroyBody(BodyId body);
+    bool isValid(BodyId body) const;
+
+    const Vec2& getPosition(BodyId body) const;
+    // Position blended between the last two steps by the leftover time, for smooth drawing
+    Vec2 getInterpolatedPosition(BodyId body) const;
+    void setPosition(BodyId body, const Vec2& position);
+    const Vec2& getVelocity(BodyId body) const;
+    void setVelocity(BodyId body, const Vec2& velocity);
+    void applyImpulse(BodyId body, const Vec2& impulse);
+    void applyForce(BodyId body, const Vec2& force);
+    void wake(BodyId body);
+    bool isAwake(BodyId body) const;
+    // Whether the body rested on something below it during the last step
+    bool isGrounded(BodyId body) const;
+
+    // Run as many fixed steps as 'seconds' covers; returns the number of steps taken.
+    // Time beyond a few steps is dropped, so a long hitch does not snowball.
+    int update(float seconds);
+    void step();
+
+    float getFixedStep() const;
+    std::size_t getBodyCount() const;
+    std::size_t getAwakeCount() const;
+    std::size_t getContactCount() const;
+
+private:
+    static std::uint64_t pairKey(BodyId a, BodyId b);
+    static bool canCollide(const Body& a, const Body& b);
+    AABB computeBounds(const Body& body) const;
+    void findContacts();
+    bool collide(BodyId a, BodyId b, Contact& contact) const;
+    void solveVelocities();
+    void wakeTouched();
+    void integratePositions();
+    float sweep(const Body& body, const Vec2& motion, BodyId self, Vec2& hitNormal);
+    void correctPositions();
+    void updateSleep();
+};
@@ -0,0 +1,100 @@
+//PixelFormat.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+
+// Pixel formats for CPU render targets. Each is a policy of static inline functions that
+// BasicFramebuffer is instantiated with, so the packing and blending of a format compile
+// straight into the rasterizers' inner loops:
+//   Pixel                  storage type of one pixel
+//   pack(color)            nearest stored value of 'color'
+//   unpack(pixel)          stored value as a colour (alpha 255 for formats without alpha)
+//   blend(dst, src, a)     packed 'src' over 'dst' with alpha 'a' in [1, 254]
+//   toRgba8(pixel)         the RGBA8 word sf::Texture::update takes, for presenting
+//   fromRgba8(word)        nearest stored value of an RGBA8 word, e.g. a sprite pixel
+
+// 32-bit RGBA8, bytes r, g, b, a in memory: the layout of Framebuffer and of SFML textures
+struct Rgba8Format {
+    typedef std::uint32_t Pixel;
+
+    // x / 255 for each of the two 16-bit lanes of 'x', rounded
+    static std::uint32_t divideLanesBy255(std::uint32_t x) {
+        return ((x + 0x00800080u + ((x >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+    }
+
+    static Pixel pack(sf::Color color) {
+        return static_cast<Pixel>(color.r) | (static_cast<Pixel>(color.g) << 8) | (static_cast<Pixel>(color.b) << 16) | (static_cast<Pixel>(color.a) << 24);
+    }
+    static sf::Color unpack(Pixel pixel) {
+        return sf::Color(pixel & 0xFF, (pixel >> 8) & 0xFF, (pixel >> 16) & 0xFF, pixel >> 24);
+    }
+    static Pixel blend(Pixel destination, Pixel source, std::uint32_t alpha) {
+        // Red/blue and green/alpha are blended as two pairs of 16-bit lanes; the source alpha
+        // lane is taken as 255 so the result's alpha is alpha + destination alpha * (1 - alpha)
+        const std::uint32_t inverse = 255 - alpha;
+        const std::uint32_t redBlue = (source & 0x00FF00FFu) * alpha + (destination & 0x00FF00FFu) * inverse;
+        const std::uint32_t greenAlpha = (((source >> 8) & 0x000000FFu) | 0x00FF0000u) * alpha + ((destination >> 8) & 0x00FF00FFu) * inverse;
+        return divideLanesBy255(redBlue) | (divideLanesBy255(greenAlpha) << 8);
+    }
+    static std::uint32_t toRgba8(Pixel pixel) { return pixel; }
+    static Pixel fromRgba8(std::uint32_t pixel) { return pixel; }
+};
+
+// 16-bit RGB565 (red in the top bits), half the memory and bandwidth of RGBA8, for kiosk builds
+struct Rgb565Format {
+    typedef std::uint16_t Pixel;
+
+    // Green moved to the top half of a 32-bit word, clear of red and blue, so all three
+    // channels are blended with one multiply per pixel
+    static std::uint32_t spread(Pixel pixel) { return (pixel | (static_cast<std::uint32_t>(pixel) << 16)) & 0x07E0F81Fu; }
+
+    static Pixel pack(sf::Color color) {
+        return fromRgba8(Rgba8Format::pack(color));
+    }
+    static sf::Color unpack(Pixel pixel) {
+        return Rgba8Format::unpack(toRgba8(pixel));
+    }
+    static Pixel blend(Pixel destination, Pixel source, std::uint32_t alpha) {
+        // Alpha is cut to 5 bits, as much as the gaps between the spread channels can take
+        const std::uint32_t weight = (alpha + 4) >> 3;
+        const std::uint32_t mixed = ((spread(source) * weight + spread(destination) * (32 - weight)) >> 5) & 0x07E0F81Fu;
+        return static_cast<Pixel>(mixed | mixed >> 16);
+    }
+    static std::uint32_t toRgba8(Pixel pixel) {
+        // Top bits of each channel repeated into its low bits, so white stays 255
+        const std::uint32_t r = pixel >> 11, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+        return (r << 3 | r >> 2) | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2) << 16 | 0xFF000000u;
+    }
+    // Nearest stored value; alpha is dropped
+    static Pixel fromRgba8(std::uint32_t pixel) {
+        const std::uint32_t r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF;
+        return static_cast<Pixel>((r * 31 + 127) / 255 << 11 | (g * 63 + 127) / 255 << 5 | (b * 31 + 127) / 255);
+    }
+};
+
+// 8-bit palette of 8 red, 8 green and 4 blue levels (RGB332). The palette is fixed, so the
+// index of a colour is computed rather than searched for.
+struct Rgb332Format {
+    typedef std::uint8_t Pixel;
+
+    static Pixel pack(sf::Color color) {
+        return fromRgba8(Rgba8Format::pack(color));
+    }
+    static sf::Color unpack(Pixel pixel) {
+        return Rgba8Format::unpack(toRgba8(pixel));
+    }
+    static Pixel blend(Pixel destination, Pixel source, std::uint32_t alpha) {
+        // Mixed at full precision and quantized once
+        return fromRgba8(Rgba8Format::blend(toRgba8(destination), toRgba8(source), alpha));
+    }
+    static std::uint32_t toRgba8(Pixel pixel) {
+        // Levels of 255 / 7 and 255 / 3
+        return ((pixel >> 5) * 73 >> 1) | (((pixel >> 2) & 7) * 73 >> 1) << 8 | (pixel & 3) * 85 << 16 | 0xFF000000u;
+    }
+    // Nearest palette entry; alpha is dropped
+    static Pixel fromRgba8(std::uint32_t pixel) {
+        const std::uint32_t r = pixel & 0xFF, g = (pixel >> 8) & 0xFF, b = (pixel >> 16) & 0xFF;
+        return static_cast<Pixel>((r * 7 + 127) / 255 << 5 | (g * 7 + 127) / 255 << 2 | (b * 3 + 127) / 255);
+    }
+};
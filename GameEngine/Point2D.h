@@ -2,6 +2,7 @@
 #pragma once
 
 #include <SFML/Graphics.hpp> 
+#include "Geometry.h"
 
 class PrimitiveRenderer;
 
@@ -17,5 +18,6 @@ public:
     float getY() const;
     void setX(float _x);
     void setY(float _y);
+    Vec2 toVec2() const { return Vec2(x, y); }
     void draw(PrimitiveRenderer& renderer, sf::Color color);
 };
\ No newline at end of file
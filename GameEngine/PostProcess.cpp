@@ -0,0 +1,372 @@
+//PostProcess.cpp
+#include "PostProcess.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POST_PROCESS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	typedef Framebuffer::Pixel Pixel;
+
+	const std::uint32_t laneMask = 0x00FF00FFu;
+
+	// (a * (256 - t) + b * t) / 256 for every channel, t in [0, 256]
+	Pixel lerpPixel(Pixel a, Pixel b, std::uint32_t t) {
+		const std::uint32_t s = 256 - t;
+		const std::uint32_t redBlue = (((a & laneMask) * s + (b & laneMask) * t) >> 8) & laneMask;
+		const std::uint32_t greenAlpha = (((a >> 8) & laneMask) * s + ((b >> 8) & laneMask) * t) & ~laneMask;
+		return redBlue | greenAlpha;
+	}
+
+	// Channels of a tap sum are scaled up by 7 bits before the 0.16 weight is applied, so the
+	// weighted sum keeps 7 fractional bits and still fits 16 bits
+	const int fractionBits = 7;
+
+	// out[x] = sum over k of weights[k] * (taps[2k - 1][x] + taps[2k][x]), with taps[0] the center
+	void convolve(const Pixel* const* taps, const std::uint16_t* weights, int radius, Pixel* out, int count) {
+		int x = 0;
+#ifdef POST_PROCESS_SSE2
+		// Four pixels (sixteen 8-bit channels, widened to two registers of 16-bit lanes) at a time
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(1 << (fractionBits - 1));
+		for (; x + 4 <= count; x += 4) {
+			const __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(taps[0] + x));
+			const __m128i weight = _mm_set1_epi16(static_cast<short>(weights[0]));
+			__m128i low = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpacklo_epi8(center, zero), fractionBits), weight);
+			__m128i high = _mm_mulhi_epu16(_mm_slli_epi16(_mm_unpackhi_epi8(center, zero), fractionBits), weight);
+			for (int k = 1; k <= radius; ++k) {
+				const __m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i*>(taps[2 * k - 1] + x));
+				const __m128i after = _mm_loadu_si128(reinterpret_cast<const __m128i*>(taps[2 * k] + x));
+				const __m128i tapWeight = _mm_set1_epi16(static_cast<short>(weights[k]));
+				// The kernel is symmetric, so both taps are added before the one multiply
+				const __m128i sumLow = _mm_add_epi16(_mm_unpacklo_epi8(before, zero), _mm_unpacklo_epi8(after, zero));
+				const __m128i sumHigh = _mm_add_epi16(_mm_unpackhi_epi8(before, zero), _mm_unpackhi_epi8(after, zero));
+				low = _mm_add_epi16(low, _mm_mulhi_epu16(_mm_slli_epi16(sumLow, fractionBits), tapWeight));
+				high = _mm_add_epi16(high, _mm_mulhi_epu16(_mm_slli_epi16(sumHigh, fractionBits), tapWeight));
+			}
+			low = _mm_srli_epi16(_mm_add_epi16(low, rounding), fractionBits);
+			high = _mm_srli_epi16(_mm_add_epi16(high, rounding), fractionBits);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(low, high));
+		}
+#endif
+		// The same arithmetic one channel at a time, for the last pixels and other CPUs
+		for (; x < count; ++x) {
+			Pixel result = 0;
+			for (int shift = 0; shift < 32; shift += 8) {
+				std::uint32_t sum = (((taps[0][x] >> shift) & 0xFF) << fractionBits) * weights[0] >> 16;
+				for (int k = 1; k <= radius; ++k) {
+					const std::uint32_t pair = ((taps[2 * k - 1][x] >> shift) & 0xFF) + ((taps[2 * k][x] >> shift) & 0xFF);
+					sum += (pair << fractionBits) * weights[k] >> 16;
+				}
+				sum = (sum + (1 << (fractionBits - 1))) >> fractionBits;
+				result |= std::min<std::uint32_t>(sum, 255) << shift;
+			}
+			out[x] = result;
+		}
+	}
+}
+
+ColorLut::ColorLut(unsigned _size) : size(0) {
+	create(_size, [](sf::Color color) { return color; });
+}
+
+void ColorLut::create(unsigned _size, const Grade& grade) {
+	size = std::max(2u, std::min(_size, 64u));
+	table.resize(static_cast<std::size_t>(size) * size * size);
+	for (unsigned b = 0; b < size; ++b) {
+		for (unsigned g = 0; g < size; ++g) {
+			for (unsigned r = 0; r < size; ++r) {
+				const sf::Color color = grade(sf::Color(
+					static_cast<sf::Uint8>(r * 255 / (size - 1)), static_cast<sf::Uint8>(g * 255 / (size - 1)), static_cast<sf::Uint8>(b * 255 / (size - 1))));
+				table[(static_cast<std::size_t>(b) * size + g) * size + r] = Framebuffer::toPixel(sf::Color(color.r, color.g, color.b, 255));
+			}
+		}
+	}
+}
+
+unsigned ColorLut::getSize() const {
+	return size;
+}
+
+Pixel ColorLut::apply(Pixel pixel) const {
+	// Position of each channel between the samples, in 8.8 fixed point
+	const std::uint32_t scale = (size - 1) * 256;
+	const std::uint32_t r = (pixel & 0xFF) * scale / 255;
+	const std::uint32_t g = ((pixel >> 8) & 0xFF) * scale / 255;
+	const std::uint32_t b = ((pixel >> 16) & 0xFF) * scale / 255;
+	const std::uint32_t r0 = r >> 8, g0 = g >> 8, b0 = b >> 8;
+	const std::uint32_t r1 = std::min(r0 + 1, size - 1), g1 = std::min(g0 + 1, size - 1), b1 = std::min(b0 + 1, size - 1);
+	const std::uint32_t rt = r & 0xFF, gt = g & 0xFF, bt = b & 0xFF;
+
+	const Pixel* plane0 = table.data() + static_cast<std::size_t>(b0) * size * size;
+	const Pixel* plane1 = table.data() + static_cast<std::size_t>(b1) * size * size;
+	const Pixel front = lerpPixel(lerpPixel(plane0[g0 * size + r0], plane0[g0 * size + r1], rt),
+		lerpPixel(plane0[g1 * size + r0], plane0[g1 * size + r1], rt), gt);
+	const Pixel back = lerpPixel(lerpPixel(plane1[g0 * size + r0], plane1[g0 * size + r1], rt),
+		lerpPixel(plane1[g1 * size + r0], plane1[g1 * size + r1], rt), gt);
+	return (lerpPixel(front, back, bt) & 0x00FFFFFFu) | (pixel & 0xFF000000u);
+}
+
+PostProcessChain::PostProcessChain()
+	: compiled(false), fusion(true), rowGrainSize(16), width(0), height(0), frame(nullptr) {
+}
+
+void PostProcessChain::addBlur(float radius) {
+	Effect effect = { BlurEffect, radius, 0.f, 0, 0 };
+	effects.push_back(effect);
+	compiled = false;
+}
+
+void PostProcessChain::addBloom(std::uint8_t threshold, float radius, float intensity) {
+	Effect effect = { BloomEffect, radius, intensity, threshold, 0 };
+	effects.push_back(effect);
+	compiled = false;
+}
+
+void PostProcessChain::addColorGrade(const ColorLut& lut) {
+	Effect effect = { GradeEffect, 0.f, 0.f, 0, luts.size() };
+	luts.push_back(lut);
+	effects.push_back(effect);
+	compiled = false;
+}
+
+void PostProcessChain::addScanlines(float darkness) {
+	Effect effect = { ScanlineEffect, 0.f, darkness, 0, 0 };
+	effects.push_back(effect);
+	compiled = false;
+}
+
+void PostProcessChain::clear() {
+	effects.clear();
+	luts.clear();
+	compiled = false;
+}
+
+void PostProcessChain::apply(Framebuffer& target, JobSystem* jobs) {
+	if (effects.empty() || target.getWidth() == 0 || target.getHeight() == 0) {
+		return;
+	}
+	if (!compiled) {
+		compile();
+	}
+	frame = &target;
+	width = target.getWidth();
+	height = target.getHeight();
+	scratch.resize(static_cast<std::size_t>(width) * height);
+	const bool blooming = std::any_of(effects.begin(), effects.end(), [](const Effect& effect) { return effect.kind == BloomEffect; });
+	bloom.resize(blooming ? scratch.size() : 0);
+	bands.resize((height + rowGrainSize - 1) / rowGrainSize);
+
+	// Stages depend on each other's whole output, so each one finishes before the next starts
+	for (const Stage& stage : stages) {
+		auto runBand = [this, &stage](size_t begin, size_t end) {
+			runStage(stage, static_cast<unsigned>(begin), static_cast<unsigned>(end), bands[begin / rowGrainSize]);
+		};
+		if (jobs) {
+			jobs->parallelFor(height, rowGrainSize, runBand);
+		}
+		else {
+			runBand(0, height);
+		}
+	}
+	frame = nullptr;
+}
+
+void PostProcessChain::setFusion(bool enabled) {
+	fusion = enabled;
+	compiled = false;
+}
+
+std::size_t PostProcessChain::getEffectCount() const {
+	return effects.size();
+}
+
+std::size_t PostProcessChain::getStageCount() {
+	if (!compiled) {
+		compile();
+	}
+	return stages.size();
+}
+
+void PostProcessChain::compile() {
+	stages.clear();
+	kernels.clear();
+	for (const Effect& effect : effects) {
+		PixelOp op = { GradeOp, 0, effect.threshold, effect.lut };
+		switch (effect.kind) {
+		case BlurEffect: {
+			const std::size_t kernel = addKernel(effect.radius);
+			Stage rows = { RowPass, FrameTarget, ScratchTarget, kernel, std::vector<PixelOp>() };
+			Stage columns = { ColumnPass, ScratchTarget, FrameTarget, kernel, std::vector<PixelOp>() };
+			stages.push_back(rows);
+			stages.push_back(columns);
+			break;
+		}
+		case BloomEffect: {
+			op.kind = BrightPassOp;
+			addPixelOp(op);
+			const std::size_t kernel = addKernel(effect.radius);
+			Stage rows = { RowPass, BloomTarget, ScratchTarget, kernel, std::vector<PixelOp>() };
+			Stage columns = { ColumnPass, ScratchTarget, BloomTarget, kernel, std::vector<PixelOp>() };
+			stages.push_back(rows);
+			stages.push_back(columns);
+			op.kind = AddBloomOp;
+			op.factor = static_cast<std::uint32_t>(std::max(effect.strength, 0.f) * 256.f);
+			addPixelOp(op);
+			break;
+		}
+		case GradeEffect:
+			addPixelOp(op);
+			break;
+		case ScanlineEffect:
+			op.kind = ScanlineOp;
+			op.factor = static_cast<std::uint32_t>((1.f - std::max(0.f, std::min(effect.strength, 1.f))) * 256.f);
+			addPixelOp(op);
+			break;
+		}
+	}
+	compiled = true;
+}
+
+void PostProcessChain::addPixelOp(const PixelOp& op) {
+	// Every stage writes each row once and reads no other row of what the ops touch, so the
+	// ops can run on a row as soon as the stage before them has finished it
+	if (fusion && !stages.empty()) {
+		stages.back().ops.push_back(op);
+		return;
+	}
+	Stage stage = { PixelPass, FrameTarget, FrameTarget, 0, std::vector<PixelOp>(1, op) };
+	stages.push_back(stage);
+}
+
+std::size_t PostProcessChain::addKernel(float radius) {
+	const int taps = std::max(static_cast<int>(std::ceil(radius)), 1);
+	const float sigma = std::max(radius * 0.5f, 0.5f);
+	std::vector<float> weights(taps + 1);
+	float total = 0.f;
+	for (int k = 0; k <= taps; ++k) {
+		weights[k] = std::exp(-static_cast<float>(k * k) / (2.f * sigma * sigma));
+		total += k == 0 ? weights[k] : 2.f * weights[k];
+	}
+	std::vector<std::uint16_t> kernel(taps + 1);
+	for (int k = 0; k <= taps; ++k) {
+		kernel[k] = static_cast<std::uint16_t>(std::min(weights[k] / total * 65536.f + 0.5f, 65535.f));
+	}
+	kernels.push_back(kernel);
+	return kernels.size() - 1;
+}
+
+void PostProcessChain::runStage(const Stage& stage, unsigned firstRow, unsigned lastRow, BandScratch& band) {
+	for (unsigned y = firstRow; y < lastRow; ++y) {
+		if (stage.kind == RowPass) {
+			runRowPass(stage, y, band);
+		}
+		else if (stage.kind == ColumnPass) {
+			runColumnPass(stage, y, band);
+		}
+		runPixelOps(stage.ops, y);
+	}
+}
+
+void PostProcessChain::runRowPass(const Stage& stage, unsigned y, BandScratch& band) {
+	const std::vector<std::uint16_t>& kernel = kernels[stage.kernel];
+	const int radius = static_cast<int>(kernel.size()) - 1;
+	const Pixel* source = getRow(stage.source, y);
+
+	// Pad the row with its edge pixels so every tap can be read without a bounds check
+	band.line.resize(width + 2 * radius);
+	for (int i = 0; i < static_cast<int>(band.line.size()); ++i) {
+		band.line[i] = source[std::max(0, std::min(i - radius, static_cast<int>(width) - 1))];
+	}
+	const Pixel* center = band.line.data() + radius;
+	band.taps.resize(2 * radius + 1);
+	band.taps[0] = center;
+	for (int k = 1; k <= radius; ++k) {
+		band.taps[2 * k - 1] = center - k;
+		band.taps[2 * k] = center + k;
+	}
+	convolve(band.taps.data(), kernel.data(), radius, getRow(stage.target, y), static_cast<int>(width));
+}
+
+void PostProcessChain::runColumnPass(const Stage& stage, unsigned y, BandScratch& band) {
+	const std::vector<std::uint16_t>& kernel = kernels[stage.kernel];
+	const int radius = static_cast<int>(kernel.size()) - 1;
+	const int lastRow = static_cast<int>(height) - 1;
+
+	// The taps of a column are the rows above and below, clamped at the edges
+	band.taps.resize(2 * radius + 1);
+	band.taps[0] = getRow(stage.source, y);
+	for (int k = 1; k <= radius; ++k) {
+		band.taps[2 * k - 1] = getRow(stage.source, static_cast<unsigned>(std::max(static_cast<int>(y) - k, 0)));
+		band.taps[2 * k] = getRow(stage.source, static_cast<unsigned>(std::min(static_cast<int>(y) + k, lastRow)));
+	}
+	convolve(band.taps.data(), kernel.data(), radius, getRow(stage.target, y), static_cast<int>(width));
+}
+
+void PostProcessChain::runPixelOps(const std::vector<PixelOp>& ops, unsigned y) {
+	Pixel* row = getRow(FrameTarget, y);
+	for (const PixelOp& op : ops) {
+		switch (op.kind) {
+		case GradeOp: {
+			const ColorLut& lut = luts[op.lut];
+			for (unsigned x = 0; x < width; ++x) {
+				row[x] = lut.apply(row[x]);
+			}
+			break;
+		}
+		case ScanlineOp:
+			if (y % 2 == 1) {
+				for (unsigned x = 0; x < width; ++x) {
+					const Pixel pixel = row[x];
+					const std::uint32_t redBlue = (((pixel & laneMask) * op.factor) >> 8) & laneMask;
+					const std::uint32_t green = ((((pixel >> 8) & 0xFF) * op.factor) >> 8) << 8;
+					row[x] = redBlue | green | (pixel & 0xFF000000u);
+				}
+			}
+			break;
+		case BrightPassOp: {
+			// What is above the threshold, stretched back to the full range
+			Pixel* bright = getRow(BloomTarget, y);
+			const std::uint32_t threshold = op.threshold;
+			const std::uint32_t stretch = 255 * 256 / std::max(255u - threshold, 1u);
+			for (unsigned x = 0; x < width; ++x) {
+				Pixel result = 0xFF000000u;
+				for (int shift = 0; shift < 24; shift += 8) {
+					const std::uint32_t channel = (row[x] >> shift) & 0xFF;
+					const std::uint32_t excess = channel > threshold ? channel - threshold : 0;
+					result |= std::min<std::uint32_t>((excess * stretch) >> 8, 255) << shift;
+				}
+				bright[x] = result;
+			}
+			break;
+		}
+		case AddBloomOp: {
+			const Pixel* glow = getRow(BloomTarget, y);
+			for (unsigned x = 0; x < width; ++x) {
+				Pixel result = row[x] & 0xFF000000u;
+				for (int shift = 0; shift < 24; shift += 8) {
+					const std::uint32_t sum = ((row[x] >> shift) & 0xFF) + ((((glow[x] >> shift) & 0xFF) * op.factor) >> 8);
+					result |= std::min<std::uint32_t>(sum, 255) << shift;
+				}
+				row[x] = result;
+			}
+			break;
+		}
+		}
+	}
+}
+
+Pixel* PostProcessChain::getRow(BufferId buffer, unsigned y) {
+	switch (buffer) {
+	case ScratchTarget:
+		return scratch.data() + static_cast<std::size_t>(y) * width;
+	case BloomTarget:
+		return bloom.data() + static_cast<std::size_t>(y) * width;
+	default:
+		return frame->getRow(y);
+	}
+}
@@ -0,0 +1,149 @@
+//PostProcess.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Framebuffer.h"
+
+class JobSystem;
+
+// 3D colour lookup table: 'size' samples per channel, looked up with trilinear filtering,
+// so any colour grade baked into it costs the same per pixel
+class ColorLut {
+public:
+    typedef std::function<sf::Color(sf::Color)> Grade;
+
+private:
+    unsigned size;
+    std::vector<Framebuffer::Pixel> table;
+
+public:
+    // The identity table, leaving colours unchanged
+    explicit ColorLut(unsigned _size = 17);
+
+    // Bake 'grade' by evaluating it at every sample
+    void create(unsigned _size, const Grade& grade);
+    unsigned getSize() const;
+
+    // Graded colour of 'pixel'; alpha is kept
+    Framebuffer::Pixel apply(Framebuffer::Pixel pixel) const;
+};
+
+// Full-frame effects applied to a finished Framebuffer, in the order they are added.
+// Effects are broken into stages that each make one pass over the frame, split into bands of
+// rows run on the job system: blurs into a row pass and a column pass of a separable Gaussian
+// kernel (four channels per SSE operation), and per-pixel effects such as grading into row
+// loops. A per-pixel stage is fused into the stage before it and applied to each row right
+// after that stage wrote it, so a chain of them costs one trip through memory in total.
+class PostProcessChain {
+private:
+    enum EffectKind {
+        BlurEffect,
+        BloomEffect,
+        GradeEffect,
+        ScanlineEffect
+    };
+
+    struct Effect {
+        EffectKind kind;
+        float radius;
+        float strength;
+        std::uint8_t threshold;
+        std::size_t lut;
+    };
+
+    enum BufferId {
+        FrameTarget,
+        ScratchTarget,
+        BloomTarget
+    };
+
+    enum PixelOpKind {
+        GradeOp,
+        ScanlineOp,
+        // Bloom: copy what is above the threshold to the bloom buffer, and add it back once blurred
+        BrightPassOp,
+        AddBloomOp
+    };
+
+    // Per-pixel work on row y of the frame (and of the bloom buffer)
+    struct PixelOp {
+        PixelOpKind kind;
+        // Scanline brightness or bloom intensity in 8.8 fixed point
+        std::uint32_t factor;
+        std::uint8_t threshold;
+        std::size_t lut;
+    };
+
+    enum StageKind {
+        RowPass,
+        ColumnPass,
+        PixelPass
+    };
+
+    struct Stage {
+        StageKind kind;
+        BufferId source;
+        BufferId target;
+        std::size_t kernel;
+        // Run on each row once the stage has written it
+        std::vector<PixelOp> ops;
+    };
+
+    std::vector<Effect> effects;
+    std::vector<ColorLut> luts;
+    // Half kernels in 0.16 fixed point: weight of the center tap, then of the taps 1, 2, ... pixels away
+    std::vector<std::vector<std::uint16_t>> kernels;
+    std::vector<Stage> stages;
+    bool compiled;
+    bool fusion;
+    std::size_t rowGrainSize;
+
+    unsigned width;
+    unsigned height;
+    Framebuffer* frame;
+    std::vector<Framebuffer::Pixel> scratch;
+    std::vector<Framebuffer::Pixel> bloom;
+
+    // Per band of rows: a row padded with copies of its edge pixels, and the tap rows of a pixel
+    struct BandScratch {
+        std::vector<Framebuffer::Pixel> line;
+        std::vector<const Framebuffer::Pixel*> taps;
+    };
+    // One per band, kept across stages and frames so a steady chain allocates nothing. Bands
+    // are rowGrainSize rows each, and no two threads ever run the same band at once.
+    std::vector<BandScratch> bands;
+
+public:
+    PostProcessChain();
+
+    // Gaussian blur reaching 'radius' pixels each way (standard deviation radius / 2)
+    void addBlur(float radius);
+    // Adds the blurred parts of the frame brighter than 'threshold' back onto it
+    void addBloom(std::uint8_t threshold, float radius, float intensity);
+    void addColorGrade(const ColorLut& lut);
+    // Darkens every other row by 'darkness' in [0, 1]
+    void addScanlines(float darkness);
+    void clear();
+
+    // Run every effect on 'target'; without a job system everything runs on the calling thread
+    void apply(Framebuffer& target, JobSystem* jobs = nullptr);
+
+    // Fusing per-pixel stages is on by default; turning it off is for measuring it
+    void setFusion(bool enabled);
+    std::size_t getEffectCount() const;
+    // Passes over the frame apply() makes, after fusion
+    std::size_t getStageCount();
+
+private:
+    void compile();
+    void addPixelOp(const PixelOp& op);
+    std::size_t addKernel(float radius);
+    void runStage(const Stage& stage, unsigned firstRow, unsigned lastRow, BandScratch& band);
+    void runRowPass(const Stage& stage, unsigned y, BandScratch& band);
+    void runColumnPass(const Stage& stage, unsigned y, BandScratch& band);
+    void runPixelOps(const std::vector<PixelOp>& ops, unsigned y);
+    Framebuffer::Pixel* getRow(BufferId buffer, unsigned y);
+};
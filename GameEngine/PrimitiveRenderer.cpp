@@ -6,56 +6,197 @@
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <iostream>
-#include <stack>
+#include <algorithm>
 
 
-PrimitiveRenderer::PrimitiveRenderer(sf::RenderWindow& _window) : window(_window) {
+PrimitiveRenderer::PrimitiveRenderer(sf::RenderWindow& _window) : window(_window), hasPixelSnapshot(false), blendMode(sf::BlendAlpha) {
 	renderTexture.create(window.getSize().x, window.getSize().y);
+	circleShape.setRadius(2.f);
+	for (std::size_t i = 0; i < circleShape.getPointCount(); ++i) {
+		pointDisc.push_back(circleShape.getPoint(i));
+	}
 }
 
 void PrimitiveRenderer::drawRectangle(float x, float y, float width, float height, sf::Color color) {
-	sf::RectangleShape rectangle(sf::Vector2f(width, height));
-	rectangle.setPosition(x, y);
-	rectangle.setFillColor(color);
-	window.draw(rectangle);
+	if (!isVisible(AABB::fromPoints(Vec2(x, y), Vec2(x + width, y + height)))) {
+		return;
+	}
+	drawRectangleShape(x, y, width, height, color);
+}
+
+void PrimitiveRenderer::drawRectangleShape(float x, float y, float width, float height, sf::Color color) {
+	rectangleShape.setSize(sf::Vector2f(width, height));
+	rectangleShape.setPosition(x, y);
+	rectangleShape.setRotation(0.f);
+	rectangleShape.setFillColor(color);
+	window.draw(rectangleShape, blendMode);
 }
 
 void PrimitiveRenderer::drawCircle(float x, float y, float radius, sf::Color color) {
-	sf::CircleShape circle(radius);
-	circle.setPosition(x - radius, y - radius);
-	circle.setFillColor(color);
-	window.draw(circle);
+	if (!isVisible(AABB(Vec2(x - radius, y - radius), Vec2(x + radius, y + radius)))) {
+		return;
+	}
+	drawEllipseShape(x, y, radius, radius, color);
+}
+
+void PrimitiveRenderer::drawFilledEllipse(float centerX, float centerY, float rx, float ry, sf::Color color) {
+	if (!isVisible(AABB(Vec2(centerX - rx, centerY - ry), Vec2(centerX + rx, centerY + ry)))) {
+		return;
+	}
+	drawEllipseShape(centerX, centerY, rx, ry, color);
+}
+
+// Small ellipses get few points and large ones stay smooth; the unit circles come from the cache
+void PrimitiveRenderer::drawEllipseShape(float centerX, float centerY, float rx, float ry, sf::Color color) {
+	const std::vector<Vec2>& circle = tessellationCache.getCircle(std::max(rx, ry));
+	convexShape.setPointCount(circle.size());
+	for (size_t i = 0; i < circle.size(); ++i) {
+		convexShape.setPoint(i, sf::Vector2f(centerX + circle[i].x * rx, centerY + circle[i].y * ry));
+	}
+	convexShape.setFillColor(color);
+	window.draw(convexShape, blendMode);
+}
+
+void PrimitiveRenderer::drawPath(const Path& path, const Affine2D& transform, sf::Color color, float thickness) {
+	const FlattenedPath& flattened = transformPath(path, transform);
+	for (const FlattenedPath::Contour& contour : flattened.contours) {
+		const Vec2* points = pathPoints.data() + contour.first;
+		for (size_t i = 0; i + 1 < contour.count; ++i) {
+			drawLine(points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, thickness, color);
+		}
+		if (contour.closed && contour.count > 2) {
+			const Vec2& last = points[contour.count - 1];
+			drawLine(last.x, last.y, points[0].x, points[0].y, thickness, color);
+		}
+	}
+}
+
+void PrimitiveRenderer::fillPath(const Path& path, const Affine2D& transform, sf::Color fillColor) {
+	const FlattenedPath& flattened = transformPath(path, transform);
+	for (const FlattenedPath::Contour& contour : flattened.contours) {
+		if (contour.closed) {
+			drawFilledPolygon(pathPoints.data() + contour.first, contour.count, fillColor);
+		}
+	}
+}
+
+const FlattenedPath& PrimitiveRenderer::transformPath(const Path& path, const Affine2D& transform) {
+	// The larger axis scale decides how finely the curves must be flattened
+	const float scaleSquared = std::max(transform.a * transform.a + transform.b * transform.b, transform.c * transform.c + transform.d * transform.d);
+	const FlattenedPath& flattened = tessellationCache.getPath(path, std::sqrt(scaleSquared));
+	pathPoints.resize(flattened.points.size());
+	for (size_t i = 0; i < flattened.points.size(); ++i) {
+		pathPoints[i] = transform.transformPoint(flattened.points[i]);
+	}
+	return flattened;
 }
 
 void PrimitiveRenderer::drawLine(float x1, float y1, float x2, float y2, float thickness, sf::Color color) {
-	sf::RectangleShape line(sf::Vector2f(getDistance(x1, y1, x2, y2), thickness));
-	line.setPosition(x1, y1);
-	line.setFillColor(color);
-	line.setRotation(getAngle(x1, y1, x2, y2));
-	window.draw(line);
+	// Only the visible part of the line is turned into a quad; the margin keeps its width intact at the edges
+	Vec2 start(x1, y1), end(x2, y2);
+	if (!clipLine(getClipBounds(thickness), start, end)) {
+		return;
+	}
+	x1 = start.x;
+	y1 = start.y;
+	x2 = end.x;
+	y2 = end.y;
+
+	rectangleShape.setSize(sf::Vector2f(getDistance(x1, y1, x2, y2), thickness));
+	rectangleShape.setPosition(x1, y1);
+	rectangleShape.setFillColor(color);
+	rectangleShape.setRotation(getAngle(x1, y1, x2, y2));
+	window.draw(rectangleShape, blendMode);
 }
 
 void PrimitiveRenderer::drawPoint(float x, float y, sf::Color color) {
-	sf::CircleShape point(2.f);
-	point.setPosition(x, y);
-	point.setFillColor(color);
-	window.draw(point);
+	if (!isVisible(AABB(Vec2(x, y), Vec2(x + 4.f, y + 4.f)))) {
+		return;
+	}
+	circleShape.setPosition(x, y);
+	circleShape.setFillColor(color);
+	window.draw(circleShape, blendMode);
+}
+
+void PrimitiveRenderer::beginBatch() {
+	batchVertices.clear();
+	batchClip = getClipBounds();
+}
+
+void PrimitiveRenderer::batchPoint(float x, float y, sf::Color color) {
+	// The same disc as drawPoint(): circleShape's outline with its bounding box's corner at (x, y)
+	if (!batchClip.overlaps(AABB(Vec2(x, y), Vec2(x + 4.f, y + 4.f)))) {
+		return;
+	}
+	const sf::Vector2f corner(x, y);
+	const sf::Vector2f center(x + 2.f, y + 2.f);
+	for (size_t i = 0; i < pointDisc.size(); ++i) {
+		batchVertices.push_back(sf::Vertex(center, color));
+		batchVertices.push_back(sf::Vertex(corner + pointDisc[i], color));
+		batchVertices.push_back(sf::Vertex(corner + pointDisc[(i + 1) % pointDisc.size()], color));
+	}
+}
+
+void PrimitiveRenderer::batchLine(float x1, float y1, float x2, float y2, float thickness, sf::Color color) {
+	// The quad drawLine() draws: the clipped line, widened by 'thickness' to its right
+	Vec2 start(x1, y1), end(x2, y2);
+	const AABB clip(batchClip.min - Vec2(thickness, thickness), batchClip.max + Vec2(thickness, thickness));
+	if (!clipLine(clip, start, end)) {
+		return;
+	}
+	const float length = getDistance(start.x, start.y, end.x, end.y);
+	if (length <= 0.f) {
+		return;
+	}
+	const Vec2 offset((start.y - end.y) / length * thickness, (end.x - start.x) / length * thickness);
+	const sf::Vertex corners[4] = {
+		sf::Vertex(start.toVector2f(), color),
+		sf::Vertex(end.toVector2f(), color),
+		sf::Vertex((end + offset).toVector2f(), color),
+		sf::Vertex((start + offset).toVector2f(), color)
+	};
+	const int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int index : triangles) {
+		batchVertices.push_back(corners[index]);
+	}
+}
+
+void PrimitiveRenderer::flushBatch() {
+	if (!batchVertices.empty()) {
+		window.draw(batchVertices.data(), batchVertices.size(), sf::Triangles, blendMode);
+		batchVertices.clear();
+	}
 }
 
 void PrimitiveRenderer::drawLineIncremental(int x1, int y1, int x2, int y2, sf::Color color) {
 	int dx = x2 - x1;
 	int dy = y2 - y1;
 
+	const AABB clip = getClipBounds();
 	int steps = std::max(std::abs(dx), std::abs(dy));
+	if (steps == 0) {
+		drawPixel(x1, y1, color, clip);
+		return;
+	}
+
+	// Step only through the part of the line inside the view (plus a pixel for rounding)
+	float t0, t1;
+	Vec2 start(static_cast<float>(x1), static_cast<float>(y1));
+	Vec2 end(static_cast<float>(x2), static_cast<float>(y2));
+	if (!clipLineParameters(AABB(clip.min - Vec2(1.f, 1.f), clip.max + Vec2(1.f, 1.f)), start, end, t0, t1)) {
+		return;
+	}
+	int firstStep = std::max(0, static_cast<int>(std::ceil(t0 * steps)));
+	int lastStep = std::min(steps, static_cast<int>(std::floor(t1 * steps)));
 
 	float xIncrement = static_cast<float>(dx) / static_cast<float>(steps);
 	float yIncrement = static_cast<float>(dy) / static_cast<float>(steps);
 
-	float x = static_cast<float>(x1);
-	float y = static_cast<float>(y1);
+	float x = static_cast<float>(x1) + xIncrement * firstStep;
+	float y = static_cast<float>(y1) + yIncrement * firstStep;
 
-	for (int i = 0; i <= steps; ++i) {
-		drawPixel(static_cast<int>(x + 0.5f), static_cast<int>(y + 0.5f), color);
+	for (int i = firstStep; i <= lastStep; ++i) {
+		drawPixel(static_cast<int>(x + 0.5f), static_cast<int>(y + 0.5f), color, clip);
 		x += xIncrement;
 		y += yIncrement;
 	}
@@ -70,11 +211,12 @@ float PrimitiveRenderer::getAngle(float x1, float y1, float x2, float y2) {
 	return std::atan2(y2 - y1, x2 - x1) * (180.f / pi);
 }
 
-void PrimitiveRenderer::drawPixel(int x, int y, sf::Color color) {
-	sf::RectangleShape pixel(sf::Vector2f(1.f, 1.f));
-	pixel.setPosition(static_cast<float>(x), static_cast<float>(y));
-	pixel.setFillColor(color);
-	window.draw(pixel);
+void PrimitiveRenderer::drawPixel(int x, int y, sf::Color color, const AABB& clip) {
+	const float left = static_cast<float>(x), top = static_cast<float>(y);
+	if (left > clip.max.x || left + 1.f < clip.min.x || top > clip.max.y || top + 1.f < clip.min.y) {
+		return;
+	}
+	drawRectangleShape(left, top, 1.f, 1.f, color);
 }
 
 void PrimitiveRenderer::drawPolyline(const std::vector<Point2D>& points, sf::Color color, bool isClosed) {
@@ -97,6 +239,19 @@ void PrimitiveRenderer::drawPolyline(const std::vector<Point2D>& points, sf::Col
 	}
 }
 
+void PrimitiveRenderer::drawPolyline(const Vec2* points, size_t count, sf::Color color, bool isClosed) {
+	if (count < 2) {
+		return;
+	}
+
+	for (size_t i = 0; i + 1 < count; ++i) {
+		drawLine(points[i].x, points[i].y, points[i + 1].x, points[i + 1].y, 2.f, color);
+	}
+	if (isClosed && count > 2) {
+		drawLine(points[count - 1].x, points[count - 1].y, points[0].x, points[0].y, 2.f, color);
+	}
+}
+
 void PrimitiveRenderer::drawPolyline(const std::vector<LineSegment>& segments, sf::Color color, bool isClosed) {
 	for (const auto& segment : segments) {
 		const Point2D& startPoint = segment.getStartPoint();
@@ -113,6 +268,11 @@ void PrimitiveRenderer::drawPolyline(const std::vector<LineSegment>& segments, s
 }
 
 void PrimitiveRenderer::drawEllipse(float centerX, float centerY, float rx, float ry, sf::Color color) {
+	const AABB clip = getClipBounds();
+	if (!clip.overlaps(AABB(Vec2(centerX - rx - 1.f, centerY - ry - 1.f), Vec2(centerX + rx + 1.f, centerY + ry + 1.f)))) {
+		return;
+	}
+
 	int cx = static_cast<int>(centerX + 0.5f); // Merkez x koordinat
 	int cy = static_cast<int>(centerY + 0.5f); // Merkez y koordinat
 
@@ -129,7 +289,7 @@ void PrimitiveRenderer::drawEllipse(float centerX, float centerY, float rx, floa
 	int p1 = rySquared - rxSquared * ryRound + 0.25 * rxSquared;
 
 	// lk set simetrik olarak izilmi noktalar
-	drawEllipsePoints(cx, cy, x, y, color);
+	drawEllipsePoints(cx, cy, x, y, color, clip);
 
 	// Blge 1
 	while (px < py) {
@@ -144,7 +304,7 @@ void PrimitiveRenderer::drawEllipse(float centerX, float centerY, float rx, floa
 			p1 += rySquared + px - py;
 		}
 		// Blge 1'deki noktalar iz
-		drawEllipsePoints(cx, cy, x, y, color);
+		drawEllipsePoints(cx, cy, x, y, color, clip);
 	}
 
 	// Blge 2
@@ -161,11 +321,16 @@ void PrimitiveRenderer::drawEllipse(float centerX, float centerY, float rx, floa
 			p1 += rxSquared - py + px;
 		}
 		// Blge 2'deki noktalar iz
-		drawEllipsePoints(cx, cy, x, y, color);
+		drawEllipsePoints(cx, cy, x, y, color, clip);
 	}
 }
 
 void PrimitiveRenderer::drawCircleSymmetrical(float centerX, float centerY, float radius, sf::Color color) {
+	const AABB clip = getClipBounds();
+	if (!clip.overlaps(AABB(Vec2(centerX - radius - 1.f, centerY - radius - 1.f), Vec2(centerX + radius + 1.f, centerY + radius + 1.f)))) {
+		return;
+	}
+
 	int cx = static_cast<int>(centerX + 0.5f); // Center x-coordinate
 	int cy = static_cast<int>(centerY + 0.5f); // Center y-coordinate
 
@@ -174,7 +339,7 @@ void PrimitiveRenderer::drawCircleSymmetrical(float centerX, float centerY, floa
 	int err = 0;
 
 	// Initial point at the top-right of the circle
-	drawCirclePointsSymmetrical(cx, cy, currentX, currentY, color);
+	drawCirclePointsSymmetrical(cx, cy, currentX, currentY, color, clip);
 
 	while (currentX >= currentY) {
 		// Move to the next point on the circle
@@ -196,26 +361,26 @@ void PrimitiveRenderer::drawCircleSymmetrical(float centerX, float centerY, floa
 		}
 
 		// Printing the generated point and its 7 other symmetrical points
-		drawCirclePointsSymmetrical(cx, cy, currentX, currentY, color);
+		drawCirclePointsSymmetrical(cx, cy, currentX, currentY, color, clip);
 	}
 }
 
-void PrimitiveRenderer::drawCirclePointsSymmetrical(int cx, int cy, int x, int y, sf::Color color) {
-	drawPixel(cx + x, cy - y, color);
-	drawPixel(cx + y, cy - x, color);
-	drawPixel(cx + x, cy + y, color);
-	drawPixel(cx + y, cy + x, color);
-	drawPixel(cx - x, cy - y, color);
-	drawPixel(cx - y, cy - x, color);
-	drawPixel(cx - x, cy + y, color);
-	drawPixel(cx - y, cy + x, color);
+void PrimitiveRenderer::drawCirclePointsSymmetrical(int cx, int cy, int x, int y, sf::Color color, const AABB& clip) {
+	drawPixel(cx + x, cy - y, color, clip);
+	drawPixel(cx + y, cy - x, color, clip);
+	drawPixel(cx + x, cy + y, color, clip);
+	drawPixel(cx + y, cy + x, color, clip);
+	drawPixel(cx - x, cy - y, color, clip);
+	drawPixel(cx - y, cy - x, color, clip);
+	drawPixel(cx - x, cy + y, color, clip);
+	drawPixel(cx - y, cy + x, color, clip);
 }
 
-void PrimitiveRenderer::drawEllipsePoints(int cx, int cy, int x, int y, sf::Color color) {
-	drawPixel(cx + x, cy + y, color);
-	drawPixel(cx - x, cy + y, color);
-	drawPixel(cx + x, cy - y, color);
-	drawPixel(cx - x, cy - y, color);
+void PrimitiveRenderer::drawEllipsePoints(int cx, int cy, int x, int y, sf::Color color, const AABB& clip) {
+	drawPixel(cx + x, cy + y, color, clip);
+	drawPixel(cx - x, cy + y, color, clip);
+	drawPixel(cx + x, cy - y, color, clip);
+	drawPixel(cx - x, cy - y, color, clip);
 }
 
 void PrimitiveRenderer::drawPolygon(const std::vector<Point2D>& points, sf::Color color) {
@@ -234,12 +399,14 @@ void PrimitiveRenderer::drawPolygon(const std::vector<Point2D>& points, sf::Colo
 
 void PrimitiveRenderer::drawPolygon(const std::vector<LineSegment>& segments, sf::Color color) {
 	// Check for intersections between line segments
-	for (size_t i = 0; i < segments.size() - 1; ++i) {
-		for (size_t j = i + 1; j < segments.size(); ++j) {
-			if (doSegmentsIntersect(segments[i], segments[j])) {
-				// If segments intersect, stop drawing
-				return;
-			}
+	polygonEdges.clear();
+	for (const LineSegment& segment : segments) {
+		polygonEdges.push_back(segment.toSegment());
+	}
+	for (size_t i = 0; i + 1 < segments.size(); ++i) {
+		if (findIntersectingSegment(polygonEdges[i], polygonEdges, i + 1, segments.size()) != segments.size()) {
+			// If segments intersect, stop drawing
+			return;
 		}
 	}
 
@@ -258,115 +425,72 @@ void PrimitiveRenderer::drawPolygon(const std::vector<LineSegment>& segments, sf
 }
 
 bool PrimitiveRenderer::isPolygonValid(const std::vector<Point2D>& points) {
+	polygonPoints.clear();
+	for (const Point2D& point : points) {
+		polygonPoints.push_back(point.toVec2());
+	}
+	return isPolygonValid(polygonPoints.data(), polygonPoints.size());
+}
+
+bool PrimitiveRenderer::isPolygonValid(const Vec2* points, size_t count) {
 	// A polygon must have at least three points
-	if (points.size() < 3) {
+	if (count < 3) {
 		return false;
 	}
 
-	// Check for self-intersection (overlapping edges)
-	for (size_t i = 0; i < points.size() - 1; ++i) {
-		LineSegment currentSegment(points[i], points[i + 1]);
-		for (size_t j = i + 2; j < points.size() - 1; ++j) {
-			LineSegment otherSegment(points[j], points[j + 1]);
-			if (doSegmentsIntersect(currentSegment, otherSegment)) {
-				return false; // Self-intersection found
-			}
+	// Check for self-intersection (overlapping edges): every edge against all
+	// non-adjacent later edges, several edges per instruction
+	const size_t edgeCount = count - 1;
+	polygonEdges.clear();
+	polygonEdges.reserve(edgeCount);
+	for (size_t i = 0; i < edgeCount; ++i) {
+		polygonEdges.push_back(Segment(points[i], points[i + 1]));
+	}
+	for (size_t i = 0; i + 2 < edgeCount; ++i) {
+		if (findIntersectingSegment(polygonEdges[i], polygonEdges, i + 2, edgeCount) != edgeCount) {
+			return false; // Self-intersection found
 		}
 	}
 
 	return true;
 }
 
-bool PrimitiveRenderer::doSegmentsIntersect(const LineSegment& segment1, const LineSegment& segment2) {
-	const Point2D& A = segment1.getStartPoint();
-	const Point2D& B = segment1.getEndPoint();
-	const Point2D& C = segment2.getStartPoint();
-	const Point2D& D = segment2.getEndPoint();
-
-	// Compute orientations of the four points
-	int orientation1 = orientation(A, B, C);
-	int orientation2 = orientation(A, B, D);
-	int orientation3 = orientation(C, D, A);
-	int orientation4 = orientation(C, D, B);
-
-	// General case: segments intersect if orientations are different
-	if (orientation1 != orientation2 && orientation3 != orientation4) {
-		return true;
+void PrimitiveRenderer::drawFilledPolygon(const std::vector<Point2D>& points, sf::Color fillColor) {
+	polygonPoints.clear();
+	for (const Point2D& point : points) {
+		polygonPoints.push_back(point.toVec2());
 	}
-
-	// Special cases:
-
-	// Segments AB and CD are collinear and overlap
-	if (orientation1 == 0 && onSegment(A, C, B)) return true;
-	if (orientation2 == 0 && onSegment(A, D, B)) return true;
-	if (orientation3 == 0 && onSegment(C, A, D)) return true;
-	if (orientation4 == 0 && onSegment(C, B, D)) return true;
-
-	return false; // No intersection
+	drawFilledPolygon(polygonPoints.data(), polygonPoints.size(), fillColor);
 }
 
-void PrimitiveRenderer::drawFilledPolygon(const std::vector<Point2D>& points, sf::Color fillColor) {
-	if (!isPolygonValid(points)) {
+void PrimitiveRenderer::drawFilledPolygon(const Vec2* points, size_t count, sf::Color fillColor) {
+	if (!isPolygonValid(points, count)) {
 		// If the polygon is not valid, do not draw it
 		return;
 	}
 
+	// Clip to the view so only the visible part is sent for drawing
+	size_t visibleCount = clipPolygon(getClipBounds(1.f), points, count, clippedPolygon, clipScratch);
+	if (visibleCount == 0) {
+		return;
+	}
+
 	// Draw the filled polygon
-	sf::ConvexShape convex;
-	convex.setPointCount(points.size());
-	for (size_t i = 0; i < points.size(); ++i) {
-		convex.setPoint(i, sf::Vector2f(points[i].getX(), points[i].getY()));
+	convexShape.setPointCount(visibleCount);
+	for (size_t i = 0; i < visibleCount; ++i) {
+		convexShape.setPoint(i, clippedPolygon[i].toVector2f());
 	}
-	convex.setFillColor(fillColor);
-	window.draw(convex);
+	convexShape.setFillColor(fillColor);
+	window.draw(convexShape, blendMode);
 }
 
 void PrimitiveRenderer::drawFilledRectangle(float x, float y, float width, float height, sf::Color fillColor) {
-	sf::RectangleShape rectangle(sf::Vector2f(width, height));
-	rectangle.setPosition(x, y);
-	rectangle.setFillColor(fillColor);
-	window.draw(rectangle);
-}
-// Helper method to calculate orientation of triplet (p, q, r)
-// 0: Collinear points, 1: Clockwise, 2: Counterclockwise
-int PrimitiveRenderer::orientation(const Point2D& p, const Point2D& q, const Point2D& r) {
-	float val = (q.getY() - p.getY()) * (r.getX() - q.getX()) -
-		(q.getX() - p.getX()) * (r.getY() - q.getY());
-
-	if (val == 0) return 0;  // Collinear
-	return (val > 0) ? 1 : 2; // Clockwise or counterclockwise
-}
-
-// Helper method to check if point q lies on the line segment 'pr'
-bool PrimitiveRenderer::onSegment(const Point2D& p, const Point2D& q, const Point2D& r) {
-	return (q.getX() <= std::max(p.getX(), r.getX()) && q.getX() >= std::min(p.getX(), r.getX()) &&
-		q.getY() <= std::max(p.getY(), r.getY()) && q.getY() >= std::min(p.getY(), r.getY()));
+	drawRectangle(x, y, width, height, fillColor);
 }
 
 void PrimitiveRenderer::consistencyFill(int x, int y, sf::Color fillColor, sf::Color targetColor) {
-	std::stack<std::pair<int, int>> stack;
-	stack.push(std::make_pair(x, y));
-
-	while (!stack.empty()) {
-		std::pair<int, int> current = stack.top();
-		stack.pop();
-
-		int currentX = current.first;
-		int currentY = current.second;
-
-		if (!isInsideWindow(currentX, currentY) || getPixelColor(currentX, currentY) != targetColor) {
-			continue;
-		}
-
-		// Fill the current pixel
-		drawPixel(currentX, currentY, fillColor);
-
-		// Push adjacent pixels to the stack
-		stack.push(std::make_pair(currentX + 1, currentY));
-		stack.push(std::make_pair(currentX - 1, currentY));
-		stack.push(std::make_pair(currentX, currentY + 1));
-		stack.push(std::make_pair(currentX, currentY - 1));
-	}
+	capturePixels();
+	fillFromSeed(x, y, fillColor, targetColor);
 }
 
 void PrimitiveRenderer::parityCheckFill(const std::vector<Point2D>& points, sf::Color fillColor) {
@@ -375,15 +499,24 @@ void PrimitiveRenderer::parityCheckFill(const std::vector<Point2D>& points, sf::
 		return;
 	}
 
+	FrameArena::Scope scratch(frameArena);
+
 	// Sort the points based on their y-coordinates
-	std::vector<Point2D> sortedPoints = points;
+	ArenaVector<Point2D> sortedPoints(points.begin(), points.end(), ArenaAllocator<Point2D>(frameArena));
 	std::sort(sortedPoints.begin(), sortedPoints.end(), [](const Point2D& a, const Point2D& b) {
 		return a.getY() < b.getY();
 		});
 
-	// Iterate through each horizontal line
-	for (int y = static_cast<int>(sortedPoints[0].getY()); y <= static_cast<int>(sortedPoints.back().getY()); ++y) {
-		std::vector<float> intersections;
+	// One intersection buffer reused by every scanline
+	ArenaVector<float> intersections((ArenaAllocator<float>(frameArena)));
+	intersections.reserve(sortedPoints.size());
+
+	// Iterate through each horizontal line, skipping the ones outside the view
+	AABB clip = getClipBounds();
+	int firstY = std::max(static_cast<int>(sortedPoints[0].getY()), static_cast<int>(std::floor(clip.min.y)));
+	int lastY = std::min(static_cast<int>(sortedPoints.back().getY()), static_cast<int>(std::ceil(clip.max.y)));
+	for (int y = firstY; y <= lastY; ++y) {
+		intersections.clear();
 
 		// Calculate intersections with each polygon edge
 		for (size_t i = 0; i < sortedPoints.size() - 1; ++i) {
@@ -406,60 +539,128 @@ void PrimitiveRenderer::parityCheckFill(const std::vector<Point2D>& points, sf::
 			int endX = static_cast<int>(intersections[i + 1]);
 
 			// Draw a horizontal line between startX and endX at y-coordinate
-			fillHorizontalSection(startX, endX, y, fillColor);
+			fillHorizontalSection(startX, endX, y, fillColor, clip);
 		}
 	}
 }
 
+AABB PrimitiveRenderer::getClipBounds(float margin) const {
+	return computeViewBounds(window.getView(), margin);
+}
+
+bool PrimitiveRenderer::isVisible(const AABB& bounds) const {
+	return getClipBounds().overlaps(bounds);
+}
+
 bool PrimitiveRenderer::isInsideWindow(int x, int y) {
 	return x >= 0 && x < renderTexture.getSize().x && y >= 0 && y < renderTexture.getSize().y;
 }
 
 sf::Color PrimitiveRenderer::getPixelColor(int x, int y) {
-	sf::Image image = renderTexture.getTexture().copyToImage();
-	return image.getPixel(x, y);
+	return pixelSnapshot.getPixel(x, y);
 }
 
-void PrimitiveRenderer::fillHorizontalSection(int startX, int endX, int y, sf::Color fillColor) {
+void PrimitiveRenderer::capturePixels() {
+	// Fills only draw to the window, so the render texture cannot change within a frame and
+	// every fill of the frame shares one readback. Assigning into the snapshot reuses its pixels.
+	if (hasPixelSnapshot) {
+		return;
+	}
+	pixelSnapshot = renderTexture.getTexture().copyToImage();
+	hasPixelSnapshot = true;
+}
+
+void PrimitiveRenderer::fillHorizontalSection(int startX, int endX, int y, sf::Color fillColor, const AABB& clip) {
+	// Clamp the span to the view instead of testing every pixel
+	startX = std::max(startX, static_cast<int>(std::floor(clip.min.x)));
+	endX = std::min(endX, static_cast<int>(std::ceil(clip.max.x)));
 	for (int x = startX; x <= endX; ++x) {
-		drawPixel(x, y, fillColor);
+		drawPixel(x, y, fillColor, clip);
 	}
 }
 
 void PrimitiveRenderer::borderFill(int x, int y, sf::Color fillColor, sf::Color borderColor) {
-	if (!isInsideWindow(x, y) || getPixelColor(x, y) == borderColor) {
+	if (!isInsideWindow(x, y)) {
+		return;
+	}
+	capturePixels();
+	if (getPixelColor(x, y) == borderColor) {
 		return;
 	}
 
-	consistencyFill(x, y, fillColor, borderColor);
+	fillFromSeed(x, y, fillColor, borderColor);
 }
 
 void PrimitiveRenderer::floodFill(int x, int y, sf::Color fillColor, sf::Color targetColor) {
-	if (!isInsideWindow(x, y) || getPixelColor(x, y) == fillColor || getPixelColor(x, y) == targetColor) {
+	if (!isInsideWindow(x, y)) {
+		return;
+	}
+	capturePixels();
+	if (getPixelColor(x, y) == fillColor || getPixelColor(x, y) == targetColor) {
 		return;
 	}
 
-	std::stack<std::pair<int, int>> stack;
-	stack.push(std::make_pair(x, y));
+	fillFromSeed(x, y, fillColor, targetColor);
+}
+
+void PrimitiveRenderer::fillFromSeed(int x, int y, sf::Color fillColor, sf::Color targetColor) {
+	FrameArena::Scope scratch(frameArena);
+
+	const int width = static_cast<int>(renderTexture.getSize().x);
+	const int height = static_cast<int>(renderTexture.getSize().y);
+	const AABB clip = getClipBounds();
+
+	// Pixels already visited; the snapshot never changes, so this is what stops the walk
+	ArenaVector<bool> visited(static_cast<size_t>(width) * height, false, ArenaAllocator<bool>(frameArena));
+	ArenaVector<std::pair<int, int>> stack((ArenaAllocator<std::pair<int, int>>(frameArena)));
+	stack.reserve(1024);
+	stack.push_back(std::make_pair(x, y));
 
 	while (!stack.empty()) {
-		std::pair<int, int> current = stack.top();
-		stack.pop();
+		std::pair<int, int> current = stack.back();
+		stack.pop_back();
 
 		int currentX = current.first;
 		int currentY = current.second;
 
-		if (!isInsideWindow(currentX, currentY) || getPixelColor(currentX, currentY) != targetColor) {
+		if (!isInsideWindow(currentX, currentY)) {
+			continue;
+		}
+		size_t index = static_cast<size_t>(currentY) * width + currentX;
+		if (visited[index] || getPixelColor(currentX, currentY) != targetColor) {
 			continue;
 		}
+		visited[index] = true;
 
 		// Fill the current pixel
-		drawPixel(currentX, currentY, fillColor);
+		drawPixel(currentX, currentY, fillColor, clip);
 
 		// Push adjacent pixels to the stack
-		stack.push(std::make_pair(currentX + 1, currentY));
-		stack.push(std::make_pair(currentX - 1, currentY));
-		stack.push(std::make_pair(currentX, currentY + 1));
-		stack.push(std::make_pair(currentX, currentY - 1));
+		stack.push_back(std::make_pair(currentX + 1, currentY));
+		stack.push_back(std::make_pair(currentX - 1, currentY));
+		stack.push_back(std::make_pair(currentX, currentY + 1));
+		stack.push_back(std::make_pair(currentX, currentY - 1));
 	}
-}
\ No newline at end of file
+}
+
+void PrimitiveRenderer::setBlendMode(const sf::BlendMode& mode) {
+	blendMode = mode;
+}
+
+const sf::BlendMode& PrimitiveRenderer::getBlendMode() const {
+	return blendMode;
+}
+
+void PrimitiveRenderer::endFrame() {
+	frameArena.reset();
+	tessellationCache.endFrame();
+	hasPixelSnapshot = false;
+}
+
+const FrameArena& PrimitiveRenderer::getFrameArena() const {
+	return frameArena;
+}
+
+TessellationCache& PrimitiveRenderer::getTessellationCache() {
+	return tessellationCache;
+}
@@ -5,6 +5,10 @@
 #include <vector>
 #include "Point2D.h"
 #include "LineSegment.h"
+#include "FrameArena.h"
+#include "Geometry.h"
+#include "Clipping.h"
+#include "Path.h"
 
 
 class LineSegment;
@@ -15,6 +19,33 @@ private:
 
     sf::RenderTexture renderTexture;
 
+    // Shapes reused by every draw call instead of being rebuilt per primitive
+    sf::RectangleShape rectangleShape;
+    sf::CircleShape circleShape;
+    // Outline of the point disc, taken once from circleShape so batched points match drawPoint()
+    std::vector<sf::Vector2f> pointDisc;
+    sf::ConvexShape convexShape;
+
+    // Scratch memory for fills and polygon checks, released by endFrame()
+    FrameArena frameArena;
+    // Copy of the render texture read by the fills, taken by the first fill of a frame
+    sf::Image pixelSnapshot;
+    bool hasPixelSnapshot;
+    // Polygon edges laid out for the batch intersection tests, reused between calls
+    SegmentArrays polygonEdges;
+    // Buffers for polygon clipping, reused between calls
+    std::vector<Vec2> polygonPoints;
+    std::vector<Vec2> clippedPolygon;
+    std::vector<Vec2> clipScratch;
+    // Blending used by every shape drawn from here on
+    sf::BlendMode blendMode;
+    // Triangles of the open batch, and the clip bounds taken when it was opened
+    std::vector<sf::Vertex> batchVertices;
+    AABB batchClip;
+    // Curve flattenings shared by paths, circles and ellipses
+    TessellationCache tessellationCache;
+    std::vector<Vec2> pathPoints;
+
 public:
     PrimitiveRenderer(sf::RenderWindow& _window);
     void drawRectangle(float x, float y, float width, float height, sf::Color color);
@@ -24,11 +55,19 @@ public:
     void drawLineIncremental(int x1, int y1, int x2, int y2, sf::Color color);
     void drawEllipse(float centerX, float centerY, float rx, float ry, sf::Color color);
     void drawCircleSymmetrical(float centerX, float centerY, float radius, sf::Color color);
+    void drawFilledEllipse(float centerX, float centerY, float rx, float ry, sf::Color color);
+    // Stroke or fill a path placed by 'transform'; curves are flattened to the cache's tolerance
+    // at the transform's scale. Fills treat every closed contour as a simple polygon.
+    void drawPath(const Path& path, const Affine2D& transform, sf::Color color, float thickness = 2.f);
+    void fillPath(const Path& path, const Affine2D& transform, sf::Color fillColor);
     void drawPolyline(const std::vector<Point2D>& points, sf::Color color, bool isClosed);
     void drawPolyline(const std::vector<LineSegment>& segments, sf::Color color, bool isClosed);
+    void drawPolyline(const Vec2* points, size_t count, sf::Color color, bool isClosed);
     void drawPolygon(const std::vector<Point2D>& points, sf::Color color);
     void drawPolygon(const std::vector<LineSegment>& segments, sf::Color color);
     void drawFilledPolygon(const std::vector<Point2D>& points, sf::Color fillColor);
+    // Raw point arrays, e.g. polygons read from a scene file, are drawn without copying them first
+    void drawFilledPolygon(const Vec2* points, size_t count, sf::Color fillColor);
     // New methods for filling an area with color
     void drawFilledRectangle(float x, float y, float width, float height, sf::Color fillColor);
 
@@ -40,28 +79,57 @@ public:
     void borderFill(int x, int y, sf::Color fillColor, sf::Color borderColor);
     void floodFill(int x, int y, sf::Color fillColor, sf::Color targetColor);
 
+    // Points and lines added between beginBatch() and flushBatch() look like drawPoint() and
+    // drawLine() but are drawn together, in one draw call with the current blend mode
+    void beginBatch();
+    void batchPoint(float x, float y, sf::Color color);
+    void batchLine(float x1, float y1, float x2, float y2, float thickness, sf::Color color);
+    void flushBatch();
+
+    void setBlendMode(const sf::BlendMode& mode);
+    const sf::BlendMode& getBlendMode() const;
+
+    // Release the per-frame scratch memory; call once at the end of every frame
+    void endFrame();
+    const FrameArena& getFrameArena() const;
+    TessellationCache& getTessellationCache();
+
 
 private:
 
     float getDistance(float x1, float y1, float x2, float y2);
     float getAngle(float x1, float y1, float x2, float y2);
-    void drawPixel(int x, int y, sf::Color color);
-    void drawEllipsePoints(int cx, int cy, int x, int y, sf::Color color);
-    void drawCirclePointsSymmetrical(int cx, int cy, int x, int y, sf::Color color);
+    // Pixel primitives take the clip bounds computed once per primitive instead of each
+    // pixel computing them again from the view
+    void drawPixel(int x, int y, sf::Color color, const AABB& clip);
+    // Draw without the visibility test
+    void drawRectangleShape(float x, float y, float width, float height, sf::Color color);
+    void drawEllipseShape(float centerX, float centerY, float rx, float ry, sf::Color color);
+    // Flatten 'path' for 'transform' and return its points moved into place (in pathPoints)
+    const FlattenedPath& transformPath(const Path& path, const Affine2D& transform);
+    void drawEllipsePoints(int cx, int cy, int x, int y, sf::Color color, const AABB& clip);
+    void drawCirclePointsSymmetrical(int cx, int cy, int x, int y, sf::Color color, const AABB& clip);
     bool isPolygonValid(const std::vector<Point2D>& points);
-    bool doSegmentsIntersect(const LineSegment& segment1, const LineSegment& segment2);
-    int orientation(const Point2D& p, const Point2D& q, const Point2D& r);
-    bool onSegment(const Point2D& p, const Point2D& q, const Point2D& r);
+    bool isPolygonValid(const Vec2* points, size_t count);
+
 
 
+    // Visible area of the window's current view in drawing coordinates, grown by 'margin'
+    AABB getClipBounds(float margin = 0.f) const;
+    bool isVisible(const AABB& bounds) const;
 
     // Helper function to check if a point is inside the window boundaries
     bool isInsideWindow(int x, int y);
 
     // Helper function to get the color of a pixel from the render texture
     sf::Color getPixelColor(int x, int y);
+    // Read the render texture back, at most once per frame
+    void capturePixels();
+
+    // Stack-based fill shared by floodFill and consistencyFill
+    void fillFromSeed(int x, int y, sf::Color fillColor, sf::Color targetColor);
 
     // Helper function to fill a horizontal section of pixels
-    void fillHorizontalSection(int startX, int endX, int y, sf::Color fillColor);
+    void fillHorizontalSection(int startX, int endX, int y, sf::Color fillColor, const AABB& clip);
 
 };
@@ -0,0 +1,316 @@
+//RleSprite.cpp
+#include "RleSprite.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Bilinear weights have 7 fractional bits, so a weighted premultiplied channel fits in 32 bits
+	const int weightBits = 7;
+	const std::uint32_t weightOne = 1u << weightBits;
+
+	int ceilToInt(float value) {
+		return static_cast<int>(std::ceil(value));
+	}
+}
+
+RleSprite::RleSprite() : width(0), height(0), opaqueRuns(0) {
+}
+
+bool RleSprite::encode(const sf::Uint8* rgba, unsigned _width, unsigned _height, unsigned rowLength) {
+	width = 0;
+	height = 0;
+	opaqueRuns = 0;
+	runs.clear();
+	rowStarts.clear();
+	pixels.clear();
+	if (!rgba || _width == 0 || _height == 0 || _width > 0xFFFF || _height > 0xFFFF) {
+		return false;
+	}
+	width = _width;
+	height = _height;
+	if (rowLength < width) {
+		rowLength = width;
+	}
+
+	rowStarts.reserve(height + 1);
+	for (unsigned y = 0; y < height; ++y) {
+		rowStarts.push_back(static_cast<std::uint32_t>(runs.size()));
+		const sf::Uint8* row = rgba + static_cast<std::size_t>(y) * rowLength * 4;
+		unsigned x = 0;
+		while (x < width) {
+			const sf::Uint8 alpha = row[x * 4 + 3];
+			if (alpha == 0) {
+				++x;
+				continue;
+			}
+			// A run holds pixels that are all opaque or all translucent
+			const bool opaque = alpha == 255;
+			Run run;
+			run.pixelOffset = static_cast<std::uint32_t>(pixels.size());
+			run.x = static_cast<std::uint16_t>(x);
+			run.opaque = opaque;
+			while (x < width && row[x * 4 + 3] != 0 && (row[x * 4 + 3] == 255) == opaque) {
+				const sf::Uint8* pixel = row + x * 4;
+				pixels.push_back(Framebuffer::toPixel(sf::Color(pixel[0], pixel[1], pixel[2], pixel[3])));
+				++x;
+			}
+			run.length = static_cast<std::uint16_t>(x - run.x);
+			runs.push_back(run);
+			opaqueRuns += opaque ? 1 : 0;
+		}
+	}
+	rowStarts.push_back(static_cast<std::uint32_t>(runs.size()));
+	return true;
+}
+
+bool RleSprite::encode(const sf::Image& image) {
+	return encode(image.getPixelsPtr(), image.getSize().x, image.getSize().y);
+}
+
+template <typename Format>
+void RleSprite::blit(BasicFramebuffer<Format>& target, int x, int y, RunSelection selection) const {
+	const int targetWidth = static_cast<int>(target.getWidth());
+	const int firstRow = std::max(-y, 0);
+	const int lastRow = std::min(static_cast<int>(height), static_cast<int>(target.getHeight()) - y);
+	for (int sy = firstRow; sy < lastRow; ++sy) {
+		for (std::uint32_t r = rowStarts[sy]; r < rowStarts[sy + 1]; ++r) {
+			const Run& run = runs[r];
+			if (x + run.x >= targetWidth) {
+				break;
+			}
+			if (!isSelected(run, selection)) {
+				continue;
+			}
+			// Opaque runs are copied, translucent ones blended; the framebuffer clips them
+			if (run.opaque) {
+				target.writeSpan(x + run.x, y + sy, pixels.data() + run.pixelOffset, run.length);
+			}
+			else {
+				target.blendSpan(x + run.x, y + sy, pixels.data() + run.pixelOffset, run.length);
+			}
+		}
+	}
+}
+
+template <typename Format>
+void RleSprite::blitScaled(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY, Filter filter, RunSelection selection) const {
+	if (width == 0 || scaleX <= 0.f || scaleY <= 0.f) {
+		return;
+	}
+	if (scaleX == 1.f && scaleY == 1.f && x == std::floor(x) && y == std::floor(y)) {
+		blit(target, static_cast<int>(x), static_cast<int>(y), selection);
+	}
+	else if (filter == BilinearFilter) {
+		// Filtered edges are translucent wherever they are, so the whole sprite counts as translucent
+		if (selection != OpaqueRuns) {
+			blitBilinear(target, x, y, scaleX, scaleY);
+		}
+	}
+	else {
+		blitNearest(target, x, y, scaleX, scaleY, selection);
+	}
+}
+
+template <typename Format>
+void RleSprite::blitNearest(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY, RunSelection selection) const {
+	// Destination pixel (i, j) shows source pixel ((i + 0.5 - x) / scaleX, (j + 0.5 - y) / scaleY)
+	const int targetWidth = static_cast<int>(target.getWidth());
+	const int firstY = std::max(ceilToInt(y - 0.5f), 0);
+	const int lastY = std::min(ceilToInt(y + height * scaleY - 0.5f), static_cast<int>(target.getHeight()));
+	const float inverseX = 1.f / scaleX;
+	const float inverseY = 1.f / scaleY;
+	const bool integerScale = scaleX == std::floor(scaleX) && x == std::floor(x);
+	const int repeat = static_cast<int>(scaleX);
+	const std::int32_t step = static_cast<std::int32_t>(inverseX * 65536.f);
+
+	for (int j = firstY; j < lastY; ++j) {
+		const int sy = std::min(static_cast<int>((j + 0.5f - y) * inverseY), static_cast<int>(height) - 1);
+		for (std::uint32_t r = rowStarts[sy]; r < rowStarts[sy + 1]; ++r) {
+			const Run& run = runs[r];
+			// Destination columns whose centers fall inside the run
+			const int begin = ceilToInt(x + run.x * scaleX - 0.5f);
+			const int end = ceilToInt(x + (run.x + run.length) * scaleX - 0.5f);
+			if (begin >= targetWidth) {
+				break;
+			}
+			const int clippedBegin = std::max(begin, 0);
+			const int clippedEnd = std::min(end, targetWidth);
+			if (clippedBegin >= clippedEnd || !isSelected(run, selection)) {
+				continue;
+			}
+			const Framebuffer::Pixel* source = pixels.data() + run.pixelOffset;
+			lineScratch.resize(clippedEnd - clippedBegin);
+			Framebuffer::Pixel* line = lineScratch.data();
+
+			if (integerScale) {
+				// Every source pixel covers 'repeat' destination pixels; a clipped run starts part way in
+				int sx = (clippedBegin - begin) / repeat;
+				int count = repeat - (clippedBegin - begin) % repeat;
+				for (int i = 0; i < clippedEnd - clippedBegin; count = repeat, ++sx) {
+					count = std::min(count, clippedEnd - clippedBegin - i);
+					std::fill(line + i, line + i + count, source[sx]);
+					i += count;
+				}
+			}
+			else {
+				// Source column within the run in 16.16 fixed point, stepped once per destination pixel
+				const int last = run.length - 1;
+				std::int32_t position = static_cast<std::int32_t>(((clippedBegin + 0.5f - x) * inverseX - run.x) * 65536.f);
+				for (int i = 0; i < clippedEnd - clippedBegin; ++i, position += step) {
+					line[i] = source[std::max(std::min(position >> 16, last), 0)];
+				}
+			}
+
+			if (run.opaque) {
+				target.writeSpan(clippedBegin, j, line, clippedEnd - clippedBegin);
+			}
+			else {
+				target.blendSpan(clippedBegin, j, line, clippedEnd - clippedBegin);
+			}
+		}
+	}
+}
+
+template <typename Format>
+void RleSprite::blitBilinear(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY) const {
+	// Destination pixel (i, j) samples the source at ((i + 0.5 - x) / scaleX - 0.5, (j + 0.5 - y) / scaleY - 0.5)
+	const int targetWidth = static_cast<int>(target.getWidth());
+	const int left = std::max(ceilToInt(x - 0.5f), 0);
+	const int right = std::min(ceilToInt(x + width * scaleX - 0.5f), targetWidth);
+	const int firstY = std::max(ceilToInt(y - 0.5f), 0);
+	const int lastY = std::min(ceilToInt(y + height * scaleY - 0.5f), static_cast<int>(target.getHeight()));
+	if (left >= right) {
+		return;
+	}
+	const float inverseX = 1.f / scaleX;
+	const float inverseY = 1.f / scaleY;
+	const std::int32_t step = static_cast<std::int32_t>(inverseX * 65536.f);
+
+	// Each decoded row has a transparent pixel on both sides, so edge taps need no checks
+	const std::size_t stride = width + 2;
+	rowScratch.resize(stride * 2);
+	Framebuffer::Pixel* rows[2] = { rowScratch.data(), rowScratch.data() + stride };
+	int decodedRows[2] = { -2, -2 };
+
+	for (int j = firstY; j < lastY; ++j) {
+		const float v = (j + 0.5f - y) * inverseY - 0.5f;
+		const int y0 = static_cast<int>(std::floor(v));
+		const std::uint32_t weightY = static_cast<std::uint32_t>((v - y0) * weightOne);
+
+		// Decode the two source rows and collect the destination spans that can see their runs
+		spanScratch.clear();
+		for (int k = 0; k < 2; ++k) {
+			const int sy = y0 + k;
+			if (decodedRows[k] != sy) {
+				decodedRows[k] = sy;
+				std::fill(rows[k], rows[k] + stride, 0);
+				if (sy >= 0 && sy < static_cast<int>(height)) {
+					decodeRow(static_cast<unsigned>(sy), rows[k]);
+				}
+			}
+			if (sy < 0 || sy >= static_cast<int>(height)) {
+				continue;
+			}
+			for (std::uint32_t r = rowStarts[sy]; r < rowStarts[sy + 1]; ++r) {
+				const Run& run = runs[r];
+				const int begin = std::max(ceilToInt(x + (run.x - 0.5f) * scaleX - 0.5f), left);
+				const int end = std::min(ceilToInt(x + (run.x + run.length + 0.5f) * scaleX - 0.5f), right);
+				if (begin < end) {
+					spanScratch.push_back(std::make_pair(begin, end));
+				}
+			}
+		}
+		std::sort(spanScratch.begin(), spanScratch.end());
+
+		int done = left;
+		for (const std::pair<int, int>& span : spanScratch) {
+			// Spans of the two rows overlap; pixels already written are not blended twice
+			const int first = std::max(span.first, done);
+			if (first >= span.second) {
+				continue;
+			}
+			done = span.second;
+			lineScratch.resize(span.second - first);
+			Framebuffer::Pixel* line = lineScratch.data();
+			// Source column in 16.16 fixed point, stepped once per destination pixel
+			std::int32_t position = static_cast<std::int32_t>(std::floor(((first + 0.5f - x) * inverseX - 0.5f) * 65536.f));
+			for (int i = first; i < span.second; ++i, position += step) {
+				const int x0 = position >> 16;
+				const std::uint32_t weightX = (position >> (16 - weightBits)) & (weightOne - 1);
+				const std::uint32_t weights[4] = {
+					(weightOne - weightX) * (weightOne - weightY), weightX * (weightOne - weightY),
+					(weightOne - weightX) * weightY, weightX * weightY };
+				const Framebuffer::Pixel taps[4] = { rows[0][x0 + 1], rows[0][x0 + 2], rows[1][x0 + 1], rows[1][x0 + 2] };
+
+				// Inside the sprite all four taps are usually opaque and a plain weighted sum will do
+				if ((taps[0] & taps[1] & taps[2] & taps[3]) >> 24 == 255) {
+					std::uint32_t red = 0, green = 0, blue = 0;
+					for (int t = 0; t < 4; ++t) {
+						red += (taps[t] & 0xFF) * weights[t];
+						green += ((taps[t] >> 8) & 0xFF) * weights[t];
+						blue += ((taps[t] >> 16) & 0xFF) * weights[t];
+					}
+					const int shift = weightBits * 2;
+					line[i - first] = (red >> shift) | ((green >> shift) << 8) | ((blue >> shift) << 16) | 0xFF000000u;
+					continue;
+				}
+
+				// Otherwise weight by alpha as well, so transparent neighbours do not darken the edges
+				std::uint32_t alphaSum = 0, red = 0, green = 0, blue = 0;
+				for (int t = 0; t < 4; ++t) {
+					const std::uint32_t weight = weights[t] * Framebuffer::getAlpha(taps[t]);
+					alphaSum += weight;
+					red += (taps[t] & 0xFF) * weight;
+					green += ((taps[t] >> 8) & 0xFF) * weight;
+					blue += ((taps[t] >> 16) & 0xFF) * weight;
+				}
+				const std::uint32_t alpha = alphaSum >> (weightBits * 2);
+				line[i - first] = alpha == 0 ? 0 : (red / alphaSum) | ((green / alphaSum) << 8) | ((blue / alphaSum) << 16) | (alpha << 24);
+			}
+			target.blendSpan(first, j, line, span.second - first);
+		}
+	}
+}
+
+bool RleSprite::isSelected(const Run& run, RunSelection selection) {
+	return selection == AllRuns || run.opaque == (selection == OpaqueRuns);
+}
+
+void RleSprite::decodeRow(unsigned y, Framebuffer::Pixel* row) const {
+	for (std::uint32_t r = rowStarts[y]; r < rowStarts[y + 1]; ++r) {
+		const Run& run = runs[r];
+		std::memcpy(row + 1 + run.x, pixels.data() + run.pixelOffset, run.length * sizeof(Framebuffer::Pixel));
+	}
+}
+
+unsigned RleSprite::getWidth() const {
+	return width;
+}
+
+unsigned RleSprite::getHeight() const {
+	return height;
+}
+
+std::size_t RleSprite::getRunCount() const {
+	return runs.size();
+}
+
+std::size_t RleSprite::getStoredPixelCount() const {
+	return pixels.size();
+}
+
+bool RleSprite::hasOpaqueRuns() const {
+	return opaqueRuns > 0;
+}
+
+bool RleSprite::hasTranslucentRuns() const {
+	return opaqueRuns < runs.size();
+}
+
+template void RleSprite::blit(Framebuffer&, int, int, RunSelection) const;
+template void RleSprite::blit(Rgb565Framebuffer&, int, int, RunSelection) const;
+template void RleSprite::blit(Rgb332Framebuffer&, int, int, RunSelection) const;
+template void RleSprite::blitScaled(Framebuffer&, float, float, float, float, Filter, RunSelection) const;
+template void RleSprite::blitScaled(Rgb565Framebuffer&, float, float, float, float, Filter, RunSelection) const;
+template void RleSprite::blitScaled(Rgb332Framebuffer&, float, float, float, float, Filter, RunSelection) const;
@@ -0,0 +1,85 @@
+//RleSprite.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Framebuffer.h"
+
+// Sprite stored as runs of visible RGBA8 pixels, row by row, for blitting into a framebuffer of
+// any pixel format. Fully transparent pixels are not stored at all, opaque runs are copied
+// straight into the frame and only translucent runs are blended, so a blit reads and writes
+// the sprite's visible pixels and nothing else. Scaled blits map each run to the destination span it covers and
+// skip the empty space the same way.
+class RleSprite {
+public:
+    enum Filter {
+        NearestFilter,
+        BilinearFilter
+    };
+    // Which runs a blit draws, so the opaque and translucent parts can go in separate passes
+    enum RunSelection {
+        AllRuns,
+        OpaqueRuns,
+        TranslucentRuns
+    };
+
+private:
+    struct Run {
+        // Index of the run's first pixel in 'pixels'
+        std::uint32_t pixelOffset;
+        std::uint16_t x;
+        std::uint16_t length;
+        bool opaque;
+    };
+
+    unsigned width;
+    unsigned height;
+    std::vector<Run> runs;
+    // Runs of row y are runs[rowStarts[y], rowStarts[y + 1])
+    std::vector<std::uint32_t> rowStarts;
+    std::vector<Framebuffer::Pixel> pixels;
+    std::size_t opaqueRuns;
+    // Two decoded source rows and the destination spans they reach, reused by bilinear blits
+    mutable std::vector<Framebuffer::Pixel> rowScratch;
+    mutable std::vector<std::pair<int, int>> spanScratch;
+    // One scaled span, handed to the framebuffer in one call
+    mutable std::vector<Framebuffer::Pixel> lineScratch;
+
+public:
+    RleSprite();
+
+    // Encode RGBA8 pixels stored row by row, 'rowLength' pixels apart (0 for the width), so
+    // a tile can be taken straight out of an atlas. Fails for images wider or taller than 65535.
+    bool encode(const sf::Uint8* rgba, unsigned _width, unsigned _height, unsigned rowLength = 0);
+    bool encode(const sf::Image& image);
+
+    // Draw unscaled with the top-left corner at (x, y), clipped to the framebuffer
+    template <typename Format>
+    void blit(BasicFramebuffer<Format>& target, int x, int y, RunSelection selection = AllRuns) const;
+    // Draw stretched over [x, x + width * scaleX) x [y, y + height * scaleY). Integer scales
+    // at integer positions repeat every source pixel; bilinear filtering blends the four
+    // nearest source pixels and is only run over spans next to visible pixels; its soft edges
+    // make every filtered pixel translucent, so it draws nothing for OpaqueRuns.
+    template <typename Format>
+    void blitScaled(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY, Filter filter = NearestFilter,
+        RunSelection selection = AllRuns) const;
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    std::size_t getRunCount() const;
+    // Pixels actually stored, i.e. the ones a blit touches at scale 1
+    std::size_t getStoredPixelCount() const;
+    bool hasOpaqueRuns() const;
+    bool hasTranslucentRuns() const;
+
+private:
+    template <typename Format>
+    void blitNearest(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY, RunSelection selection) const;
+    template <typename Format>
+    void blitBilinear(BasicFramebuffer<Format>& target, float x, float y, float scaleX, float scaleY) const;
+    static bool isSelected(const Run& run, RunSelection selection);
+    // Write the runs of source row 'y' into 'row', which has a transparent pixel on each side
+    void decodeRow(unsigned y, Framebuffer::Pixel* row) const;
+};
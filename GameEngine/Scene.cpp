@@ -0,0 +1,274 @@
+//Scene.cpp
+#include "Scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	const char sceneMagic[4] = { 'G', 'E', 'S', 'C' };
+
+	// The views point straight into the file, so the records must have no padding to guess about
+	static_assert(sizeof(Vec2) == 8, "Vec2 must be two packed floats");
+	static_assert(sizeof(Segment) == 16, "Segment must be two packed Vec2");
+	static_assert(sizeof(ScenePolygon) == 16, "ScenePolygon layout changed");
+	static_assert(sizeof(SceneInstance) == 32, "SceneInstance layout changed");
+	static_assert(sizeof(SceneChunk) == 16, "SceneChunk layout changed");
+	static_assert(sizeof(SceneHeader) % sceneAlignment == 0, "Sections must start aligned");
+
+	std::int32_t chunkIndex(float coordinate, float chunkSize) {
+		return static_cast<std::int32_t>(std::floor(coordinate / chunkSize));
+	}
+
+	// Chunk table order: by y, then x
+	bool chunkBefore(std::int32_t x1, std::int32_t y1, std::int32_t x2, std::int32_t y2) {
+		return y1 != y2 ? y1 < y2 : x1 < x2;
+	}
+}
+
+SceneFile::SceneFile() : chunkSize(0.f) {}
+
+bool SceneFile::open(const std::string& path) {
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+	if (file.getSize() < sizeof(SceneHeader)) {
+		close();
+		return false;
+	}
+	const SceneHeader& header = *reinterpret_cast<const SceneHeader*>(file.getData());
+	if (std::memcmp(header.magic, sceneMagic, sizeof(sceneMagic)) != 0 || header.version != sceneVersion ||
+		header.sectionCount != SceneSectionCount || !(header.chunkSize > 0.f) ||
+		!mapSection(header, ScenePoints, points) ||
+		!mapSection(header, SceneSegments, segments) ||
+		!mapSection(header, SceneVertices, vertices) ||
+		!mapSection(header, ScenePolygons, polygons) ||
+		!mapSection(header, SceneInstances, instances) ||
+		!mapSection(header, SceneChunks, chunks)) {
+		close();
+		return false;
+	}
+
+	// Polygon records are small next to the vertices they index, so checking them all is cheap
+	for (const ScenePolygon& polygon : polygons) {
+		if (polygon.firstVertex > vertices.size() || polygon.vertexCount > vertices.size() - polygon.firstVertex) {
+			close();
+			return false;
+		}
+	}
+	// So are the chunk records next to the instances
+	for (const SceneChunk& chunk : chunks) {
+		if (chunk.firstInstance > instances.size() || chunk.instanceCount > instances.size() - chunk.firstInstance) {
+			close();
+			return false;
+		}
+	}
+	chunkSize = header.chunkSize;
+	return true;
+}
+
+void SceneFile::close() {
+	file.close();
+	points = ArrayView<Vec2>();
+	segments = ArrayView<Segment>();
+	vertices = ArrayView<Vec2>();
+	polygons = ArrayView<ScenePolygon>();
+	instances = ArrayView<SceneInstance>();
+	chunks = ArrayView<SceneChunk>();
+	chunkSize = 0.f;
+}
+
+bool SceneFile::isOpen() const {
+	return file.isOpen();
+}
+
+const ArrayView<Vec2>& SceneFile::getPoints() const {
+	return points;
+}
+
+const ArrayView<Segment>& SceneFile::getSegments() const {
+	return segments;
+}
+
+const ArrayView<Vec2>& SceneFile::getVertices() const {
+	return vertices;
+}
+
+const ArrayView<ScenePolygon>& SceneFile::getPolygons() const {
+	return polygons;
+}
+
+const ArrayView<SceneInstance>& SceneFile::getInstances() const {
+	return instances;
+}
+
+const ArrayView<SceneChunk>& SceneFile::getChunks() const {
+	return chunks;
+}
+
+ArrayView<Vec2> SceneFile::getPolygonVertices(const ScenePolygon& polygon) const {
+	return ArrayView<Vec2>(vertices.data() + polygon.firstVertex, polygon.vertexCount);
+}
+
+float SceneFile::getChunkSize() const {
+	return chunkSize;
+}
+
+ArrayView<SceneInstance> SceneFile::getChunkInstances(int x, int y) const {
+	const SceneChunk* found = std::lower_bound(chunks.begin(), chunks.end(), std::make_pair(x, y),
+		[](const SceneChunk& chunk, const std::pair<int, int>& coord) {
+			return chunkBefore(chunk.x, chunk.y, coord.first, coord.second);
+		});
+	if (found == chunks.end() || found->x != x || found->y != y) {
+		return ArrayView<SceneInstance>();
+	}
+	return ArrayView<SceneInstance>(instances.data() + found->firstInstance, found->instanceCount);
+}
+
+template <typename T>
+bool SceneFile::mapSection(const SceneHeader& header, SceneSectionType type, ArrayView<T>& view) const {
+	const SceneSection& section = header.sections[type];
+	const std::uint64_t size = file.getSize();
+	if (section.count == 0) {
+		view = ArrayView<T>();
+		return true;
+	}
+	if (section.offset % sceneAlignment != 0 || section.offset > size || section.count > (size - section.offset) / sizeof(T)) {
+		return false;
+	}
+	view = ArrayView<T>(reinterpret_cast<const T*>(file.getData() + section.offset), static_cast<std::size_t>(section.count));
+	return true;
+}
+
+SceneWriter::SceneWriter() : position(0), currentSection(-1), failed(false) {
+	std::memset(&header, 0, sizeof(header));
+	std::memset(sectionWritten, 0, sizeof(sectionWritten));
+}
+
+SceneWriter::~SceneWriter() {
+	if (output.is_open()) {
+		close();
+	}
+}
+
+bool SceneWriter::open(const std::string& path, float chunkSize) {
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+	header.version = sceneVersion;
+	header.sectionCount = SceneSectionCount;
+	header.chunkSize = chunkSize;
+	std::memset(sectionWritten, 0, sizeof(sectionWritten));
+	currentSection = -1;
+	failed = !(chunkSize > 0.f);
+	pendingInstances.clear();
+
+	output.open(path, std::ios::binary | std::ios::trunc);
+	if (!output.is_open()) {
+		return false;
+	}
+	// Placeholder; the real section table is written by close()
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	position = sizeof(header);
+	return static_cast<bool>(output);
+}
+
+bool SceneWriter::close() {
+	if (!output.is_open()) {
+		return false;
+	}
+	if (!pendingInstances.empty()) {
+		flushInstances();
+	}
+	output.seekp(0);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.close();
+	return !failed && !output.fail();
+}
+
+void SceneWriter::writePoints(const Vec2* data, std::size_t count) {
+	write(ScenePoints, data, count, sizeof(Vec2));
+}
+
+void SceneWriter::writeSegments(const Segment* data, std::size_t count) {
+	write(SceneSegments, data, count, sizeof(Segment));
+}
+
+void SceneWriter::writeVertices(const Vec2* data, std::size_t count) {
+	write(SceneVertices, data, count, sizeof(Vec2));
+}
+
+void SceneWriter::writePolygons(const ScenePolygon* data, std::size_t count) {
+	write(ScenePolygons, data, count, sizeof(ScenePolygon));
+}
+
+void SceneWriter::writeInstances(const SceneInstance* data, std::size_t count) {
+	if (!output.is_open() || count == 0) {
+		return;
+	}
+	if (sectionWritten[SceneInstances]) {
+		failed = true;
+		return;
+	}
+	pendingInstances.insert(pendingInstances.end(), data, data + count);
+	currentSection = SceneInstances;
+}
+
+std::uint32_t SceneWriter::getVertexCount() const {
+	return static_cast<std::uint32_t>(header.sections[SceneVertices].count);
+}
+
+void SceneWriter::write(SceneSectionType type, const void* data, std::size_t count, std::size_t stride) {
+	if (!output.is_open() || count == 0) {
+		return;
+	}
+	if (!pendingInstances.empty()) {
+		flushInstances();
+	}
+	if (currentSection != type) {
+		if (sectionWritten[type]) {
+			// The section was already closed by another one; its records must stay contiguous
+			failed = true;
+			return;
+		}
+		pad();
+		header.sections[type].offset = position;
+		sectionWritten[type] = true;
+		currentSection = type;
+	}
+	output.write(static_cast<const char*>(data), static_cast<std::streamsize>(count * stride));
+	position += count * stride;
+	header.sections[type].count += count;
+}
+
+void SceneWriter::pad() {
+	const char zeros[sceneAlignment] = {};
+	const std::size_t padding = static_cast<std::size_t>((sceneAlignment - position % sceneAlignment) % sceneAlignment);
+	output.write(zeros, static_cast<std::streamsize>(padding));
+	position += padding;
+}
+
+void SceneWriter::flushInstances() {
+	std::vector<SceneInstance> instances;
+	instances.swap(pendingInstances);
+	currentSection = -1;
+	const float chunkSize = header.chunkSize;
+	// Stable, so the instances of one chunk keep the order they were written in
+	std::stable_sort(instances.begin(), instances.end(), [chunkSize](const SceneInstance& a, const SceneInstance& b) {
+		return chunkBefore(chunkIndex(a.position.x, chunkSize), chunkIndex(a.position.y, chunkSize),
+			chunkIndex(b.position.x, chunkSize), chunkIndex(b.position.y, chunkSize));
+	});
+
+	std::vector<SceneChunk> table;
+	for (std::size_t i = 0; i < instances.size(); ++i) {
+		const std::int32_t x = chunkIndex(instances[i].position.x, chunkSize);
+		const std::int32_t y = chunkIndex(instances[i].position.y, chunkSize);
+		if (table.empty() || table.back().x != x || table.back().y != y) {
+			const SceneChunk chunk = { x, y, static_cast<std::uint32_t>(i), 0 };
+			table.push_back(chunk);
+		}
+		++table.back().instanceCount;
+	}
+
+	write(SceneInstances, instances.data(), instances.size(), sizeof(SceneInstance));
+	write(SceneChunks, table.data(), table.size(), sizeof(SceneChunk));
+}
@@ -0,0 +1,179 @@
+//Scene.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Geometry.h"
+#include "MappedFile.h"
+
+// Scene file layout, in the byte order of the machine that wrote it:
+//   SceneHeader, then one flat array per section, each starting on a sceneAlignment boundary.
+// Every array holds plain fixed-size records, so a loaded scene is just pointers into the
+// mapped file: opening it allocates nothing and reads no more than the pages that get used.
+// Instances are stored grouped by the square chunk their position falls in, with a table of
+// each chunk's run, so streaming one chunk touches only that chunk's records.
+const std::uint32_t sceneVersion = 2;
+const std::size_t sceneAlignment = 16;
+const float sceneDefaultChunkSize = 800.f;
+
+enum SceneSectionType {
+    ScenePoints,     // Vec2
+    SceneSegments,   // Segment
+    SceneVertices,   // Vec2, shared by all polygons
+    ScenePolygons,   // ScenePolygon
+    SceneInstances,  // SceneInstance, ordered by chunk
+    SceneChunks,     // SceneChunk, ordered by y then x
+    SceneSectionCount
+};
+
+enum ScenePolygonFlags : std::uint32_t {
+    ScenePolygonClosed = 1 << 0,
+    ScenePolygonFilled = 1 << 1
+};
+
+// A polyline or polygon: a run of the vertex section
+struct ScenePolygon {
+    std::uint32_t firstVertex;
+    std::uint32_t vertexCount;
+    std::uint32_t color;   // sf::Color::toInteger()
+    std::uint32_t flags;
+};
+
+enum SceneShapeKind : std::uint32_t {
+    SceneCircle,     // position is the center, size.x the radius
+    SceneRectangle,  // size is width and height, position the top-left corner
+    SceneEllipse     // size is the two radii, position the center
+};
+
+// A placed primitive shape
+struct SceneInstance {
+    std::uint32_t kind;
+    std::uint32_t color;
+    Vec2 position;
+    Vec2 size;
+    float rotation;
+    std::uint32_t reserved;
+};
+
+// The run of the instance section placed in chunk (x, y), i.e. whose position lies in
+// [x, x + 1) * chunkSize by [y, y + 1) * chunkSize
+struct SceneChunk {
+    std::int32_t x;
+    std::int32_t y;
+    std::uint32_t firstInstance;
+    std::uint32_t instanceCount;
+};
+
+struct SceneSection {
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+struct SceneHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t sectionCount;
+    float chunkSize;
+    SceneSection sections[SceneSectionCount];
+};
+
+// Read-only window onto a run of records
+template <typename T>
+class ArrayView {
+private:
+    const T* first;
+    std::size_t count;
+
+public:
+    ArrayView() : first(nullptr), count(0) {}
+    ArrayView(const T* _first, std::size_t _count) : first(_first), count(_count) {}
+
+    const T* data() const { return first; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    const T& operator[](std::size_t index) const { return first[index]; }
+};
+
+// A scene file mapped into memory. The views stay valid until the scene is closed.
+class SceneFile {
+private:
+    MappedFile file;
+    ArrayView<Vec2> points;
+    ArrayView<Segment> segments;
+    ArrayView<Vec2> vertices;
+    ArrayView<ScenePolygon> polygons;
+    ArrayView<SceneInstance> instances;
+    ArrayView<SceneChunk> chunks;
+    float chunkSize;
+
+public:
+    SceneFile();
+
+    // Map the file and check that every section, polygon and chunk lies inside it
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    const ArrayView<Vec2>& getPoints() const;
+    const ArrayView<Segment>& getSegments() const;
+    const ArrayView<Vec2>& getVertices() const;
+    const ArrayView<ScenePolygon>& getPolygons() const;
+    const ArrayView<SceneInstance>& getInstances() const;
+    const ArrayView<SceneChunk>& getChunks() const;
+    ArrayView<Vec2> getPolygonVertices(const ScenePolygon& polygon) const;
+    // Side of the chunks the instances are grouped by
+    float getChunkSize() const;
+    // Instances placed in chunk (x, y), found by a binary search of the chunk table
+    ArrayView<SceneInstance> getChunkInstances(int x, int y) const;
+
+private:
+    template <typename T>
+    bool mapSection(const SceneHeader& header, SceneSectionType type, ArrayView<T>& view) const;
+};
+
+// Streams records straight to disk, so scenes of any size can be written without holding them
+// in memory. Records go into the current section; writing another kind of record starts that
+// section. Each section can be written only once, in any order. Instances are the exception:
+// they are kept until the section ends, then written sorted by chunk along with the chunk table.
+class SceneWriter {
+private:
+    std::ofstream output;
+    SceneHeader header;
+    std::uint64_t position;
+    int currentSection;
+    bool sectionWritten[SceneSectionCount];
+    bool failed;
+    std::vector<SceneInstance> pendingInstances;
+
+public:
+    SceneWriter();
+    ~SceneWriter();
+
+    SceneWriter(const SceneWriter&) = delete;
+    SceneWriter& operator=(const SceneWriter&) = delete;
+
+    // Instances are grouped into squares of 'chunkSize'
+    bool open(const std::string& path, float chunkSize = sceneDefaultChunkSize);
+    // Write the section table and close the file; false if anything went wrong along the way
+    bool close();
+
+    void writePoints(const Vec2* data, std::size_t count);
+    void writeSegments(const Segment* data, std::size_t count);
+    void writeVertices(const Vec2* data, std::size_t count);
+    void writePolygons(const ScenePolygon* data, std::size_t count);
+    void writeInstances(const SceneInstance* data, std::size_t count);
+
+    // Number of vertices written so far, i.e. the firstVertex of the next polygon
+    std::uint32_t getVertexCount() const;
+
+private:
+    void write(SceneSectionType type, const void* data, std::size_t count, std::size_t stride);
+    void pad();
+    // Sort the pending instances by chunk and write them and the chunk table
+    void flushInstances();
+};
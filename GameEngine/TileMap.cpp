@@ -0,0 +1,168 @@
+//TileMap.cpp
+#include "TileMap.h"
+#include "Clipping.h"
+#include <algorithm>
+#include <cmath>
+
+const TileMap::Tile TileMap::emptyTile;
+
+TileMap::TileMap()
+	: width(0), height(0), tileSize(0.f), chunkSize(0), chunkColumns(0), chunkRows(0), tileset(nullptr),
+	tilesetColumns(0), atlasTileSize(0), useVertexBuffers(sf::VertexBuffer::isAvailable()), drawnChunks(0), rebuiltChunks(0) {}
+
+void TileMap::create(unsigned _width, unsigned _height, float _tileSize, unsigned _chunkSize) {
+	width = _width;
+	height = _height;
+	tileSize = _tileSize;
+	chunkSize = std::max(_chunkSize, 1u);
+	chunkColumns = (width + chunkSize - 1) / chunkSize;
+	chunkRows = (height + chunkSize - 1) / chunkSize;
+	tiles.assign(static_cast<std::size_t>(width) * height, emptyTile);
+
+	chunks.clear();
+	chunks.resize(static_cast<std::size_t>(chunkColumns) * chunkRows);
+	for (Chunk& chunk : chunks) {
+		chunk.vertexCount = 0;
+		chunk.dirty = true;
+	}
+}
+
+void TileMap::setTileset(const sf::Texture& texture, unsigned _atlasTileSize) {
+	tileset = &texture;
+	atlasTileSize = std::max(_atlasTileSize, 1u);
+	tilesetColumns = std::max(texture.getSize().x / atlasTileSize, 1u);
+	for (Chunk& chunk : chunks) {
+		chunk.dirty = true;
+	}
+}
+
+void TileMap::setTile(unsigned x, unsigned y, Tile tile) {
+	if (x >= width || y >= height) {
+		return;
+	}
+	Tile& current = tiles[static_cast<std::size_t>(y) * width + x];
+	if (current != tile) {
+		current = tile;
+		markDirty(x, y);
+	}
+}
+
+TileMap::Tile TileMap::getTile(unsigned x, unsigned y) const {
+	if (x >= width || y >= height) {
+		return emptyTile;
+	}
+	return tiles[static_cast<std::size_t>(y) * width + x];
+}
+
+void TileMap::fill(unsigned x, unsigned y, unsigned w, unsigned h, Tile tile) {
+	const unsigned endX = std::min(width, x + w);
+	const unsigned endY = std::min(height, y + h);
+	for (unsigned row = y; row < endY; ++row) {
+		for (unsigned column = x; column < endX; ++column) {
+			setTile(column, row, tile);
+		}
+	}
+}
+
+unsigned TileMap::getWidth() const {
+	return width;
+}
+
+unsigned TileMap::getHeight() const {
+	return height;
+}
+
+float TileMap::getTileSize() const {
+	return tileSize;
+}
+
+std::size_t TileMap::getDrawnChunkCount() const {
+	return drawnChunks;
+}
+
+std::size_t TileMap::getRebuiltChunkCount() const {
+	return rebuiltChunks;
+}
+
+void TileMap::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+	drawnChunks = 0;
+	rebuiltChunks = 0;
+	if (!tileset || chunks.empty()) {
+		return;
+	}
+
+	// Bring the visible area into map space to find the chunks under it
+	const AABB view = computeViewBounds(target.getView());
+	const sf::FloatRect visible = getInverseTransform().transformRect(
+		sf::FloatRect(view.min.x, view.min.y, view.max.x - view.min.x, view.max.y - view.min.y));
+	const float chunkExtent = tileSize * chunkSize;
+	const int firstX = std::max(static_cast<int>(std::floor(visible.left / chunkExtent)), 0);
+	const int firstY = std::max(static_cast<int>(std::floor(visible.top / chunkExtent)), 0);
+	const int lastX = std::min(static_cast<int>(std::floor((visible.left + visible.width) / chunkExtent)), static_cast<int>(chunkColumns) - 1);
+	const int lastY = std::min(static_cast<int>(std::floor((visible.top + visible.height) / chunkExtent)), static_cast<int>(chunkRows) - 1);
+
+	states.transform.combine(getTransform());
+	states.texture = tileset;
+	for (int chunkY = firstY; chunkY <= lastY; ++chunkY) {
+		for (int chunkX = firstX; chunkX <= lastX; ++chunkX) {
+			Chunk& chunk = chunks[static_cast<std::size_t>(chunkY) * chunkColumns + chunkX];
+			if (chunk.dirty) {
+				rebuildChunk(chunkX, chunkY);
+				++rebuiltChunks;
+			}
+			if (chunk.vertexCount == 0) {
+				continue;
+			}
+			if (useVertexBuffers) {
+				target.draw(*chunk.buffer, states);
+			}
+			else {
+				target.draw(chunk.vertices.data(), chunk.vertexCount, sf::Quads, states);
+			}
+			++drawnChunks;
+		}
+	}
+}
+
+void TileMap::markDirty(unsigned x, unsigned y) {
+	chunks[static_cast<std::size_t>(y / chunkSize) * chunkColumns + x / chunkSize].dirty = true;
+}
+
+void TileMap::rebuildChunk(unsigned chunkX, unsigned chunkY) const {
+	Chunk& chunk = chunks[static_cast<std::size_t>(chunkY) * chunkColumns + chunkX];
+	chunk.dirty = false;
+
+	std::vector<sf::Vertex>& vertices = useVertexBuffers ? scratch : chunk.vertices;
+	vertices.clear();
+	const unsigned beginX = chunkX * chunkSize, endX = std::min(width, beginX + chunkSize);
+	const unsigned beginY = chunkY * chunkSize, endY = std::min(height, beginY + chunkSize);
+	const float atlasSize = static_cast<float>(atlasTileSize);
+	for (unsigned y = beginY; y < endY; ++y) {
+		for (unsigned x = beginX; x < endX; ++x) {
+			const Tile tile = tiles[static_cast<std::size_t>(y) * width + x];
+			if (tile == emptyTile) {
+				continue;
+			}
+			const float left = x * tileSize, top = y * tileSize;
+			const float u = static_cast<float>((tile - 1) % tilesetColumns) * atlasSize;
+			const float v = static_cast<float>((tile - 1) / tilesetColumns) * atlasSize;
+			vertices.push_back(sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(u, v)));
+			vertices.push_back(sf::Vertex(sf::Vector2f(left + tileSize, top), sf::Vector2f(u + atlasSize, v)));
+			vertices.push_back(sf::Vertex(sf::Vector2f(left + tileSize, top + tileSize), sf::Vector2f(u + atlasSize, v + atlasSize)));
+			vertices.push_back(sf::Vertex(sf::Vector2f(left, top + tileSize), sf::Vector2f(u, v + atlasSize)));
+		}
+	}
+	chunk.vertexCount = vertices.size();
+
+	if (!useVertexBuffers || chunk.vertexCount == 0) {
+		return;
+	}
+	if (!chunk.buffer) {
+		chunk.buffer.reset(new sf::VertexBuffer(sf::Quads, sf::VertexBuffer::Static));
+	}
+	// The buffer is only reallocated when the chunk's tile count changes
+	if (chunk.buffer->getVertexCount() != chunk.vertexCount) {
+		chunk.buffer->create(chunk.vertexCount);
+	}
+	chunk.buffer->update(vertices.data());
+}
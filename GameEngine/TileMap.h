@@ -0,0 +1,75 @@
+//TileMap.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Grid of tiles drawn from one tileset atlas. The map is split into square chunks; each
+// chunk's quads are built once, kept in a vertex buffer on the GPU and only rebuilt after
+// one of its tiles changes. Drawing looks up the chunks under the view and issues one draw
+// per chunk, so the cost depends on the screen size and not on the map size.
+// Chunks are built the first time they are seen, so huge maps only pay for what is visited.
+class TileMap : public sf::Drawable, public sf::Transformable {
+public:
+    // Tile id 0 is empty; id n shows atlas tile n - 1, counted row by row
+    typedef std::uint16_t Tile;
+    static const Tile emptyTile = 0;
+
+private:
+    struct Chunk {
+        // Only used when vertex buffers are not supported
+        std::vector<sf::Vertex> vertices;
+        std::unique_ptr<sf::VertexBuffer> buffer;
+        std::size_t vertexCount;
+        bool dirty;
+    };
+
+    unsigned width;
+    unsigned height;
+    float tileSize;
+    unsigned chunkSize;
+    unsigned chunkColumns;
+    unsigned chunkRows;
+    std::vector<Tile> tiles;
+    // Built on demand while drawing, hence mutable
+    mutable std::vector<Chunk> chunks;
+    mutable std::vector<sf::Vertex> scratch;
+
+    const sf::Texture* tileset;
+    unsigned tilesetColumns;
+    unsigned atlasTileSize;
+    bool useVertexBuffers;
+
+    mutable std::size_t drawnChunks;
+    mutable std::size_t rebuiltChunks;
+
+public:
+    TileMap();
+
+    // Size the map in tiles, all empty. 'tileSize' is the drawn size of a tile in pixels.
+    void create(unsigned _width, unsigned _height, float _tileSize, unsigned _chunkSize = 32);
+    // Atlas of square tiles 'atlasTileSize' pixels wide; the texture must outlive the map
+    void setTileset(const sf::Texture& texture, unsigned _atlasTileSize);
+
+    void setTile(unsigned x, unsigned y, Tile tile);
+    Tile getTile(unsigned x, unsigned y) const;
+    // Set every tile of the rectangle [x, x + w) x [y, y + h), clipped to the map
+    void fill(unsigned x, unsigned y, unsigned w, unsigned h, Tile tile);
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    float getTileSize() const;
+
+    // Chunks drawn and rebuilt by the last draw
+    std::size_t getDrawnChunkCount() const;
+    std::size_t getRebuiltChunkCount() const;
+
+protected:
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    void markDirty(unsigned x, unsigned y);
+    void rebuildChunk(unsigned chunkX, unsigned chunkY) const;
+};
@@ -0,0 +1,383 @@
+//TransformHierarchy.cpp
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const float pi = 3.141592654f;
+
+	template <typename T>
+	void permute(std::vector<T>& values, const std::vector<std::uint32_t>& order) {
+		std::vector<T> permuted;
+		permuted.reserve(order.size());
+		for (std::uint32_t oldIndex : order) {
+			permuted.push_back(values[oldIndex]);
+		}
+		values.swap(permuted);
+	}
+
+	template <typename T>
+	void compact(std::vector<T>& values, const std::vector<std::uint8_t>& removed) {
+		std::size_t out = 0;
+		for (std::size_t i = 0; i < values.size(); ++i) {
+			if (!removed[i]) {
+				values[out++] = values[i];
+			}
+		}
+		values.resize(out);
+	}
+}
+
+const TransformHierarchy::NodeId TransformHierarchy::none;
+
+TransformHierarchy::TransformHierarchy() : pass(0), orderDirty(false), lastRecomputed(0) {}
+
+TransformHierarchy::NodeId TransformHierarchy::create(NodeId parent) {
+	NodeId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = static_cast<NodeId>(idToIndex.size());
+		idToIndex.push_back(none);
+	}
+
+	// Appending keeps parents in front of their children; breadth-first order is restored lazily
+	std::uint32_t index = static_cast<std::uint32_t>(parents.size());
+	idToIndex[id] = index;
+	parents.push_back(isAlive(parent) ? idToIndex[parent] : none);
+	positions.push_back(sf::Vector2f(0.f, 0.f));
+	rotations.push_back(0.f);
+	scales.push_back(sf::Vector2f(1.f, 1.f));
+	origins.push_back(sf::Vector2f(0.f, 0.f));
+	worlds.push_back(Affine2D());
+	firstChildren.push_back(0);
+	childCounts.push_back(0);
+	localDirty.push_back(0);
+	updatedIn.push_back(0);
+	indexToId.push_back(id);
+	markDirty(index);
+	if (parents[index] != none) {
+		orderDirty = true;
+	}
+	return id;
+}
+
+void TransformHierarchy::destroy(NodeId node) {
+	if (!isAlive(node)) {
+		return;
+	}
+
+	// After a re-parent a descendant may still sit in front of its ancestor
+	if (orderDirty) {
+		rebuildOrder();
+	}
+	// Parents come before children, so one forward pass finds the whole subtree
+	const std::size_t count = parents.size();
+	std::vector<std::uint8_t> removed(count, 0);
+	removed[idToIndex[node]] = 1;
+	for (std::size_t i = idToIndex[node] + 1; i < count; ++i) {
+		if (parents[i] != none && removed[parents[i]]) {
+			removed[i] = 1;
+		}
+	}
+
+	std::vector<std::uint32_t> newIndex(count, none);
+	std::uint32_t next = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		if (removed[i]) {
+			idToIndex[indexToId[i]] = none;
+			freeIds.push_back(indexToId[i]);
+		}
+		else {
+			newIndex[i] = next++;
+		}
+	}
+
+	compact(parents, removed);
+	compact(positions, removed);
+	compact(rotations, removed);
+	compact(scales, removed);
+	compact(origins, removed);
+	compact(worlds, removed);
+	compact(firstChildren, removed);
+	compact(childCounts, removed);
+	compact(localDirty, removed);
+	compact(updatedIn, removed);
+	compact(indexToId, removed);
+
+	for (std::uint32_t i = 0; i < parents.size(); ++i) {
+		if (parents[i] != none) {
+			parents[i] = newIndex[parents[i]];
+		}
+		idToIndex[indexToId[i]] = i;
+	}
+	// Child ranges now point at stale indices
+	orderDirty = true;
+}
+
+bool TransformHierarchy::isAlive(NodeId node) const {
+	return node < idToIndex.size() && idToIndex[node] != none;
+}
+
+std::size_t TransformHierarchy::size() const {
+	return parents.size();
+}
+
+void TransformHierarchy::setParent(NodeId node, NodeId parent) {
+	std::uint32_t index = idToIndex[node];
+	std::uint32_t parentIndex = isAlive(parent) ? idToIndex[parent] : none;
+
+	// Refuse to create a cycle
+	for (std::uint32_t ancestor = parentIndex; ancestor != none; ancestor = parents[ancestor]) {
+		if (ancestor == index) {
+			return;
+		}
+	}
+
+	parents[index] = parentIndex;
+	markDirty(index);
+	orderDirty = true;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::getParent(NodeId node) const {
+	std::uint32_t parentIndex = parents[idToIndex[node]];
+	return parentIndex == none ? none : indexToId[parentIndex];
+}
+
+void TransformHierarchy::setPosition(NodeId node, const sf::Vector2f& position) {
+	std::uint32_t index = idToIndex[node];
+	positions[index] = position;
+	markDirty(index);
+}
+
+void TransformHierarchy::move(NodeId node, const sf::Vector2f& offset) {
+	std::uint32_t index = idToIndex[node];
+	positions[index] += offset;
+	markDirty(index);
+}
+
+void TransformHierarchy::setRotation(NodeId node, float angle) {
+	std::uint32_t index = idToIndex[node];
+	angle = std::fmod(angle, 360.f);
+	rotations[index] = angle < 0.f ? angle + 360.f : angle;
+	markDirty(index);
+}
+
+void TransformHierarchy::rotate(NodeId node, float angle) {
+	setRotation(node, rotations[idToIndex[node]] + angle);
+}
+
+void TransformHierarchy::setScale(NodeId node, const sf::Vector2f& factors) {
+	std::uint32_t index = idToIndex[node];
+	scales[index] = factors;
+	markDirty(index);
+}
+
+void TransformHierarchy::scale(NodeId node, const sf::Vector2f& factors) {
+	std::uint32_t index = idToIndex[node];
+	scales[index].x *= factors.x;
+	scales[index].y *= factors.y;
+	markDirty(index);
+}
+
+void TransformHierarchy::setOrigin(NodeId node, const sf::Vector2f& origin) {
+	std::uint32_t index = idToIndex[node];
+	origins[index] = origin;
+	markDirty(index);
+}
+
+const sf::Vector2f& TransformHierarchy::getPosition(NodeId node) const {
+	return positions[idToIndex[node]];
+}
+
+float TransformHierarchy::getRotation(NodeId node) const {
+	return rotations[idToIndex[node]];
+}
+
+const sf::Vector2f& TransformHierarchy::getScale(NodeId node) const {
+	return scales[idToIndex[node]];
+}
+
+const Affine2D& TransformHierarchy::getWorld(NodeId node) {
+	if (orderDirty || !dirtyNodes.empty()) {
+		update();
+	}
+	return worlds[idToIndex[node]];
+}
+
+sf::Transform TransformHierarchy::getWorldTransform(NodeId node) {
+	return getWorld(node).toTransform();
+}
+
+sf::Vector2f TransformHierarchy::getWorldPosition(NodeId node) {
+	const Affine2D& world = getWorld(node);
+	return sf::Vector2f(world.tx, world.ty);
+}
+
+void TransformHierarchy::update() {
+	if (orderDirty) {
+		rebuildOrder();
+	}
+
+	lastRecomputed = 0;
+	if (dirtyNodes.empty()) {
+		return;
+	}
+	++pass;
+
+	const std::size_t count = parents.size();
+	if (dirtyNodes.size() * 8 > count) {
+		// Much of the tree changed; one linear pass beats walking subtrees
+		recomputeAll();
+	}
+	else {
+		// Ancestors have lower indices, so in ascending order a changed node's subtree
+		// is recomputed before any changed descendant is reached, and then skipped
+		dirtyIndices.clear();
+		for (NodeId node : dirtyNodes) {
+			if (isAlive(node)) {
+				dirtyIndices.push_back(idToIndex[node]);
+			}
+		}
+		std::sort(dirtyIndices.begin(), dirtyIndices.end());
+		for (std::uint32_t index : dirtyIndices) {
+			if (updatedIn[index] != pass) {
+				recomputeSubtree(index);
+			}
+		}
+	}
+	dirtyNodes.clear();
+}
+
+std::size_t TransformHierarchy::getLastRecomputedCount() const {
+	return lastRecomputed;
+}
+
+void TransformHierarchy::markDirty(std::uint32_t index) {
+	if (!localDirty[index]) {
+		localDirty[index] = 1;
+		dirtyNodes.push_back(indexToId[index]);
+	}
+}
+
+void TransformHierarchy::recomputeNode(std::uint32_t index) {
+	const std::uint32_t parent = parents[index];
+	Affine2D local = computeLocal(positions[index], rotations[index], scales[index], origins[index]);
+	worlds[index] = parent == none ? local : worlds[parent] * local;
+	localDirty[index] = 0;
+	updatedIn[index] = pass;
+	++lastRecomputed;
+}
+
+void TransformHierarchy::recomputeSubtree(std::uint32_t root) {
+	traversal.clear();
+	traversal.push_back(root);
+	while (!traversal.empty()) {
+		std::uint32_t index = traversal.back();
+		traversal.pop_back();
+		recomputeNode(index);
+		for (std::uint32_t child = firstChildren[index], end = child + childCounts[index]; child < end; ++child) {
+			traversal.push_back(child);
+		}
+	}
+}
+
+void TransformHierarchy::recomputeAll() {
+	const std::uint32_t count = static_cast<std::uint32_t>(parents.size());
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const std::uint32_t parent = parents[i];
+		if (localDirty[i] || (parent != none && updatedIn[parent] == pass)) {
+			recomputeNode(i);
+		}
+	}
+}
+
+void TransformHierarchy::rebuildOrder() {
+	const std::uint32_t count = static_cast<std::uint32_t>(parents.size());
+
+	// Children of every node as contiguous ranges (counting sort by parent)
+	std::vector<std::uint32_t> childStart(count + 1, 0);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (parents[i] != none) {
+			++childStart[parents[i] + 1];
+		}
+	}
+	for (std::uint32_t i = 0; i < count; ++i) {
+		childStart[i + 1] += childStart[i];
+	}
+	std::vector<std::uint32_t> children(childStart[count]);
+	std::vector<std::uint32_t> fill(childStart.begin(), childStart.end() - 1);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (parents[i] != none) {
+			children[fill[parents[i]]++] = i;
+		}
+	}
+
+	// Breadth-first: all roots, then their children level by level
+	std::vector<std::uint32_t> order;
+	order.reserve(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (parents[i] == none) {
+			order.push_back(i);
+		}
+	}
+	for (std::size_t head = 0; head < order.size(); ++head) {
+		std::uint32_t node = order[head];
+		for (std::uint32_t c = childStart[node]; c < childStart[node + 1]; ++c) {
+			order.push_back(children[c]);
+		}
+	}
+
+	std::vector<std::uint32_t> newIndex(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		newIndex[order[i]] = i;
+	}
+
+	permute(parents, order);
+	permute(positions, order);
+	permute(rotations, order);
+	permute(scales, order);
+	permute(origins, order);
+	permute(worlds, order);
+	permute(localDirty, order);
+	permute(updatedIn, order);
+	permute(indexToId, order);
+
+	// Breadth-first order leaves every node's children next to each other
+	std::fill(firstChildren.begin(), firstChildren.end(), 0);
+	std::fill(childCounts.begin(), childCounts.end(), 0);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (parents[i] != none) {
+			parents[i] = newIndex[parents[i]];
+			if (childCounts[parents[i]]++ == 0) {
+				firstChildren[parents[i]] = i;
+			}
+		}
+		idToIndex[indexToId[i]] = i;
+	}
+
+	orderDirty = false;
+}
+
+Affine2D TransformHierarchy::computeLocal(const sf::Vector2f& position, float rotation, const sf::Vector2f& scale, const sf::Vector2f& origin) {
+	// Same composition as sf::Transformable: translate * rotate * scale * -origin
+	float angle = -rotation * pi / 180.f;
+	float cosine = std::cos(angle);
+	float sine = std::sin(angle);
+	float sxc = scale.x * cosine;
+	float syc = scale.y * cosine;
+	float sxs = scale.x * sine;
+	float sys = scale.y * sine;
+
+	Affine2D local;
+	local.a = sxc;
+	local.b = -sxs;
+	local.c = sys;
+	local.d = syc;
+	local.tx = -origin.x * sxc - origin.y * sys + position.x;
+	local.ty = origin.x * sxs - origin.y * syc + position.y;
+	return local;
+}
@@ -0,0 +1,89 @@
+//TransformHierarchy.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Geometry.h"
+
+// Parent/child transforms with local position/rotation/scale per node.
+// Nodes are stored in breadth-first order, so parents come before their children and
+// each node's children are contiguous. update() recomputes world matrices only below
+// nodes that changed; when many changed it does one forward pass over the packed arrays.
+class TransformHierarchy {
+public:
+    typedef std::uint32_t NodeId;
+
+    static const NodeId none = 0xFFFFFFFFu;
+
+private:
+    // Packed node data in breadth-first order
+    std::vector<std::uint32_t> parents;   // packed index of the parent, or none
+    std::vector<sf::Vector2f> positions;
+    std::vector<float> rotations;         // degrees, like sf::Transformable
+    std::vector<sf::Vector2f> scales;
+    std::vector<sf::Vector2f> origins;
+    std::vector<Affine2D> worlds;
+    std::vector<std::uint32_t> firstChildren;
+    std::vector<std::uint32_t> childCounts;
+    std::vector<std::uint8_t> localDirty;
+    // update() pass that last recomputed each node
+    std::vector<std::uint32_t> updatedIn;
+    std::vector<NodeId> indexToId;
+
+    // Stable id -> packed index
+    std::vector<std::uint32_t> idToIndex;
+    std::vector<NodeId> freeIds;
+
+    // Nodes whose local transform changed since the last update()
+    std::vector<NodeId> dirtyNodes;
+    std::vector<std::uint32_t> dirtyIndices;
+    std::vector<std::uint32_t> traversal;
+    std::uint32_t pass;
+    // Set when nodes were added, removed or re-parented
+    bool orderDirty;
+    std::size_t lastRecomputed;
+
+public:
+    TransformHierarchy();
+
+    NodeId create(NodeId parent = none);
+    // Destroy a node together with all of its descendants
+    void destroy(NodeId node);
+    bool isAlive(NodeId node) const;
+    std::size_t size() const;
+
+    // Re-attach a node; its local transform is kept, so its world transform follows the new parent
+    void setParent(NodeId node, NodeId parent);
+    NodeId getParent(NodeId node) const;
+
+    void setPosition(NodeId node, const sf::Vector2f& position);
+    void move(NodeId node, const sf::Vector2f& offset);
+    void setRotation(NodeId node, float angle);
+    void rotate(NodeId node, float angle);
+    void setScale(NodeId node, const sf::Vector2f& factors);
+    void scale(NodeId node, const sf::Vector2f& factors);
+    void setOrigin(NodeId node, const sf::Vector2f& origin);
+
+    const sf::Vector2f& getPosition(NodeId node) const;
+    float getRotation(NodeId node) const;
+    const sf::Vector2f& getScale(NodeId node) const;
+
+    // World matrices; bring pending changes up to date first if there are any
+    const Affine2D& getWorld(NodeId node);
+    sf::Transform getWorldTransform(NodeId node);
+    sf::Vector2f getWorldPosition(NodeId node);
+
+    // Recompute the world matrices of every changed node and its descendants
+    void update();
+    // Number of world matrices the last update() recomputed
+    std::size_t getLastRecomputedCount() const;
+
+private:
+    void markDirty(std::uint32_t index);
+    void recomputeNode(std::uint32_t index);
+    void recomputeSubtree(std::uint32_t root);
+    void recomputeAll();
+    void rebuildOrder();
+    static Affine2D computeLocal(const sf::Vector2f& position, float rotation, const sf::Vector2f& scale, const sf::Vector2f& origin);
+};
@@ -0,0 +1,187 @@
+//ViewCuller.cpp
+#include "ViewCuller.h"
+
+#include "Clipping.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float _cellSize) : cellSize(_cellSize > 0.f ? _cellSize : 256.f), liveCount(0), queryStamp(0) {}
+
+void SpatialGrid::insert(std::uint32_t id, const AABB& bounds) {
+	if (id >= entries.size()) {
+		Entry empty = {};
+		entries.resize(id + 1, empty);
+		queryStamps.resize(id + 1, 0);
+	}
+	if (entries[id].alive) {
+		update(id, bounds);
+		return;
+	}
+
+	Entry& entry = entries[id];
+	entry.bounds = bounds;
+	entry.minCellX = toCell(bounds.min.x);
+	entry.minCellY = toCell(bounds.min.y);
+	entry.maxCellX = toCell(bounds.max.x);
+	entry.maxCellY = toCell(bounds.max.y);
+	entry.alive = true;
+	addToCells(id, entry);
+	++liveCount;
+}
+
+void SpatialGrid::update(std::uint32_t id, const AABB& bounds) {
+	if (!contains(id)) {
+		insert(id, bounds);
+		return;
+	}
+
+	Entry& entry = entries[id];
+	entry.bounds = bounds;
+	int minCellX = toCell(bounds.min.x);
+	int minCellY = toCell(bounds.min.y);
+	int maxCellX = toCell(bounds.max.x);
+	int maxCellY = toCell(bounds.max.y);
+	// Most moves stay within the same cells
+	if (minCellX == entry.minCellX && minCellY == entry.minCellY && maxCellX == entry.maxCellX && maxCellY == entry.maxCellY) {
+		return;
+	}
+
+	removeFromCells(id, entry);
+	entry.minCellX = minCellX;
+	entry.minCellY = minCellY;
+	entry.maxCellX = maxCellX;
+	entry.maxCellY = maxCellY;
+	addToCells(id, entry);
+}
+
+void SpatialGrid::remove(std::uint32_t id) {
+	if (!contains(id)) {
+		return;
+	}
+	removeFromCells(id, entries[id]);
+	entries[id].alive = false;
+	--liveCount;
+}
+
+bool SpatialGrid::contains(std::uint32_t id) const {
+	return id < entries.size() && entries[id].alive;
+}
+
+std::size_t SpatialGrid::size() const {
+	return liveCount;
+}
+
+void SpatialGrid::clear() {
+	cells.clear();
+	entries.clear();
+	queryStamps.clear();
+	liveCount = 0;
+}
+
+void SpatialGrid::query(const AABB& area, std::vector<std::uint32_t>& result) const {
+	if (++queryStamp == 0) {
+		// The stamp wrapped around; old stamps could now match
+		std::fill(queryStamps.begin(), queryStamps.end(), 0);
+		queryStamp = 1;
+	}
+
+	int minCellX = toCell(area.min.x);
+	int minCellY = toCell(area.min.y);
+	int maxCellX = toCell(area.max.x);
+	int maxCellY = toCell(area.max.y);
+	for (int cellY = minCellY; cellY <= maxCellY; ++cellY) {
+		for (int cellX = minCellX; cellX <= maxCellX; ++cellX) {
+			auto cell = cells.find(cellKey(cellX, cellY));
+			if (cell == cells.end()) {
+				continue;
+			}
+			for (std::uint32_t id : cell->second) {
+				if (queryStamps[id] == queryStamp) {
+					continue;
+				}
+				queryStamps[id] = queryStamp;
+				if (entries[id].bounds.overlaps(area)) {
+					result.push_back(id);
+				}
+			}
+		}
+	}
+}
+
+std::uint64_t SpatialGrid::cellKey(int cellX, int cellY) {
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cellX)) << 32) | static_cast<std::uint32_t>(cellY);
+}
+
+int SpatialGrid::toCell(float coordinate) const {
+	return static_cast<int>(std::floor(coordinate / cellSize));
+}
+
+void SpatialGrid::addToCells(std::uint32_t id, const Entry& entry) {
+	for (int cellY = entry.minCellY; cellY <= entry.maxCellY; ++cellY) {
+		for (int cellX = entry.minCellX; cellX <= entry.maxCellX; ++cellX) {
+			cells[cellKey(cellX, cellY)].push_back(id);
+		}
+	}
+}
+
+void SpatialGrid::removeFromCells(std::uint32_t id, const Entry& entry) {
+	for (int cellY = entry.minCellY; cellY <= entry.maxCellY; ++cellY) {
+		for (int cellX = entry.minCellX; cellX <= entry.maxCellX; ++cellX) {
+			auto cell = cells.find(cellKey(cellX, cellY));
+			if (cell == cells.end()) {
+				continue;
+			}
+			std::vector<std::uint32_t>& ids = cell->second;
+			auto found = std::find(ids.begin(), ids.end(), id);
+			if (found != ids.end()) {
+				*found = ids.back();
+				ids.pop_back();
+			}
+			if (ids.empty()) {
+				cells.erase(cell);
+			}
+		}
+	}
+}
+
+ViewCuller::ViewCuller() : drawnCount(0), culledCount(0) {}
+
+void ViewCuller::beginFrame(const sf::View& view, float margin) {
+	viewBounds = computeViewBounds(view, margin);
+	drawnCount = 0;
+	culledCount = 0;
+}
+
+bool ViewCuller::isVisible(const AABB& bounds) {
+	if (viewBounds.overlaps(bounds)) {
+		++drawnCount;
+		return true;
+	}
+	++culledCount;
+	return false;
+}
+
+bool ViewCuller::isVisible(const sf::FloatRect& bounds) {
+	return isVisible(AABB::fromRect(bounds));
+}
+
+void ViewCuller::collectVisible(const SpatialGrid& grid, std::vector<std::uint32_t>& result) {
+	std::size_t before = result.size();
+	grid.query(viewBounds, result);
+	std::size_t visible = result.size() - before;
+	drawnCount += visible;
+	culledCount += grid.size() - visible;
+}
+
+const AABB& ViewCuller::getViewBounds() const {
+	return viewBounds;
+}
+
+std::size_t ViewCuller::getDrawnCount() const {
+	return drawnCount;
+}
+
+std::size_t ViewCuller::getCulledCount() const {
+	return culledCount;
+}
@@ -0,0 +1,75 @@
+//ViewCuller.h
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Geometry.h"
+
+// Uniform grid over world space. Objects are binned into every cell their bounds touch,
+// so a rectangle query only looks at objects near it. Moving an object only re-bins it
+// when it crosses into different cells.
+class SpatialGrid {
+private:
+    struct Entry {
+        AABB bounds;
+        int minCellX, minCellY, maxCellX, maxCellY;
+        bool alive;
+    };
+
+    float cellSize;
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells;
+    std::vector<Entry> entries;
+    std::size_t liveCount;
+    // Per-object stamp of the last query that reported it, to skip duplicates
+    mutable std::vector<std::uint32_t> queryStamps;
+    mutable std::uint32_t queryStamp;
+
+public:
+    explicit SpatialGrid(float _cellSize = 256.f);
+
+    // Objects are identified by small non-negative ids chosen by the caller (e.g. pool slot indices)
+    void insert(std::uint32_t id, const AABB& bounds);
+    void update(std::uint32_t id, const AABB& bounds);
+    void remove(std::uint32_t id);
+    bool contains(std::uint32_t id) const;
+    std::size_t size() const;
+    void clear();
+
+    // Append the ids of all objects whose bounds overlap 'area'
+    void query(const AABB& area, std::vector<std::uint32_t>& result) const;
+
+private:
+    static std::uint64_t cellKey(int cellX, int cellY);
+    int toCell(float coordinate) const;
+    void addToCells(std::uint32_t id, const Entry& entry);
+    void removeFromCells(std::uint32_t id, const Entry& entry);
+};
+
+// Decides per frame which objects can be seen through a view, and counts how many
+// were drawn and culled. Test objects one by one, or query a SpatialGrid when there
+// are many of them.
+class ViewCuller {
+private:
+    AABB viewBounds;
+    std::size_t drawnCount;
+    std::size_t culledCount;
+
+public:
+    ViewCuller();
+
+    // Start a frame: take the visible area from the view and reset the counters.
+    // The margin grows the area, e.g. to keep objects that are about to scroll in.
+    void beginFrame(const sf::View& view, float margin = 0.f);
+
+    bool isVisible(const AABB& bounds);
+    bool isVisible(const sf::FloatRect& bounds);
+    // Append the ids of the grid's visible objects; everything else in the grid counts as culled
+    void collectVisible(const SpatialGrid& grid, std::vector<std::uint32_t>& result);
+
+    const AABB& getViewBounds() const;
+    std::size_t getDrawnCount() const;
+    std::size_t getCulledCount() const;
+};
@@ -0,0 +1,185 @@
+//WorldStreamer.cpp
+#include "WorldStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+	ChunkCoord fromKey(std::uint64_t key) {
+		ChunkCoord coord = { static_cast<int>(static_cast<std::int32_t>(key >> 32)), static_cast<int>(static_cast<std::int32_t>(key & 0xFFFFFFFFu)) };
+		return coord;
+	}
+
+	int chunkDistance(ChunkCoord a, ChunkCoord b) {
+		return std::max(std::abs(a.x - b.x), std::abs(a.y - b.y));
+	}
+}
+
+WorldStreamer::WorldStreamer(float _chunkSize, Loader _loader, int _loadRadius, int _unloadRadius)
+	: chunkSize(_chunkSize), loadRadius(std::max(_loadRadius, 0)), unloadRadius(std::max(_unloadRadius, std::max(_loadRadius, 0))),
+	arrivalBudget(2), loader(_loader), deterministic(false), stopping(false) {
+	worker = std::thread(&WorldStreamer::workerLoop, this);
+}
+
+WorldStreamer::~WorldStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		requests.clear();
+	}
+	wakeUp.notify_one();
+	worker.join();
+}
+
+void WorldStreamer::setArrivalBudget(std::size_t budget) {
+	arrivalBudget = std::max<std::size_t>(budget, 1);
+}
+
+void WorldStreamer::setDeterministic(bool enabled) {
+	deterministic = enabled;
+}
+
+bool WorldStreamer::isDeterministic() const {
+	return deterministic;
+}
+
+void WorldStreamer::update(sf::Vector2f focus) {
+	const ChunkCoord center = toChunk(focus);
+
+	// Release what drifted past the unload radius; requests still queued are withdrawn
+	std::vector<std::uint64_t> withdrawn;
+	for (auto it = chunks.begin(); it != chunks.end();) {
+		const ChunkCoord coord = fromKey(it->first);
+		if (chunkDistance(coord, center) <= unloadRadius) {
+			++it;
+			continue;
+		}
+		if (it->second == Loaded) {
+			released.push_back(coord);
+		}
+		else {
+			withdrawn.push_back(it->first);
+		}
+		it = chunks.erase(it);
+	}
+
+	missing.clear();
+	for (int y = center.y - loadRadius; y <= center.y + loadRadius; ++y) {
+		for (int x = center.x - loadRadius; x <= center.x + loadRadius; ++x) {
+			const ChunkCoord coord = { x, y };
+			if (chunks.find(chunkKey(coord)) == chunks.end()) {
+				missing.push_back(coord);
+			}
+		}
+	}
+	std::sort(missing.begin(), missing.end(), [&center](ChunkCoord a, ChunkCoord b) {
+		return chunkDistance(a, center) < chunkDistance(b, center);
+	});
+	if (deterministic) {
+		for (const ChunkCoord& coord : missing) {
+			chunks[chunkKey(coord)] = Loaded;
+			StreamedChunk chunk;
+			chunk.coord = coord;
+			loader(coord, chunk.instances);
+			arrived.push_back(std::move(chunk));
+		}
+		missing.clear();
+	}
+	for (const ChunkCoord& coord : missing) {
+		chunks[chunkKey(coord)] = Requested;
+	}
+
+	std::size_t taken = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!withdrawn.empty()) {
+			requests.erase(std::remove_if(requests.begin(), requests.end(), [&withdrawn](ChunkCoord coord) {
+				return std::find(withdrawn.begin(), withdrawn.end(), chunkKey(coord)) != withdrawn.end();
+			}), requests.end());
+		}
+		requests.insert(requests.end(), missing.begin(), missing.end());
+		while (!finished.empty() && taken < arrivalBudget) {
+			arrived.push_back(std::move(finished.front()));
+			finished.pop_front();
+			++taken;
+		}
+	}
+	if (!missing.empty()) {
+		wakeUp.notify_one();
+	}
+
+	// A load that finished after its chunk was released (or loaded again) is dropped here
+	for (std::size_t i = arrived.size() - taken; i < arrived.size();) {
+		auto found = chunks.find(chunkKey(arrived[i].coord));
+		if (found != chunks.end() && found->second == Requested) {
+			found->second = Loaded;
+			++i;
+		}
+		else {
+			arrived.erase(arrived.begin() + i);
+		}
+	}
+}
+
+bool WorldStreamer::popLoaded(StreamedChunk& chunk) {
+	if (arrived.empty()) {
+		return false;
+	}
+	chunk = std::move(arrived.front());
+	arrived.pop_front();
+	return true;
+}
+
+bool WorldStreamer::popReleased(ChunkCoord& coord) {
+	if (released.empty()) {
+		return false;
+	}
+	coord = released.front();
+	released.pop_front();
+	return true;
+}
+
+ChunkCoord WorldStreamer::toChunk(sf::Vector2f position) const {
+	ChunkCoord coord = { static_cast<int>(std::floor(position.x / chunkSize)), static_cast<int>(std::floor(position.y / chunkSize)) };
+	return coord;
+}
+
+float WorldStreamer::getChunkSize() const {
+	return chunkSize;
+}
+
+std::size_t WorldStreamer::getLoadedCount() const {
+	return static_cast<std::size_t>(std::count_if(chunks.begin(), chunks.end(), [](const std::pair<const std::uint64_t, ChunkState>& chunk) {
+		return chunk.second == Loaded;
+	}));
+}
+
+std::size_t WorldStreamer::getPendingCount() const {
+	return chunks.size() - getLoadedCount();
+}
+
+std::uint64_t WorldStreamer::chunkKey(ChunkCoord coord) {
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(coord.x)) << 32) | static_cast<std::uint32_t>(coord.y);
+}
+
+void WorldStreamer::workerLoop() {
+	for (;;) {
+		ChunkCoord coord;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this]() { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			coord = requests.front();
+			requests.pop_front();
+		}
+
+		StreamedChunk chunk;
+		chunk.coord = coord;
+		loader(coord, chunk.instances);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.push_back(std::move(chunk));
+	}
+}
@@ -0,0 +1,94 @@
+//WorldStreamer.h
+#pragma once
+
+#include <SFML/System.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Scene.h"
+
+struct ChunkCoord {
+    int x;
+    int y;
+};
+
+// Entities of one world chunk, as produced by the loader
+struct StreamedChunk {
+    ChunkCoord coord;
+    std::vector<SceneInstance> instances;
+};
+
+// Keeps the square world chunks around a focus point loaded. Chunks within the load radius
+// are requested nearest first and built by the loader on a background thread; chunks are only
+// released once they are beyond the larger unload radius, so walking back and forth over a
+// chunk border does not reload anything. At most (2 * unloadRadius + 1)^2 chunks are ever
+// loaded, however large the world is, and each update hands over a bounded number of new
+// chunks so arrivals are spread over frames.
+class WorldStreamer {
+public:
+    // Called on the background thread; must only read data that stays unchanged while streaming
+    typedef std::function<void(ChunkCoord coord, std::vector<SceneInstance>& instances)> Loader;
+
+private:
+    enum ChunkState {
+        Requested,
+        Loaded
+    };
+
+    float chunkSize;
+    int loadRadius;
+    int unloadRadius;
+    std::size_t arrivalBudget;
+    Loader loader;
+    bool deterministic;
+
+    // Main thread only
+    std::unordered_map<std::uint64_t, ChunkState> chunks;
+    std::vector<ChunkCoord> missing;
+    std::deque<StreamedChunk> arrived;
+    std::deque<ChunkCoord> released;
+
+    // Shared with the loader thread
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<ChunkCoord> requests;
+    std::deque<StreamedChunk> finished;
+    bool stopping;
+    std::thread worker;
+
+public:
+    WorldStreamer(float _chunkSize, Loader _loader, int _loadRadius = 1, int _unloadRadius = 2);
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // Chunks handed over per update at most
+    void setArrivalBudget(std::size_t budget);
+    // Deterministic mode loads missing chunks inline in update(), so what is loaded on
+    // which tick never depends on thread timing. Use it for recordings and replays.
+    void setDeterministic(bool enabled);
+    bool isDeterministic() const;
+
+    // Request the chunks around 'focus', release the far ones and take over finished loads
+    void update(sf::Vector2f focus);
+    // Chunks loaded since the last update, to be turned into entities
+    bool popLoaded(StreamedChunk& chunk);
+    // Chunks released since the last update, whose entities should be destroyed
+    bool popReleased(ChunkCoord& coord);
+
+    ChunkCoord toChunk(sf::Vector2f position) const;
+    float getChunkSize() const;
+    std::size_t getLoadedCount() const;
+    std::size_t getPendingCount() const;
+
+    static std::uint64_t chunkKey(ChunkCoord coord);
+
+private:
+    void workerLoop();
+};
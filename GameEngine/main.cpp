@@ -4,12 +4,149 @@
  */
 
 #include <SFML/Graphics.hpp>
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include "CollisionMask.h"
+#include "ObjectPool.h"
+#include "JobSystem.h"
+#include "InputSystem.h"
+#include "Animation.h"
+#include "Parallax.h"
+#include "ViewCuller.h"
+#include "AssetArchive.h"
+#include "Scene.h"
+#include "ParticleSystem.h"
+#include "TileMap.h"
+#include "Camera.h"
+#include "WorldStreamer.h"
+#include "Physics.h"
+#include "Framebuffer.h"
+#include "RleSprite.h"
+#include "DrawQueue.h"
+#include "PostProcess.h"
 
  // =====================================
+ //             Assets
+ // =====================================
+
+// Files the game loads; "--pack <archive>" bakes them into one pre-decoded archive
+const char* const imageAssets[] = { "asd.jpg", "Cowboy4_walk without gun_0.png", "Cowboy4_walk without gun_1.png",
+    "Cowboy4_walk without gun_2.png", "Cowboy4_jump without gun_0.png" };
+const char* const fontAsset = "arial.ttf";
+const char* const defaultArchive = "assets.pak";
+
+/**
+ * @brief Loads a texture from the archive, or decodes the loose file if the archive does not have it.
+ * @return True if the texture was loaded either way.
+ */
+bool loadTexture(const AssetArchive& assets, const std::string& name, sf::Texture& texture) {
+    return assets.loadTexture(name, texture) || texture.loadFromFile(name);
+}
+
+/**
+ * @brief Loads a font from the archive, or from the loose file if the archive does not have it.
+ * @return True if the font was loaded either way.
+ */
+bool loadFont(const AssetArchive& assets, const std::string& name, sf::Font& font) {
+    return assets.loadFont(name, font) || font.loadFromFile(name);
+}
+
+/**
+ * @brief Runs the post-processing chain over a finished RGBA8 software frame.
+ */
+void postProcessFrame(PostProcessChain& chain, Framebuffer& frame, JobSystem& jobs) {
+    chain.apply(frame, &jobs);
+}
+
+/**
+ * @brief The effects work on RGBA8 pixels, so frames in the compact formats are left as they are.
+ */
+template <typename Format>
+void postProcessFrame(PostProcessChain&, BasicFramebuffer<Format>&, JobSystem&) {
+}
+
+/**
+ * @brief Draws the queued commands into a software frame and uploads it.
+ * @param toggleOverdraw Whether to switch the overdraw heatmap on or off first.
+ * @return Pixels written per screen pixel.
+ */
+template <typename Format>
+float renderSoftwareFrame(DrawQueue& queue, BasicFramebuffer<Format>& frame, bool toggleOverdraw,
+    PostProcessChain& postProcess, JobSystem& jobs, sf::Texture& texture) {
+    if (toggleOverdraw) {
+        frame.setOverdrawCounting(!frame.isOverdrawCounting());
+    }
+    frame.resetPixelsWritten();
+    queue.flush(frame, sf::Color::Black);
+    const float overdraw = static_cast<float>(frame.getPixelsWritten()) / (frame.getWidth() * frame.getHeight());
+    // The heatmap replaces the frame anyway
+    if (!frame.isOverdrawCounting()) {
+        postProcessFrame(postProcess, frame, jobs);
+    }
+    frame.showOverdraw();
+    frame.present(texture);
+    return overdraw;
+}
+
+/**
+ * @brief Decodes every asset the game uses and writes them into one archive.
+ * @return True if every asset was packed and the archive was written.
+ */
+bool packAssets(const std::string& path) {
+    AssetPacker packer;
+    bool complete = true;
+    for (const char* image : imageAssets) {
+        if (!packer.addImage(image, image)) {
+            std::cerr << "Failed to pack " << image << std::endl;
+            complete = false;
+        }
+    }
+    if (!packer.addFile(fontAsset, fontAsset, ArchiveFont)) {
+        std::cerr << "Failed to pack " << fontAsset << std::endl;
+        complete = false;
+    }
+    return complete && packer.write(path);
+}
+
+/**
+ * @brief Writes a level for "--scene": 'obstacleCount' circles 300 pixels apart along the
+ *        run, at the heights the respawning circle uses, the same on every run.
+ * @return True if the scene file was written.
+ */
+bool writeObstacleScene(const std::string& path, std::size_t obstacleCount) {
+    SceneWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    const std::size_t batchSize = 256;
+    SceneInstance batch[batchSize];
+    std::size_t batched = 0;
+    std::uint32_t seed = 1;
+    for (std::size_t i = 0; i < obstacleCount; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        SceneInstance& instance = batch[batched++];
+        instance.kind = SceneCircle;
+        instance.color = sf::Color::White.toInteger();
+        instance.position = Vec2(800.f + 300.f * i, static_cast<float>(100 + (seed >> 16) % 301));
+        instance.size = Vec2(20.f, 20.f);
+        instance.rotation = 0.f;
+        instance.reserved = 0;
+        if (batched == batchSize || i + 1 == obstacleCount) {
+            writer.writeInstances(batch, batched);
+            batched = 0;
+        }
+    }
+    return writer.close();
+}
+
+// =====================================
  //             GameObject Hierarchy
  // =====================================
 
@@ -38,12 +175,41 @@ public:
  * @brief Virtual base class for objects that can be drawn on the screen.
  */
 class DrawableObject : public virtual GameObject {
+private:
+    mutable sf::FloatRect bounds;
+    mutable bool boundsValid;
+
 public:
+    DrawableObject() : boundsValid(false) {}
     /**
      * @brief Pure virtual method to draw the object on the screen.
      * @param window The SFML render window.
      */
     virtual void draw(sf::RenderWindow& window) = 0; // Pure virtual method
+    /**
+     * @brief Gets the area the object covers on screen, recomputed only after it changed.
+     * @return The cached bounds.
+     */
+    const sf::FloatRect& getBounds() const {
+        if (!boundsValid) {
+            bounds = computeBounds();
+            boundsValid = true;
+        }
+        return bounds;
+    }
+
+protected:
+    /**
+     * @brief Pure virtual method to compute the object's current bounds.
+     * @return The area the object covers on screen.
+     */
+    virtual sf::FloatRect computeBounds() const = 0;
+    /**
+     * @brief Marks the cached bounds as stale; call after anything that moves or resizes the object.
+     */
+    void invalidateBounds() {
+        boundsValid = false;
+    }
 };
 /**
  * @brief Virtual base class for objects that can be transformed.
@@ -58,12 +224,15 @@ public:
     virtual void translate(float x, float y) = 0;
     /**
      * @brief Pure virtual method to rotate the object.
+     * @param angle The rotation in degrees, clockwise.
      */
-    virtual void rotate() = 0;
+    virtual void rotate(float angle) = 0;
     /**
      * @brief Pure virtual method to scale the object.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
      */
-    virtual void scale() = 0;
+    virtual void scale(float factorX, float factorY) = 0;
 };
 /**
  * @brief Virtual base class for objects with a specific shape.
@@ -83,12 +252,15 @@ public:
     virtual void translate(float x, float y) = 0;
     /**
      * @brief Pure virtual method to rotate the object.
+     * @param angle The rotation in degrees, clockwise.
      */
-    virtual void rotate() = 0; 
+    virtual void rotate(float angle) = 0;
     /**
      * @brief Pure virtual method to scale the object.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
      */
-    virtual void scale() = 0; 
+    virtual void scale(float factorX, float factorY) = 0;
 };
 // =====================================
 //           Concrete Shape Classes
@@ -116,12 +288,44 @@ public:
     virtual void translate(float dx, float dy) override {
         x += dx;
         y += dy;
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a single point.
+     * @brief A point rotated about itself does not change.
+     */
+    virtual void rotate(float) override {
+    }
+    /**
+     * @brief Rotates the point about a pivot.
+     * @param angle The rotation in degrees, clockwise.
+     * @param pivotX The x-coordinate of the pivot.
+     * @param pivotY The y-coordinate of the pivot.
+     */
+    void rotateAround(float angle, float pivotX, float pivotY) {
+        sf::Transform rotation;
+        rotation.rotate(angle, pivotX, pivotY);
+        sf::Vector2f rotated = rotation.transformPoint(x, y);
+        x = rotated.x;
+        y = rotated.y;
+        invalidateBounds();
+    }
+    /**
+     * @brief Scales the point's distance from a pivot.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
+     * @param pivotX The x-coordinate of the pivot.
+     * @param pivotY The y-coordinate of the pivot.
      */
-    virtual void rotate() override {
-        // Rotation logic for a point (not implemented for a single point)
+    void scaleAround(float factorX, float factorY, float pivotX, float pivotY) {
+        x = pivotX + (x - pivotX) * factorX;
+        y = pivotY + (y - pivotY) * factorY;
+        invalidateBounds();
+    }
+    float getX() const {
+        return x;
+    }
+    float getY() const {
+        return y;
     }
     /**
      * @brief Not implemented for a single point.
@@ -130,10 +334,9 @@ public:
 
     }
     /**
-     * @brief Not implemented for a single point.
+     * @brief A point scaled about itself does not change.
      */
-    virtual void scale() override {
-        // Scaling logic for a point (not implemented for a single point)
+    virtual void scale(float, float) override {
     }
 
     /**
@@ -142,6 +345,11 @@ public:
     virtual void draw(sf::RenderWindow& window) override {
         // Draw logic for a point
     }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        return sf::FloatRect(x, y, 0.f, 0.f);
+    }
 };
 
 class LineSegment : public ShapeObject {
@@ -167,19 +375,30 @@ public:
     virtual void translate(float dx, float dy) override {
         start.translate(dx, dy);
         end.translate(dx, dy);
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a line segment.
+     * @brief Rotates the line segment about its midpoint.
+     * @param angle The rotation in degrees, clockwise.
      */
-    virtual void rotate() override {
-        // Rotation logic for a line segment (not implemented for a line segment)
+    virtual void rotate(float angle) override {
+        float midX = (start.getX() + end.getX()) / 2.f;
+        float midY = (start.getY() + end.getY()) / 2.f;
+        start.rotateAround(angle, midX, midY);
+        end.rotateAround(angle, midX, midY);
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a line segment.
+     * @brief Scales the line segment about its midpoint.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
      */
-
-    virtual void scale() override {
-        // Scaling logic for a line segment (not implemented for a line segment)
+    virtual void scale(float factorX, float factorY) override {
+        float midX = (start.getX() + end.getX()) / 2.f;
+        float midY = (start.getY() + end.getY()) / 2.f;
+        start.scaleAround(factorX, factorY, midX, midY);
+        end.scaleAround(factorX, factorY, midX, midY);
+        invalidateBounds();
     }
     /**
      * @brief Draws the line segment on the screen.
@@ -188,6 +407,13 @@ public:
     virtual void draw(sf::RenderWindow& window) override {
         // Draw logic for a line segment
     }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        float left = std::min(start.getX(), end.getX());
+        float top = std::min(start.getY(), end.getY());
+        return sf::FloatRect(left, top, std::max(start.getX(), end.getX()) - left, std::max(start.getY(), end.getY()) - top);
+    }
 };
 // ... (Other shape classes, Circle, Rectangle, etc.)
 
@@ -235,7 +461,11 @@ public:
  */
 class GroundObject : public DrawableObject {
 private:
-    sf::RectangleShape ground;
+    static const unsigned tileSize = 20;
+    sf::Texture tileset;
+    TileMap tiles;
+    // The atlas tiles run-length encoded for the software renderer
+    RleSprite tileSprites[2];
 
 public:
     /**
@@ -244,16 +474,57 @@ public:
      * @param height The height of the ground.
      */
     GroundObject(float width, float height) {
-        ground.setSize(sf::Vector2f(width, height));
-        ground.setPosition(0, 600 - height); // Adjust the position as needed
-        ground.setFillColor(sf::Color::Color(105, 151, 61));
+        // Two generated tiles: grass with a lighter top edge, and plain soil below it
+        sf::Image atlas;
+        atlas.create(tileSize * 2, tileSize, sf::Color(105, 151, 61));
+        for (unsigned y = 0; y < 4; ++y) {
+            for (unsigned x = 0; x < tileSize; ++x) {
+                atlas.setPixel(x, y, sf::Color(130, 180, 80));
+            }
+        }
+        tileset.loadFromImage(atlas);
+        for (unsigned i = 0; i < 2; ++i) {
+            tileSprites[i].encode(atlas.getPixelsPtr() + i * tileSize * 4, tileSize, tileSize, tileSize * 2);
+        }
+
+        const unsigned columns = static_cast<unsigned>(std::ceil(width / tileSize));
+        const unsigned rows = static_cast<unsigned>(std::ceil(height / tileSize));
+        tiles.create(columns, rows, static_cast<float>(tileSize));
+        tiles.setTileset(tileset, tileSize);
+        tiles.fill(0, 0, columns, 1, 1);
+        tiles.fill(0, 1, columns, rows - 1, 2);
+        tiles.setPosition(0, 600 - height); // Adjust the position as needed
     }
     /**
      * @brief Draws the ground on the screen.
      * @param window The SFML render window.
      */
     virtual void draw(sf::RenderWindow& window) override {
-        window.draw(ground);
+        window.draw(tiles);
+    }
+    /**
+     * @brief Queues the tiles under the view for the software renderer.
+     * @param queue The draw queue of a framebuffer covering the view.
+     * @param viewOrigin The world position of the framebuffer's top-left pixel.
+     * @param frameSize The size of the framebuffer.
+     */
+    void draw(DrawQueue& queue, const sf::Vector2i& viewOrigin, const sf::Vector2u& frameSize) {
+        const sf::Vector2f& position = tiles.getPosition();
+        const int left = static_cast<int>(position.x) - viewOrigin.x;
+        const int top = static_cast<int>(position.y) - viewOrigin.y;
+        const int size = static_cast<int>(tileSize);
+        const int firstColumn = std::max(-left / size, 0);
+        const int lastColumn = std::min((static_cast<int>(frameSize.x) - left) / size, static_cast<int>(tiles.getWidth()) - 1);
+        const int firstRow = std::max(-top / size, 0);
+        const int lastRow = std::min((static_cast<int>(frameSize.y) - top) / size, static_cast<int>(tiles.getHeight()) - 1);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                const TileMap::Tile tile = tiles.getTile(column, row);
+                if (tile != TileMap::emptyTile && tile <= 2) {
+                    queue.drawSprite(tileSprites[tile - 1], static_cast<float>(left + column * size), static_cast<float>(top + row * size));
+                }
+            }
+        }
     }
     /**
      * @brief Updates the ground object.
@@ -261,6 +532,20 @@ public:
     virtual void update() override {
         // Add any update logic specific to the ground if needed
     }
+    /**
+     * @brief Gets the tile map the ground is drawn from, e.g. to dig holes into it.
+     * @return The tile map; edits only rebuild the chunks they touch.
+     */
+    TileMap& getTiles() {
+        invalidateBounds();
+        return tiles;
+    }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        return tiles.getTransform().transformRect(sf::FloatRect(0.f, 0.f,
+            tiles.getWidth() * tiles.getTileSize(), tiles.getHeight() * tiles.getTileSize()));
+    }
 };
 
 
@@ -268,6 +553,21 @@ public:
 //           Game-Specific Classes
 // =====================================
 
+/**
+ * @brief Speeds of game objects are given in pixels per frame at this frame rate.
+ */
+const float referenceFrameRate = 60.f;
+
+/**
+ * @brief Physics collision categories. The player only collides with the level; touching an obstacle is
+ * decided by the pixel masks instead, so physics must not push the two apart first.
+ */
+enum CollisionCategory {
+    WorldCategory = 1,
+    PlayerCategory = 2,
+    ObstacleCategory = 4
+};
+
 /**
  * @brief Represents a circle in the game with movement logic.
  */
@@ -276,20 +576,46 @@ private:
     sf::CircleShape shape;
     float speed;
     sf::Clock clock;
+    const CollisionMask* collisionMask;
+    PhysicsWorld& physics;
+    PhysicsWorld::BodyId body;
 
 public:
     /**
      * @brief Constructor for Circle.
+     * @param physics The physics world the circle's body lives in; must outlive the circle.
      * @param radius The radius of the circle.
      * @param x The x-coordinate of the circle's position.
      * @param y The y-coordinate of the circle's position.
      * @param speed The speed of the circle's movement.
      */
 
-    Circle(float radius, float x, float y, float speed) : speed(speed) {
+    Circle(PhysicsWorld& physics, float radius, float x, float y, float speed)
+        : speed(speed), collisionMask(&CollisionMask::sharedCircle(radius)), physics(physics) {
         shape.setRadius(radius);
         shape.setFillColor(sf::Color::Black);
         shape.setPosition(x, y);
+
+        // Obstacles float at their height and bounce off each other and the level
+        BodyDefinition definition;
+        definition.shape = BodyCircle;
+        definition.radius = radius;
+        definition.position = Vec2(x + radius, y + radius);
+        definition.velocity = Vec2(-speed * referenceFrameRate, 0.f);
+        definition.gravityScale = 0.f;
+        definition.restitution = 0.8f;
+        definition.damping = 1.f;
+        definition.category = ObstacleCategory;
+        definition.collidesWith = WorldCategory | ObstacleCategory;
+        body = physics.createBody(definition);
+    }
+    Circle(const Circle&) = delete;
+    Circle& operator=(const Circle&) = delete;
+    /**
+     * @brief Destructor for Circle. Removes the circle's body from the physics world.
+     */
+    ~Circle() {
+        physics.destroyBody(body);
     }
     /**
      * @brief Getter method for the x-coordinate of the circle's position.
@@ -312,6 +638,9 @@ public:
      */
     void reset(float x, float y) {
         shape.setPosition(x, y);
+        physics.setPosition(body, Vec2(x + getRadius(), y + getRadius()));
+        physics.setVelocity(body, Vec2(-speed * referenceFrameRate, 0.f));
+        invalidateBounds();
         clock.restart(); // Yeniden balatldnda sreyi sfrla
     }
 
@@ -322,6 +651,15 @@ public:
     virtual void draw(sf::RenderWindow& window) override {
         window.draw(shape);
     }
+    /**
+     * @brief Queues the circle for the software renderer.
+     * @param queue The draw queue of a framebuffer covering the view.
+     * @param viewOrigin The world position of the framebuffer's top-left pixel.
+     */
+    void draw(DrawQueue& queue, const sf::Vector2i& viewOrigin) {
+        const sf::Vector2f& position = shape.getPosition();
+        queue.fillCircle(position.x + getRadius() - viewOrigin.x, position.y + getRadius() - viewOrigin.y, getRadius(), shape.getFillColor());
+    }
 
     /**
      * @brief Translates the circle by a given amount.
@@ -330,31 +668,49 @@ public:
      */
     virtual void translate(float dx, float dy) override {
         shape.move(dx, dy);
+        physics.setPosition(body, physics.getPosition(body) + Vec2(dx, dy));
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a circle.
+     * @brief Rotates the circle's shape.
+     * @param angle The rotation in degrees, clockwise.
      */
-    virtual void rotate() override {
-        // Not implemented for a circle
+    virtual void rotate(float angle) override {
+        shape.rotate(angle);
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a circle.
+     * @brief Scales the circle's shape.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
      */
-    virtual void scale() override {
-        // Not implemented for a circle
+    virtual void scale(float factorX, float factorY) override {
+        shape.scale(factorX, factorY);
+        invalidateBounds();
     }
     /**
-     * @brief Updates the circle's position and checks for reset condition.
+     * @brief Drives the circle left. Touches nothing but the circle's own body, so circles can be updated in parallel.
      */
     virtual void update() override {
-        // Move the circle towards left
-        translate(-speed, 0);
-
-        // If the circle goes off the left side, reset its position
-        if (shape.getPosition().x + getRadius() * 2 < 0 && clock.getElapsedTime().asSeconds() > 3.0f) {
-            float randomY = static_cast<float>(std::rand() % 301 + 100); // Random y between 100 and 400
-            reset(800, randomY);
-        }
+        // Keep the vertical speed a collision may have given it; damping lets it die down
+        const Vec2& velocity = physics.getVelocity(body);
+        physics.setVelocity(body, Vec2(-speed * referenceFrameRate, velocity.y));
+    }
+    /**
+     * @brief Moves the shape to where the physics step left the body.
+     */
+    void syncWithBody() {
+        const Vec2 center = physics.getInterpolatedPosition(body);
+        shape.setPosition(center.x - getRadius(), center.y - getRadius());
+        invalidateBounds();
+    }
+    /**
+     * @brief Checks whether the circle has left the view and should be respawned.
+     * @param viewLeft The world x-coordinate of the view's left edge.
+     * @return True once the circle is fully past the left edge.
+     */
+    bool isOffScreen(float viewLeft) const {
+        return shape.getPosition().x < viewLeft - getRadius();
     }
     /**
      * @brief Sets a new speed for the circle.
@@ -370,6 +726,18 @@ public:
     sf::CircleShape& getShape() {
         return shape;
     }
+    /**
+     * @brief Gets the pixel collision mask of the circle.
+     * @return The mask, anchored at the top-left of the shape's bounds.
+     */
+    const CollisionMask& getCollisionMask() const {
+        return *collisionMask;
+    }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        return shape.getGlobalBounds();
+    }
 };
 
 /**
@@ -378,7 +746,6 @@ public:
 class Rectangle : public ShapeObject {
 private:
     sf::RectangleShape shape;
-    float x, y;
     float speed;
     float rotationSpeed;
 
@@ -393,7 +760,7 @@ public:
      * @param rotationSpeed The speed of the rectangle's rotation.
      */
     Rectangle(float width, float height, float x, float y, float speed, float rotationSpeed)
-        : x(x), y(y), speed(speed), rotationSpeed(rotationSpeed) {
+        : speed(speed), rotationSpeed(rotationSpeed) {
         shape.setSize(sf::Vector2f(width, height));
         shape.setPosition(x, y);
         shape.setFillColor(sf::Color::Red);
@@ -411,31 +778,42 @@ public:
      * @param dy The translation in the y-axis.
      */
     virtual void translate(float dx, float dy) override {
-        x += dx;
-        y += dy;
-        shape.setPosition(x, y);
+        shape.move(dx, dy);
+        invalidateBounds();
     }
     /**
-     * @brief Updates the rectangle's position within boundaries.
+     * @brief Updates the rectangle's position within boundaries and spins it.
      */
     virtual void update() override {
         // Move the rectangle within boundaries
+        float x = shape.getPosition().x;
         if (x < 0 || x + shape.getSize().x > 800) {
             speed = -speed; // Reverse direction
         }
         translate(speed, 0);
+        rotate(rotationSpeed);
     }
     /**
      * @brief Rotates the rectangle.
+     * @param angle The rotation in degrees, clockwise.
      */
-    virtual void rotate() override {
-        shape.rotate(rotationSpeed);
+    virtual void rotate(float angle) override {
+        shape.rotate(angle);
+        invalidateBounds();
     }
     /**
-     * @brief Not implemented for a rectangle.
+     * @brief Scales the rectangle.
+     * @param factorX The scale factor in the x-axis.
+     * @param factorY The scale factor in the y-axis.
      */
-    virtual void scale() override {
-        // Not implemented for a rectangle
+    virtual void scale(float factorX, float factorY) override {
+        shape.scale(factorX, factorY);
+        invalidateBounds();
+    }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        return shape.getGlobalBounds();
     }
 };
 /**
@@ -450,34 +828,51 @@ private:
     sf::Texture textureJumping; // Texture for the jump animation
     float x, y;
     float speed;
-    int currentFrame;
-    int frameCount;
-    float frameDuration;
-    float elapsedTime;
-    bool isJumping;
-    float jumpSpeed;
-    float initialJumpHeight;
     float maxJumpHeight;
-    float jumpHeight;
+    bool isWalking;
     bool isOnGround;
+    // Set by the update that touched down after a jump or fall
+    bool landed;
+    // The player is a box body as large as the idle sprite; gravity and the ground act on it
+    PhysicsWorld& physics;
+    PhysicsWorld::BodyId body;
+    sf::Vector2f bodyHalfSize;
+    // Masks built once per texture at the sprite's scale, looked up by the current texture
+    static const int textureCount = 4;
+    static const char* const textureFiles[textureCount];
+    const sf::Texture* maskTextures[textureCount];
+    CollisionMask collisionMasks[textureCount];
+    // The same textures run-length encoded for the software renderer
+    RleSprite rleSprites[textureCount];
+    // Input for the current tick; the player never reads the keyboard directly
+    const InputSnapshot* input;
+    // Animation states, each mapped to a clip
+    enum AnimationState {
+        Idle,
+        Walk,
+        Jump
+    };
+    AnimationSystem& animations;
+    AnimationStateMachine animationState;
 
 public:
     /**
      * @brief Constructor for Player.
+     * @param animations The animation system that advances the player's animator.
+     * @param physics The physics world the player's body lives in; must outlive the player.
+     * @param assets The archive to take the textures from; loose files are used for anything it lacks.
      * @param x The x-coordinate of the player's position.
      * @param y The y-coordinate of the player's position.
      * @param speed The speed of the player's movement.
      */
-    Player(float x, float y, float speed)
-        : x(x), y(y), speed(speed), currentFrame(0), frameCount(4),
-        frameDuration(0.2f), elapsedTime(0.0f), isJumping(false),
-        jumpSpeed(0.5f), initialJumpHeight(80), maxJumpHeight(200),
-        jumpHeight(0.0f), isOnGround(true) {
+    Player(AnimationSystem& animations, PhysicsWorld& physics, const AssetArchive& assets, float x, float y, float speed)
+        : x(x), y(y), speed(speed), maxJumpHeight(200), isWalking(false), isOnGround(false), landed(false),
+        physics(physics), input(nullptr), animations(animations), animationState(animations, &sprite) {
 
-        if (!textureIdle.loadFromFile("Cowboy4_walk without gun_0.png") ||
-            !textureWalking1.loadFromFile("Cowboy4_walk without gun_2.png") ||
-            !textureWalking2.loadFromFile("Cowboy4_walk without gun_2.png") ||
-            !textureJumping.loadFromFile("Cowboy4_jump without gun_0.png")) {
+        if (!loadTexture(assets, textureFiles[0], textureIdle) ||
+            !loadTexture(assets, textureFiles[1], textureWalking1) ||
+            !loadTexture(assets, textureFiles[2], textureWalking2) ||
+            !loadTexture(assets, textureFiles[3], textureJumping)) {
             std::cerr << "Failed to load player sprites!" << std::endl;
             // Handle failure
         }
@@ -486,6 +881,18 @@ public:
             sprite.setPosition(x, y);
             sprite.setScale(2.5f, 2.5f); // Adjust scale as needed
         }
+        buildCollisionMasks(assets);
+        buildAnimations();
+
+        const sf::FloatRect bounds = sprite.getGlobalBounds();
+        bodyHalfSize = sf::Vector2f(std::max(bounds.width, 1.f) * 0.5f, std::max(bounds.height, 1.f) * 0.5f);
+        BodyDefinition definition;
+        definition.position = Vec2(x + bodyHalfSize.x, y + bodyHalfSize.y);
+        definition.halfExtents = Vec2(bodyHalfSize);
+        definition.friction = 0.f;
+        definition.category = PlayerCategory;
+        definition.collidesWith = WorldCategory;
+        body = physics.createBody(definition);
     }
     /**
      * @brief Draws the player on the screen.
@@ -495,81 +902,153 @@ public:
         window.draw(sprite);
     }
     /**
-     * @brief Updates the player's position based on keyboard input.
+     * @brief Queues the current frame for the software renderer, scaled like the sprite.
+     * @param queue The draw queue of a framebuffer covering the view.
+     * @param viewOrigin The world position of the framebuffer's top-left pixel.
+     */
+    void draw(DrawQueue& queue, const sf::Vector2i& viewOrigin) {
+        const sf::Vector2f& position = sprite.getPosition();
+        const sf::Vector2f& spriteScale = sprite.getScale();
+        queue.drawSprite(getRleSprite(), position.x - viewOrigin.x, position.y - viewOrigin.y, spriteScale.x, spriteScale.y);
+    }
+    /**
+     * @brief Sets the input snapshot the next update() reads.
+     * @param snapshot The snapshot of the current tick; must outlive the update.
+     */
+    void setInput(const InputSnapshot& snapshot) {
+        input = &snapshot;
+    }
+    /**
+     * @brief Sets the player's velocity from the current input snapshot; the physics step moves the player.
      */
     virtual void update() override {
-        // Update player's position based on keyboard input
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left)) {
-            x -= speed;
-            updateAnimation();
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right)) {
-            x += speed;
-            updateAnimation();
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up) && !isJumping && isOnGround) {
-            isJumping = true;
-            isOnGround = false;
-            jumpHeight = 0.0f;
-            sprite.setTexture(textureJumping); // Set jump texture when jumping
-        }
-
-        // Jumping logic with maximum height check
-        if (isJumping) {
-            if (jumpHeight < maxJumpHeight) {
-                y -= jumpSpeed;
-                jumpHeight += jumpSpeed;
-            }
-            else {
-                isJumping = false;
-                jumpHeight = 0.0f;
-                sprite.setTexture(textureIdle); // Set back to idle texture when jump is complete
-            }
+        // Walking sets the horizontal speed directly, so the player stops as soon as the key is released
+        isWalking = false;
+        float direction = 0.f;
+        if (input && input->isKeyDown(sf::Keyboard::Left)) {
+            direction -= 1.f;
+            isWalking = true;
         }
-        else {
-            // Apply gravity when not jumping
-            if (y < 270) {
-                y += jumpSpeed; // Adjust gravity as needed
-            }
-            else {
-                y = 270;
-                isOnGround = true;
-            }
+        if (input && input->isKeyDown(sf::Keyboard::Right)) {
+            direction += 1.f;
+            isWalking = true;
         }
+        Vec2 velocity = physics.getVelocity(body);
+        velocity.x = direction * speed * referenceFrameRate;
+        if (input && input->isKeyDown(sf::Keyboard::Up) && isOnGround) {
+            // The launch speed that gravity brings to rest exactly at the maximum jump height
+            velocity.y = -std::sqrt(2.f * physics.getGravity().y * maxJumpHeight);
+        }
+        physics.setVelocity(body, velocity);
+    }
+    /**
+     * @brief Moves the sprite to where the physics step left the body and picks the animation.
+     */
+    void syncWithBody() {
+        const Vec2 center = physics.getInterpolatedPosition(body);
+        x = center.x - bodyHalfSize.x;
+        y = center.y - bodyHalfSize.y;
+        const bool wasOnGround = isOnGround;
+        isOnGround = physics.isGrounded(body);
+        landed = isOnGround && !wasOnGround;
 
-        // Ensure the player stays within the bounds of the window
-        if (x < 0) {
-            x = 0;
+        // The animation system advances the chosen clip by real time
+        if (!isOnGround) {
+            animationState.setState(Jump);
         }
-        if (x + sprite.getGlobalBounds().width > 800) {
-            x = 800 - sprite.getGlobalBounds().width;
+        else if (isWalking) {
+            animationState.setState(Walk);
         }
-
-        elapsedTime += frameDuration;
-        if (elapsedTime >= frameDuration) {
-            currentFrame = (currentFrame + 1) % frameCount;
-            elapsedTime = 0.0f;
+        else {
+            animationState.setState(Idle);
         }
 
         sprite.setPosition(x, y);
+        // The animation may also swap the texture, so the bounds are recomputed on next use
+        invalidateBounds();
     }
     sf::Sprite& getSprite() {
         return sprite;
     }
+    /**
+     * @brief Tells whether the last update landed the player on the ground.
+     * @return True only for the update that touched down.
+     */
+    bool hasLanded() const {
+        return landed;
+    }
+    /**
+     * @brief Gets the pixel collision mask matching the texture currently shown.
+     * @return The mask, anchored at the sprite's position.
+     */
+    const CollisionMask& getCollisionMask() const {
+        for (int i = 0; i < textureCount; ++i) {
+            if (maskTextures[i] == sprite.getTexture()) {
+                return collisionMasks[i];
+            }
+        }
+        return collisionMasks[0];
+    }
 private:
     /**
-     * @brief Helper function to update walking or jumping animation.
+     * @brief Gets the run-length encoded sprite matching the texture currently shown.
+     * @return The encoded sprite.
      */
-    void updateAnimation() {
-        // Switch between walking frames
-        if (currentFrame % 2 == 0 && !isJumping) {
-            sprite.setTexture(textureWalking1);
+    const RleSprite& getRleSprite() const {
+        for (int i = 0; i < textureCount; ++i) {
+            if (maskTextures[i] == sprite.getTexture()) {
+                return rleSprites[i];
+            }
         }
-        else if (!isJumping) {
-            sprite.setTexture(textureWalking2);
+        return rleSprites[0];
+    }
+    /**
+     * @brief Builds the collision masks of all player textures at the sprite's scale, and their encoded sprites.
+     * @param assets Archived pixels are read directly; otherwise the texture is read back from the GPU.
+     */
+    void buildCollisionMasks(const AssetArchive& assets) {
+        const sf::Texture* textures[textureCount] = { &textureIdle, &textureWalking1, &textureWalking2, &textureJumping };
+        const sf::Vector2f& spriteScale = sprite.getScale();
+        for (int i = 0; i < textureCount; ++i) {
+            maskTextures[i] = textures[i];
+            unsigned width, height;
+            const sf::Uint8* pixels = assets.getPixels(textureFiles[i], width, height);
+            if (pixels) {
+                collisionMasks[i] = CollisionMask::fromPixels(pixels, static_cast<int>(width), static_cast<int>(height), spriteScale.x, spriteScale.y);
+                rleSprites[i].encode(pixels, width, height);
+            }
+            else {
+                collisionMasks[i] = CollisionMask::fromTexture(*textures[i], spriteScale.x, spriteScale.y);
+                rleSprites[i].encode(textures[i]->copyToImage());
+            }
         }
     }
+    /**
+     * @brief Defines the idle, walk and jump clips and binds the animator to the sprite.
+     */
+    void buildAnimations() {
+        const float walkFrameDuration = 0.2f;
+        AnimationClip idle;
+        idle.addFrame(textureIdle, 1.f);
+        AnimationClip walk;
+        walk.addFrame(textureWalking1, walkFrameDuration).addFrame(textureWalking2, walkFrameDuration);
+        AnimationClip jump(false);
+        jump.addFrame(textureJumping, 1.f);
+
+        animationState.addState(Idle, animations.addClip(idle));
+        animationState.addState(Walk, animations.addClip(walk));
+        animationState.addState(Jump, animations.addClip(jump));
+        animationState.setState(Idle);
+    }
+
+protected:
+    virtual sf::FloatRect computeBounds() const override {
+        return sprite.getGlobalBounds();
+    }
 };
+// Idle, first walk frame, second walk frame, jump
+const char* const Player::textureFiles[Player::textureCount] = { "Cowboy4_walk without gun_0.png", "Cowboy4_walk without gun_2.png",
+    "Cowboy4_walk without gun_2.png", "Cowboy4_jump without gun_0.png" };
 /**
  * @brief Handles collisions between game objects.
  */
@@ -591,6 +1070,7 @@ public:
      * @param obj2 The second game object involved in the collision.
      */
     static void handleCollision(sf::RenderWindow& window, GameObject& obj1, GameObject& obj2) {
+        window.setView(window.getDefaultView());
         window.clear();
         sf::Font font;
         if (!font.loadFromFile("arial.ttf")) {
@@ -619,114 +1099,501 @@ public:
  * @brief The main function that initializes the game and runs the game loop.
  * @return The exit status of the program.
  */
-int main() {
-    sf::RenderWindow window(sf::VideoMode(800, 600), "SFML Game");
+/**
+ * @brief Entry point. "--record <file>" records the session's input, "--replay <file>"
+ *        plays a recording back without a window and reports how long loading the
+ *        assets and the replay took.
+ *        "--pack <file>" writes the asset archive and exits; "--assets <file>" loads
+ *        from another archive than assets.pak. "--scene <file>" places the starting
+ *        obstacles from the circles of a scene file, and "--write-scene <file>" writes
+ *        such a file with 10000 obstacles and exits. "--renderer software" draws the world
+ *        into a CPU framebuffer instead of through the GPU; there F2 toggles the overdraw
+ *        reduction and F3 shows how often each pixel was written. "--pixel-format rgb565"
+ *        or "rgb332" keeps that framebuffer in 16 or 8 bits per pixel instead of 32.
+ *        "--post <effects>" runs a comma separated list of blur, bloom, grade and
+ *        scanlines over an RGBA8 framebuffer.
+ */
+int main(int argc, char* argv[]) {
+    std::string recordPath, replayPath, packPath, scenePath, sceneOutputPath, rendererName, pixelFormatName, postEffects, archivePath = defaultArchive;
+    size_t stressParticles = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--record") {
+            recordPath = argv[++i];
+        }
+        else if (option == "--replay") {
+            replayPath = argv[++i];
+        }
+        else if (option == "--pack") {
+            packPath = argv[++i];
+        }
+        else if (option == "--assets") {
+            archivePath = argv[++i];
+        }
+        else if (option == "--scene") {
+            scenePath = argv[++i];
+        }
+        else if (option == "--write-scene") {
+            sceneOutputPath = argv[++i];
+        }
+        else if (option == "--particles") {
+            stressParticles = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (option == "--renderer") {
+            rendererName = argv[++i];
+        }
+        else if (option == "--pixel-format") {
+            pixelFormatName = argv[++i];
+        }
+        else if (option == "--post") {
+            postEffects = argv[++i];
+        }
+    }
+
+    if (!packPath.empty()) {
+        if (!packAssets(packPath)) {
+            std::cerr << "Failed to write asset archive " << packPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (!sceneOutputPath.empty()) {
+        if (!writeObstacleScene(sceneOutputPath, 10000)) {
+            std::cerr << "Failed to write scene " << sceneOutputPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    InputSystem input;
+    if (!replayPath.empty() && !input.startReplay(replayPath)) {
+        std::cerr << "Failed to open input replay " << replayPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!recordPath.empty() && replayPath.empty() && !input.startRecording(recordPath)) {
+        std::cerr << "Failed to open input recording " << recordPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    // Replays run as fast as possible without a window
+    const bool headless = input.getMode() == InputSystem::Replaying;
+
+    sf::RenderWindow window;
+    if (!headless) {
+        window.create(sf::VideoMode(800, 600), "SFML Game");
+    }
     sf::Color backgroundColor(0, 192, 255);
 
+    // Without an archive every asset is decoded from its loose file
+    sf::Clock loadClock;
+    AssetArchive assets;
+    const bool archived = assets.open(archivePath);
+
     sf::Texture backgroundTexture;
-    if (!backgroundTexture.loadFromFile("asd.jpg")) {
+    if (!loadTexture(assets, "asd.jpg", backgroundTexture)) {
         std::cerr << "Failed to load background image!" << std::endl;
         return EXIT_FAILURE;
     }
-    sf::Sprite backgroundSprite1(backgroundTexture);
-    sf::Sprite backgroundSprite2(backgroundTexture);
+    // Add more layers with smaller factors behind this one for depth
+    ParallaxBackground background;
+    background.addLayer(backgroundTexture, sf::FloatRect(0.f, 0.f, 800.f, static_cast<float>(backgroundTexture.getSize().y)), sf::Vector2f(1.f, 0.f));
 
-    backgroundSprite1.setPosition(0, 0);
-    backgroundSprite2.setPosition(backgroundSprite1.getGlobalBounds().width, 0);
+    // The software renderer queues the world's sprites and fills, draws them into a framebuffer
+    // the size of the window with as little overdraw as it can, and uploads it as one texture
+    const bool softwareRendering = rendererName == "software";
+    DrawQueue drawQueue;
+    const sf::Vector2u frameSize(800, 600);
+    // Only the framebuffer of the chosen pixel format is ever created
+    const bool useRgb565 = pixelFormatName == "rgb565";
+    const bool useRgb332 = pixelFormatName == "rgb332";
+    Framebuffer frame;
+    Rgb565Framebuffer rgb565Frame;
+    Rgb332Framebuffer rgb332Frame;
+    sf::Texture frameTexture;
+    sf::Sprite frameSprite;
+    sf::Vector2i frameOrigin;
+    // Pixels written per screen pixel in the last software frame
+    float overdraw = 0.f;
+    RleSprite backgroundSprite;
+    // Full-frame effects over the finished software frame, split across the job system
+    PostProcessChain postProcess;
+    if (softwareRendering) {
+        if (useRgb565) {
+            rgb565Frame.create(frameSize.x, frameSize.y);
+        }
+        else if (useRgb332) {
+            rgb332Frame.create(frameSize.x, frameSize.y);
+        }
+        else {
+            if (!pixelFormatName.empty() && pixelFormatName != "rgba8") {
+                std::cerr << "Unknown pixel format " << pixelFormatName << ", using rgba8" << std::endl;
+            }
+            frame.create(frameSize.x, frameSize.y);
+        }
+        if (!postEffects.empty() && (useRgb565 || useRgb332)) {
+            std::cerr << "Post-processing needs the rgba8 pixel format and is skipped" << std::endl;
+        }
+        backgroundSprite.encode(backgroundTexture.copyToImage());
 
-    Player player(0, 270, 1);
-    GroundObject ground(1000, 200);
+        std::string::size_type start = 0;
+        while (!postEffects.empty() && start <= postEffects.size()) {
+            std::string::size_type end = postEffects.find(',', start);
+            if (end == std::string::npos) {
+                end = postEffects.size();
+            }
+            const std::string effect = postEffects.substr(start, end - start);
+            if (effect == "blur") {
+                postProcess.addBlur(2.f);
+            }
+            else if (effect == "bloom") {
+                postProcess.addBloom(200, 8.f, 0.8f);
+            }
+            else if (effect == "grade") {
+                // Warm, slightly desaturated look
+                ColorLut lut;
+                lut.create(17, [](sf::Color color) {
+                    const int gray = (color.r * 77 + color.g * 150 + color.b * 29) >> 8;
+                    const auto mix = [gray](int channel, int tint) {
+                        return static_cast<sf::Uint8>(std::max(0, std::min(255, (channel * 3 + gray) / 4 + tint)));
+                    };
+                    return sf::Color(mix(color.r, 12), mix(color.g, 4), mix(color.b, -10), color.a);
+                });
+                postProcess.addColorGrade(lut);
+            }
+            else if (effect == "scanlines") {
+                postProcess.addScanlines(0.25f);
+            }
+            else {
+                std::cerr << "Unknown post-processing effect " << effect << std::endl;
+            }
+            start = end + 1;
+        }
+    }
+
+    // Advances every animated sprite in one batch per tick
+    AnimationSystem animations;
+    // The level is wider than the window; the camera follows the player through it
+    const float worldWidth = 64 * 800.f;
+    const float groundHeight = 200.f;
+    // Declared before everything that owns a body, so it is destroyed after them
+    PhysicsWorld physics;
+    Player player(animations, physics, assets, 0, 270, 1);
+    GroundObject ground(worldWidth, groundHeight);
+    // The level's solid parts: the ground, and walls at both ends of the world
+    BodyDefinition levelBody;
+    levelBody.type = StaticBody;
+    levelBody.category = WorldCategory;
+    levelBody.position = Vec2(worldWidth * 0.5f, 600.f - groundHeight * 0.5f);
+    levelBody.halfExtents = Vec2(worldWidth * 0.5f, groundHeight * 0.5f);
+    physics.createBody(levelBody);
+    levelBody.halfExtents = Vec2(50.f, 600.f);
+    levelBody.position = Vec2(-50.f, 0.f);
+    physics.createBody(levelBody);
+    levelBody.position = Vec2(worldWidth + 50.f, 0.f);
+    physics.createBody(levelBody);
+    Camera camera(sf::Vector2f(800.f, 600.f));
+    camera.setBounds(sf::FloatRect(0.f, 0.f, worldWidth, 600.f));
+    double backgroundDrift = 0.0;
 
-    const int circleCount = 1;
-    std::vector<Circle> circles;
+    // A scene file places the obstacles; its circles are streamed in and out in chunks around
+    // the camera. Without a scene a single circle keeps respawning at the right of the view.
+    SceneFile scene;
+    if (!scenePath.empty() && !scene.open(scenePath)) {
+        std::cerr << "Failed to load scene " << scenePath << std::endl;
+        return EXIT_FAILURE;
+    }
+    // Obstacles live in a pool so respawning them reuses slots instead of the heap
+    ObjectPool<Circle> circles(16);
+    auto randomCircleY = []() {
+        return static_cast<float>(std::rand() % 301 + 100);
+    };
+    auto spawnCircle = [&circles, &physics, &camera, &randomCircleY]() {
+        return circles.create(physics, 20.f, camera.getVisibleArea().left + 800.f, randomCircleY(), 0.9f);
+    };
 
-    for (int i = 0; i < circleCount; ++i) {
-        float randomY = static_cast<float>(std::rand() % 301 + 100);
-        circles.emplace_back(20, 800, randomY, 0.9f);
+    // The loader reads the chunk's own run of the mapped scene on the streaming thread, so
+    // nothing of the level but the loaded chunks is ever paged in or held in memory. Chunks
+    // are as large as the ones the scene file groups its instances by.
+    const float chunkSize = scene.isOpen() ? scene.getChunkSize() : sceneDefaultChunkSize;
+    WorldStreamer streamer(chunkSize, [&scene](ChunkCoord coord, std::vector<SceneInstance>& instances) {
+        for (const SceneInstance& instance : scene.getChunkInstances(coord.x, coord.y)) {
+            if (instance.kind == SceneCircle) {
+                instances.push_back(instance);
+            }
+        }
+    });
+    // Recordings and replays must see chunks arrive on the same ticks
+    streamer.setDeterministic(input.getMode() != InputSystem::Live);
+    // Circles created from each loaded chunk, destroyed with it unless already gone
+    std::unordered_map<std::uint64_t, std::vector<PoolHandle>> streamedCircles;
+    const bool streaming = scene.getInstances().size() > 0;
+    if (!streaming) {
+        spawnCircle();
     }
 
-    sf::Clock speedUpClock, clock;
+    // The program's one worker pool: per-object updates, particles and post-processing share it
+    JobSystem jobSystem;
+    const size_t updateGrainSize = 256;
+
+    // Game time is summed from the input snapshots so a replay sees exactly the recorded timing
+    float speedUpTime = 0.f, elapsedTime = 0.f;
     const float initialCircleSpeed = 0.8f;
     float currentCircleSpeed = initialCircleSpeed;
     const float speedUpInterval = 20.0f; // seconds
 
     sf::Font font;
-    if (!font.loadFromFile("arial.ttf")) {  // Adjust the font file path as needed
+    if (!loadFont(assets, fontAsset, font)) {
         std::cerr << "Failed to load font!" << std::endl;
         return EXIT_FAILURE;
     }
+    if (headless) {
+        std::cout << "Loaded assets " << (archived ? "from " + archivePath : std::string("from loose files")) << " in "
+            << loadClock.getElapsedTime().asMicroseconds() / 1000.f << " ms" << std::endl;
+    }
 
     sf::Text timerText;
     timerText.setFont(font);
     timerText.setCharacterSize(20);
     timerText.setFillColor(sf::Color::White);
     timerText.setPosition(700, 10);
+    // Shown to a tenth of a second, so the text changes ten times a second instead of every frame
+    long long shownTenths = -1;
 
-    while (window.isOpen()) {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
-            }
-        }
+    // Objects outside the view are skipped; the counts show how much drawing that saves
+    ViewCuller culler;
+    sf::Text cullingText;
+    cullingText.setFont(font);
+    cullingText.setCharacterSize(14);
+    cullingText.setFillColor(sf::Color::White);
+    cullingText.setPosition(700, 35);
+    // Values cullingText shows, so it is rebuilt only when one of them changes; the overdraw
+    // factor is shown to a tenth, -1 when rendering on the GPU
+    std::size_t shownDrawn = 0, shownCulled = 0, shownParticles = 0, shownChunks = 0;
+    int shownOverdrawTenths = -1;
+    bool hasCullingText = false;
 
-        backgroundSprite1.move(-0.5f, 0);
-        backgroundSprite2.move(-0.5f, 0);
+    // Effects live in one particle system; --particles adds a fountain keeping that many alive
+    ParticleSystem particles(4096 + stressParticles);
+    particles.setGravity(sf::Vector2f(0.f, 600.f));
+    particles.setDrag(2.f);
+    ParticleSettings landingDust;
+    landingDust.spread = sf::Vector2f(40.f, 4.f);
+    landingDust.minVelocity = sf::Vector2f(-120.f, -160.f);
+    landingDust.maxVelocity = sf::Vector2f(120.f, -20.f);
+    landingDust.minLifetime = 0.3f;
+    landingDust.maxLifetime = 0.6f;
+    landingDust.color = sf::Color(200, 180, 140);
+    if (stressParticles > 0) {
+        ParticleSettings fountain;
+        fountain.minLifetime = fountain.maxLifetime = 2.f;
+        fountain.rate = stressParticles / fountain.maxLifetime;
+        fountain.spread = sf::Vector2f(8.f, 8.f);
+        fountain.minVelocity = sf::Vector2f(-200.f, -700.f);
+        fountain.maxVelocity = sf::Vector2f(200.f, -400.f);
+        fountain.color = sf::Color(255, 160, 40);
+        particles.addEmitter(fountain, sf::Vector2f(400.f, 500.f));
+    }
 
-        if (backgroundSprite1.getPosition().x + backgroundSprite1.getGlobalBounds().width <= 0) {
-            backgroundSprite1.setPosition(backgroundSprite2.getPosition().x + backgroundSprite2.getGlobalBounds().width, 0);
+    sf::Clock benchmarkClock;
+    bool running = true;
+    while (running) {
+        const InputSnapshot& snapshot = headless ? input.poll() : input.poll(window);
+        if (snapshot.closeRequested) {
+            break;
         }
+        speedUpTime += snapshot.getDeltaSeconds();
+        elapsedTime += snapshot.getDeltaSeconds();
 
-        if (backgroundSprite2.getPosition().x + backgroundSprite2.getGlobalBounds().width <= 0) {
-            backgroundSprite2.setPosition(backgroundSprite1.getPosition().x + backgroundSprite1.getGlobalBounds().width, 0);
+        camera.follow(sf::Vector2f(player.getBounds().left + player.getBounds().width * 0.5f, 300.f));
+        camera.update(snapshot.getDeltaSeconds());
+        const sf::FloatRect visibleArea = camera.getVisibleArea();
+        // The background keeps drifting on its own on top of following the camera
+        backgroundDrift += 0.5;
+        background.setCameraPosition(visibleArea.left + backgroundDrift, 0.0);
+
+        if (streaming) {
+            streamer.update(camera.getCenter());
+            ChunkCoord releasedChunk;
+            while (streamer.popReleased(releasedChunk)) {
+                auto found = streamedCircles.find(WorldStreamer::chunkKey(releasedChunk));
+                if (found != streamedCircles.end()) {
+                    for (PoolHandle handle : found->second) {
+                        circles.destroy(handle);
+                    }
+                    streamedCircles.erase(found);
+                }
+            }
+            StreamedChunk loadedChunk;
+            while (streamer.popLoaded(loadedChunk)) {
+                std::vector<PoolHandle>& handles = streamedCircles[WorldStreamer::chunkKey(loadedChunk.coord)];
+                for (const SceneInstance& instance : loadedChunk.instances) {
+                    // Scene circles are stored by center, Circle is placed by its top-left corner
+                    float radius = instance.size.x;
+                    handles.push_back(circles.create(physics, radius, instance.position.x - radius, instance.position.y - radius, 0.9f));
+                }
+            }
         }
 
-        window.clear();
+        if (!headless) {
+            window.clear();
+            if (softwareRendering) {
+                frameOrigin = sf::Vector2i(static_cast<int>(std::floor(visibleArea.left)), static_cast<int>(std::floor(visibleArea.top)));
+                // Repeated across the frame like the parallax layer's repeating texture
+                const int backgroundWidth = static_cast<int>(backgroundSprite.getWidth());
+                if (backgroundWidth > 0) {
+                    const int offset = static_cast<int>(std::fmod(visibleArea.left + backgroundDrift, static_cast<double>(backgroundWidth)));
+                    for (int x = -offset; x < static_cast<int>(frameSize.x); x += backgroundWidth) {
+                        drawQueue.drawSprite(backgroundSprite, static_cast<float>(x), 0.f);
+                    }
+                }
+            }
+            else {
+                // The background fills the window, so it is drawn in screen space
+                window.setView(window.getDefaultView());
+                window.draw(background);
+            }
 
-        window.draw(backgroundSprite1);
-        window.draw(backgroundSprite2);
+            window.setView(camera.getView());
+            culler.beginFrame(window.getView());
+        }
 
         ground.update();
-        ground.draw(window);
+        if (!headless && culler.isVisible(ground.getBounds())) {
+            if (softwareRendering) {
+                ground.draw(drawQueue, frameOrigin, frameSize);
+            }
+            else {
+                ground.draw(window);
+            }
+        }
 
         // Check if 15 seconds have passed to speed up the circles
-        if (speedUpClock.getElapsedTime().asSeconds() >= speedUpInterval) {
+        if (speedUpTime >= speedUpInterval) {
             // Speed up the circles
             currentCircleSpeed += 0.1f; // You can adjust the speed increment as needed
-            speedUpClock.restart(); // Restart the clock
+            speedUpTime = 0.f; // Restart the timer
         }
 
-        for (auto& circle : circles) {
-            circle.setSpeed(currentCircleSpeed);
-            circle.update();
-            circle.draw(window);
+        // Circles and the player set their velocities (circles in parallel), then the physics
+        // steps move everything; drawing, collisions and respawns stay in pool order below
+        jobSystem.parallelFor(circles.size(), updateGrainSize, [&circles, currentCircleSpeed](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                circles.at(i).setSpeed(currentCircleSpeed);
+                circles.at(i).update();
+            }
+        });
+        player.setInput(snapshot);
+        player.update();
+        physics.update(snapshot.getDeltaSeconds());
+        player.syncWithBody();
+
+        // Walk the pool backwards so removing a circle does not skip the one moved into its slot
+        for (size_t i = circles.size(); i-- > 0;) {
+            Circle& circle = circles.at(i);
+            circle.syncWithBody();
+            if (!headless && culler.isVisible(circle.getBounds())) {
+                if (softwareRendering) {
+                    circle.draw(drawQueue, frameOrigin);
+                }
+                else {
+                    circle.draw(window);
+                }
+            }
             // Check for collision between player and circle
-            sf::FloatRect playerBounds = player.getSprite().getGlobalBounds();
-            sf::FloatRect circleBounds = circle.getShape().getGlobalBounds();
-
-            // Scale the playerBounds for collision detection (make it smaller)
-            float collisionScale = 0.3f; // Adjust the scale factor as needed
-            playerBounds.width *= collisionScale;
-            playerBounds.height *= collisionScale;
-            // Use the scaled playerBounds for the intersection check
-            if (playerBounds.intersects(circleBounds)) {
-                CollisionHandler::handleCollision(window, player, circle);
+            const sf::FloatRect& playerBounds = player.getBounds();
+            const sf::FloatRect& circleBounds = circle.getBounds();
+
+            // Cheap bounding box rejection first, then the exact silhouette test
+            if (CollisionHandler::checkCollision(playerBounds, circleBounds) &&
+                CollisionMask::overlaps(player.getCollisionMask(), player.getSprite().getPosition(),
+                    circle.getCollisionMask(), circle.getShape().getPosition())) {
+                if (!headless) {
+                    CollisionHandler::handleCollision(window, player, circle);
+                }
+                running = false;
             }
-            if (circle.getX() < -circle.getRadius()) {
-                float randomY = static_cast<float>(std::rand() % 301 + 100);
-                circle.reset(800, randomY);
+            if (circle.isOffScreen(visibleArea.left)) {
+                if (streaming) {
+                    circles.destroy(circles.handleAt(i));
+                }
+                else {
+                    // Moved back to the right in place, keeping its shape and physics body
+                    circle.reset(visibleArea.left + 800.f, randomCircleY());
+                }
             }
         }
 
-        player.update();
-        player.draw(window);
+        animations.update(snapshot.getDeltaSeconds());
+        if (player.hasLanded()) {
+            const sf::FloatRect feet = player.getSprite().getGlobalBounds();
+            particles.burst(landingDust, sf::Vector2f(feet.left + feet.width * 0.5f, feet.top + feet.height), 64);
+        }
+        particles.update(snapshot.getDeltaSeconds(), &jobSystem);
+        if (!headless && running) {
+            if (softwareRendering) {
+                if (culler.isVisible(player.getBounds())) {
+                    player.draw(drawQueue, frameOrigin);
+                }
+                if (snapshot.wasKeyPressed(sf::Keyboard::F2)) {
+                    drawQueue.setOverdrawReduction(!drawQueue.isOverdrawReductionEnabled());
+                }
+                const bool toggleOverdraw = snapshot.wasKeyPressed(sf::Keyboard::F3);
+                if (useRgb565) {
+                    overdraw = renderSoftwareFrame(drawQueue, rgb565Frame, toggleOverdraw, postProcess, jobSystem, frameTexture);
+                }
+                else if (useRgb332) {
+                    overdraw = renderSoftwareFrame(drawQueue, rgb332Frame, toggleOverdraw, postProcess, jobSystem, frameTexture);
+                }
+                else {
+                    overdraw = renderSoftwareFrame(drawQueue, frame, toggleOverdraw, postProcess, jobSystem, frameTexture);
+                }
+                frameSprite.setTexture(frameTexture, true);
+                window.setView(window.getDefaultView());
+                window.draw(frameSprite);
+                window.setView(camera.getView());
+            }
+            else if (culler.isVisible(player.getBounds())) {
+                player.draw(window);
+            }
+            window.draw(particles);
 
-        // Display the elapsed time in the top-right corner
-        timerText.setString("Time:" + std::to_string(clock.getElapsedTime().asSeconds()));
-        window.draw(timerText);
+            // Display the elapsed time in the top-right corner
+            window.setView(window.getDefaultView());
+            const long long tenths = static_cast<long long>(elapsedTime * 10.f);
+            if (tenths != shownTenths) {
+                shownTenths = tenths;
+                char timeString[32];
+                std::snprintf(timeString, sizeof(timeString), "Time:%lld.%lld", tenths / 10, tenths % 10);
+                timerText.setString(timeString);
+            }
+            window.draw(timerText);
+            const int overdrawTenths = softwareRendering ? static_cast<int>(overdraw * 10.f + 0.5f) : -1;
+            if (!hasCullingText || culler.getDrawnCount() != shownDrawn || culler.getCulledCount() != shownCulled ||
+                particles.getCount() != shownParticles || streamer.getLoadedCount() != shownChunks || overdrawTenths != shownOverdrawTenths) {
+                hasCullingText = true;
+                shownDrawn = culler.getDrawnCount();
+                shownCulled = culler.getCulledCount();
+                shownParticles = particles.getCount();
+                shownChunks = streamer.getLoadedCount();
+                shownOverdrawTenths = overdrawTenths;
+                char cullingString[128];
+                const int length = std::snprintf(cullingString, sizeof(cullingString), "Drawn: %zu Culled: %zu Particles: %zu Chunks: %zu",
+                    shownDrawn, shownCulled, shownParticles, shownChunks);
+                if (overdrawTenths >= 0 && length > 0 && length < static_cast<int>(sizeof(cullingString))) {
+                    std::snprintf(cullingString + length, sizeof(cullingString) - length, " Overdraw: %d.%dx", overdrawTenths / 10, overdrawTenths % 10);
+                }
+                cullingText.setString(cullingString);
+            }
+            window.draw(cullingText);
 
-        window.display();
+            window.display();
+        }
+    }
+
+    if (headless) {
+        std::cout << "Replayed " << input.getSnapshot().tick << " ticks in "
+            << benchmarkClock.getElapsedTime().asMilliseconds() << " ms" << std::endl;
     }
+    input.stop();
 
     return 0;
 }
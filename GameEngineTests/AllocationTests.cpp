@@ -0,0 +1,94 @@
+//AllocationTests.cpp
+// Checks that the per-frame containers stop touching the heap once they are warm: every
+// global operator new is counted, a few frames warm the containers up, and the frames after
+// that must not allocate at all. Returns non-zero if any check fails.
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "FrameArena.h"
+#include "ObjectPool.h"
+
+namespace {
+	std::size_t allocationCount = 0;
+
+	struct Projectile {
+		float x, y, vx, vy;
+		Projectile(float _x, float _y) : x(_x), y(_y), vx(1.f), vy(0.f) {}
+	};
+
+	const int warmupFrames = 3;
+	const int measuredFrames = 100;
+
+	// Run frame(index) for the warm-up frames, then count the allocations of the measured ones
+	template <typename Frame>
+	bool checkSteadyState(const char* name, Frame frame) {
+		for (int i = 0; i < warmupFrames; ++i) {
+			frame(i);
+		}
+		const std::size_t before = allocationCount;
+		for (int i = warmupFrames; i < warmupFrames + measuredFrames; ++i) {
+			frame(i);
+		}
+		const std::size_t allocations = allocationCount - before;
+		std::printf("%-40s %zu allocations in %d frames\n", name, allocations, measuredFrames);
+		return allocations == 0;
+	}
+}
+
+void* operator new(std::size_t size) {
+	++allocationCount;
+	if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+int main() {
+	bool passed = true;
+
+	// Spawning and despawning a wave of projectiles every frame reuses the freed slots
+	ObjectPool<Projectile> projectiles;
+	std::vector<PoolHandle> handles(2000);
+	passed &= checkSteadyState("ObjectPool spawn/despawn", [&projectiles, &handles](int frame) {
+		for (PoolHandle& handle : handles) {
+			if (!handle.isNull()) {
+				projectiles.destroy(handle);
+			}
+			handle = projectiles.create(static_cast<float>(frame), 0.f);
+		}
+		projectiles.forEach([](Projectile& projectile) { projectile.x += projectile.vx; });
+	});
+
+	// Per-frame geometry temporaries keep their capacity between frames
+	VectorPool<float> geometry;
+	passed &= checkSteadyState("VectorPool per-frame temporaries", [&geometry](int frame) {
+		for (int list = 0; list < 4; ++list) {
+			std::vector<float>& points = geometry.acquire();
+			for (int i = 0; i < 500 + list * 100; ++i) {
+				points.push_back(static_cast<float>(frame + i));
+			}
+		}
+		geometry.releaseAll();
+	});
+
+	// Scratch spilling over several blocks is merged into one block by the first reset and reused after that
+	FrameArena arena(4096);
+	passed &= checkSteadyState("FrameArena scratch", [&arena](int frame) {
+		for (int i = 0; i < 64; ++i) {
+			float* scratch = static_cast<float*>(arena.allocate(sizeof(float) * (100 + i * 10), alignof(float)));
+			scratch[0] = static_cast<float>(frame);
+		}
+		arena.reset();
+	});
+
+	std::printf(passed ? "All allocation checks passed\n" : "Allocation checks FAILED\n");
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}